@@ -0,0 +1,957 @@
+/*
+ * Bind and deform throughput of the core library on procedural meshes.
+ *
+ * Each case binds a driven point cloud to a driver mesh and deforms it for a
+ * number of frames, timing every stage on its own:
+ *   bindNormals   driver vertex normals in the bind pose
+ *   bvhBuild      triangle BVH over the driver
+ *   closestPoint  closest driver point of every driven vertex
+ *   barycentric   barycentric coordinates of the closest points
+ *   bindFrames    bind matrices or offsets
+ *   localityOrder binding reordered along a Morton curve, --orders locality only
+ *   compactIndex  referenced driver vertices and their driven vertices
+ *   driverUpdate  per frame gather of the referenced driver points and normals
+ *   deform        per frame deform of every driven vertex
+ *   writeBack     per frame copy of the points back to driven vertex order
+ *   outputKey     per frame hash of the driver and input points keying the
+ *                 output cache, not part of the frame time
+ *
+ * The frames run in double or float, see --precisions, with the binding in
+ * driven vertex order or in locality order, see --orders. The driver reads
+ * of the deform are replayed through models of a 32 KiB L1 and a 1 MiB L2
+ * data cache to compare the orders on any machine. Single thread runs also
+ * count the hardware cache misses of the deform where the OS allows it.
+ *
+ * Run with --help for the options. --json writes the results for tracking
+ * regressions between builds.
+ */
+
+#include "core/outputCache.h"
+#include "core/simd.h"
+#include "core/threadPool.h"
+#include "core/vertexNormals.h"
+#include "core/wrapKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+struct Options {
+	std::vector<unsigned int> sizes = { 1000, 10000, 100000, 1000000, 5000000 };
+	std::vector<std::string> drivers = { "sphere", "grid" };
+	std::vector<BindMode> modes = { kBindMatrix, kBindOffset };
+	std::vector<Precision> precisions = { kPrecisionDouble, kPrecisionFloat };
+	std::vector<bool> orders = { false, true }; // Driven vertex order, locality order
+	std::vector<unsigned int> threads; // Empty for 1 and every thread
+	unsigned int frames = 10;
+	double driverRatio = 0.25;
+	unsigned int grainSize = kDefaultGrainSize;
+	std::string jsonPath;
+	double maxRestError = 1e-4;
+	double maxFloatRestError = 1e-3; // Float frames round the points to float
+};
+
+struct Mesh {
+	std::vector<double> points; // 3 doubles per vertex
+	std::vector<int> triangles; // 3 vertex ids per triangle
+
+	unsigned int vertexCount() const { return (unsigned int)points.size() / 3; }
+	unsigned int triangleCount() const { return (unsigned int)triangles.size() / 3; }
+};
+
+struct Stage {
+	const char* name;
+	double seconds;
+	unsigned int count; // Items processed once, vertices or triangles
+	unsigned int repeats; // Times the stage ran over count items
+};
+
+struct CaseResult {
+	std::string driver;
+	BindMode mode;
+	Precision precision;
+	bool locality; // Binding reordered by OrderBindingForLocality
+	unsigned int drivenVertices;
+	unsigned int driverVertices;
+	unsigned int driverTriangles;
+	unsigned int referencedVertices;
+	unsigned int threads;
+	std::vector<Stage> stages;
+	double bindSeconds;
+	double frameSeconds; // Average driverUpdate + deform per frame
+	double bestFrameSeconds;
+	double restError; // Largest distance from the bind pose after deforming the unmoved driver
+	size_t bindingBytes;
+	size_t peakMemoryBytes;
+	double l1MissesPerVertex; // Modeled driver read misses of one deform
+	double l2MissesPerVertex;
+	long long cacheMisses = -1; // Hardware cache misses of one deform, -1 where they can not be counted
+	double bindSpeedup = 0.0; // Against the single thread run of the same case, 0 without one
+	double frameSpeedup = 0.0;
+	unsigned int repeatedOutputKeys = 0; // Frames with the output key of the frame before, 0 since the driver moves every frame
+};
+
+class Timer {
+public:
+	Timer() : start_(std::chrono::steady_clock::now()) {}
+	double seconds() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+	}
+private:
+	std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @return The peak resident memory of the process so far, in bytes
+ */
+size_t GetPeakMemory() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;
+#else
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/**
+ * Hardware cache misses of the calling thread, where the OS lets the process count them
+ */
+class CacheMissCounter {
+public:
+	CacheMissCounter() : descriptor_(-1) {
+#ifdef __linux__
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		descriptor_ = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMissCounter() {
+#ifdef __linux__
+		if (descriptor_ >= 0) {
+			close(descriptor_);
+		}
+#endif
+	}
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+	bool available() const { return descriptor_ >= 0; }
+
+	void Start() {
+#ifdef __linux__
+		ioctl(descriptor_, PERF_EVENT_IOC_RESET, 0);
+		ioctl(descriptor_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	/**
+	 * @return The misses since Start
+	 */
+	long long Stop() {
+		long long misses = 0;
+#ifdef __linux__
+		ioctl(descriptor_, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(descriptor_, &misses, sizeof(misses)) != sizeof(misses)) {
+			misses = 0;
+		}
+#endif
+		return misses;
+	}
+
+private:
+	int descriptor_;
+};
+
+/**
+ * Set associative cache with LRU replacement and 64 byte lines, counting the misses of an address stream
+ */
+class CacheModel {
+public:
+	CacheModel(size_t bytes, unsigned int ways)
+		: ways_(ways), setCount_((unsigned int)(bytes / 64 / ways)), lines_(bytes / 64, ~0ull), misses_(0) {}
+
+	void Access(uint64_t address) {
+		uint64_t line = address >> 6;
+		uint64_t* set = &lines_[(line % setCount_) * ways_];
+		unsigned int way = 0;
+		while (way < ways_ && set[way] != line) {
+			++way;
+		}
+		if (way == ways_) {
+			++misses_;
+			way = ways_ - 1;
+		}
+		// Most recently used first
+		std::copy_backward(set, set + way, set + way + 1);
+		set[0] = line;
+	}
+
+	uint64_t misses() const { return misses_; }
+
+private:
+	unsigned int ways_;
+	unsigned int setCount_;
+	std::vector<uint64_t> lines_;
+	uint64_t misses_;
+};
+
+/**
+ * Replays the compact driver point and normal reads of one deform in element
+ * order through an L1 and an L2 model. The binding arrays and the driven
+ * points are read in order either way, so they are left out.
+ * @param[in] pointSize Bytes of one point coordinate, the precision of the deform
+ */
+void ModelDriverMisses(const WrapBinding& binding, size_t pointSize, CaseResult& result) {
+	CacheModel l1(32 * 1024, 8), l2(1024 * 1024, 16);
+	uint64_t normalsBase = ((uint64_t)binding.referencedVertexCount() * 3 * pointSize + 4095) / 4096 * 4096;
+	auto read = [&](int compactId) {
+		uint64_t point = (uint64_t)compactId * 3 * pointSize;
+		uint64_t normal = normalsBase + (uint64_t)compactId * 3 * sizeof(float);
+		for (uint64_t address : { point, point + 3 * pointSize - 1, normal, normal + 3 * sizeof(float) - 1 }) {
+			l1.Access(address);
+			l2.Access(address);
+		}
+	};
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		for (int corner = 0; corner < 3; ++corner) {
+			read(binding.compactTriangleVerts[i * 3 + corner]);
+		}
+		if (binding.hasSamples()) {
+			for (unsigned int j = binding.sampleOffsets[i]; j < binding.sampleOffsets[i + 1]; ++j) {
+				read(binding.compactSampleVertices[j]);
+			}
+		}
+	}
+	unsigned int count = std::max(1u, binding.size());
+	result.l1MissesPerVertex = (double)l1.misses() / count;
+	result.l2MissesPerVertex = (double)l2.misses() / count;
+}
+
+/**
+ * Deterministic value in [-1, 1] for a lattice position, for repeatable noise
+ */
+double HashNoise(unsigned int x, unsigned int y) {
+	unsigned int h = x * 374761393u + y * 668265263u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	h ^= h >> 16;
+	return (h & 0xFFFFFF) / double(0x7FFFFF) - 1.0;
+}
+
+/**
+ * Smooth height field of the grid driver before the per vertex noise
+ */
+double GridHeight(double x, double z) {
+	return 0.3 * std::sin(1.7 * x) * std::cos(1.3 * z) + 0.1 * std::sin(4.1 * x + 2.3 * z);
+}
+
+const double kGridSize = 10.0;
+
+/**
+ * A latitude and longitude sphere of radius 1 with about vertexCount vertices
+ */
+Mesh CreateSphere(unsigned int vertexCount) {
+	unsigned int segments = std::max(3u, (unsigned int)std::sqrt(2.0 * vertexCount));
+	unsigned int rings = std::max(3u, vertexCount / segments + 1);
+	Mesh mesh;
+	mesh.points.reserve(((rings - 1) * segments + 2) * 3);
+	mesh.points.insert(mesh.points.end(), { 0.0, 1.0, 0.0 });
+	for (unsigned int ring = 1; ring < rings; ++ring) {
+		double phi = kPi * ring / rings;
+		for (unsigned int segment = 0; segment < segments; ++segment) {
+			double theta = 2.0 * kPi * segment / segments;
+			mesh.points.insert(mesh.points.end(), {
+				std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta) });
+		}
+	}
+	int southPole = (int)mesh.vertexCount();
+	mesh.points.insert(mesh.points.end(), { 0.0, -1.0, 0.0 });
+
+	auto ringVertex = [segments](unsigned int ring, unsigned int segment) {
+		return (int)(1 + (ring - 1) * segments + segment % segments);
+	};
+	for (unsigned int segment = 0; segment < segments; ++segment) {
+		mesh.triangles.insert(mesh.triangles.end(), { 0, ringVertex(1, segment + 1), ringVertex(1, segment) });
+		mesh.triangles.insert(mesh.triangles.end(), {
+			southPole, ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1) });
+	}
+	for (unsigned int ring = 1; ring < rings - 1; ++ring) {
+		for (unsigned int segment = 0; segment < segments; ++segment) {
+			int v0 = ringVertex(ring, segment), v1 = ringVertex(ring, segment + 1);
+			int v2 = ringVertex(ring + 1, segment), v3 = ringVertex(ring + 1, segment + 1);
+			mesh.triangles.insert(mesh.triangles.end(), { v0, v1, v2, v1, v3, v2 });
+		}
+	}
+	return mesh;
+}
+
+/**
+ * A height field grid in the xz plane with about vertexCount vertices and per vertex noise
+ */
+Mesh CreateNoisyGrid(unsigned int vertexCount) {
+	unsigned int resolution = std::max(1u, (unsigned int)std::sqrt((double)vertexCount) - 1);
+	Mesh mesh;
+	mesh.points.reserve((resolution + 1) * (resolution + 1) * 3);
+	for (unsigned int row = 0; row <= resolution; ++row) {
+		for (unsigned int column = 0; column <= resolution; ++column) {
+			double x = kGridSize * column / resolution - kGridSize * 0.5;
+			double z = kGridSize * row / resolution - kGridSize * 0.5;
+			double y = GridHeight(x, z) + 0.01 * HashNoise(column, row);
+			mesh.points.insert(mesh.points.end(), { x, y, z });
+		}
+	}
+	for (unsigned int row = 0; row < resolution; ++row) {
+		for (unsigned int column = 0; column < resolution; ++column) {
+			int v0 = (int)(row * (resolution + 1) + column);
+			int v1 = v0 + 1;
+			int v2 = v0 + (int)resolution + 1;
+			int v3 = v2 + 1;
+			mesh.triangles.insert(mesh.triangles.end(), { v0, v2, v1, v1, v2, v3 });
+		}
+	}
+	return mesh;
+}
+
+/**
+ * Driven points scattered in a shell around the driver
+ */
+std::vector<double> CreateDrivenPoints(const std::string& driver, unsigned int count) {
+	std::mt19937 random(12345);
+	std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+	std::vector<double> points(count * 3);
+	for (unsigned int i = 0; i < count; ++i) {
+		double* p = &points[i * 3];
+		if (driver == "sphere") {
+			double length;
+			do {
+				p[0] = uniform(random);
+				p[1] = uniform(random);
+				p[2] = uniform(random);
+				length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			} while (length > 1.0 || length < 1e-3);
+			double radius = 1.05 + 0.03 * uniform(random);
+			for (int axis = 0; axis < 3; ++axis) {
+				p[axis] *= radius / length;
+			}
+		} else {
+			p[0] = uniform(random) * kGridSize * 0.45;
+			p[2] = uniform(random) * kGridSize * 0.45;
+			p[1] = GridHeight(p[0], p[2]) + 0.3 * uniform(random);
+		}
+	}
+	return points;
+}
+
+/**
+ * Moves the driver for a frame with a travelling wave and a drift
+ */
+void AnimateDriver(const Mesh& rest, unsigned int frame, Mesh& animated) {
+	double time = 0.5 * (frame + 1);
+	unsigned int vertexCount = rest.vertexCount();
+	for (unsigned int v = 0; v < vertexCount; ++v) {
+		const double* p = &rest.points[v * 3];
+		double* out = &animated.points[v * 3];
+		double wave = 0.1 * std::sin(2.0 * p[0] + time) * std::cos(1.5 * p[2] - time);
+		out[0] = p[0] + 0.05 * time;
+		out[1] = p[1] + wave;
+		out[2] = p[2];
+	}
+}
+
+template <typename Function>
+double TimeStage(std::vector<Stage>& stages, const char* name, unsigned int count, Function function) {
+	Timer timer;
+	function();
+	double seconds = timer.seconds();
+	stages.push_back(Stage{ name, seconds, count, 1 });
+	return seconds;
+}
+
+size_t BindingBytes(const WrapBinding& binding) {
+	return binding.triangleVerts.capacity() * sizeof(int) +
+		binding.coords.capacity() * sizeof(BaryCoords) +
+		binding.bindMatrices.capacity() * sizeof(double) +
+		binding.offsets.capacity() * sizeof(float) +
+		binding.floatBindMatrices.capacity() * sizeof(float) +
+		binding.referencedVertices.capacity() * sizeof(int) +
+		binding.compactTriangleVerts.capacity() * sizeof(int) +
+		binding.drivenOffsets.capacity() * sizeof(unsigned int) +
+		binding.drivenVertices.capacity() * sizeof(unsigned int) +
+		binding.vertexOrder.capacity() * sizeof(unsigned int);
+}
+
+/**
+ * Deforms the driven points for every frame in the precision of Real, frame 0
+ * is the unmoved driver and checks the bind pose is kept
+ */
+template <typename Real>
+void RunFrames(const Options& options, const Mesh& driver, const VertexTriangles& adjacency,
+			   const WrapBinding& binding, const std::vector<double>& drivenPoints, CaseResult& result) {
+	const double identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+	unsigned int grainSize = options.grainSize;
+	unsigned int drivenCount = (unsigned int)drivenPoints.size() / 3;
+	unsigned int compactCount = binding.referencedVertexCount();
+	std::vector<Real> compactPoints(compactCount * 3);
+	std::vector<float> compactNormals(compactCount * 3);
+	std::vector<Real> inputPoints(drivenCount * 3);
+	GatherDrivenPoints(binding, drivenPoints.data(), 0, drivenCount, inputPoints.data());
+	std::vector<Real> points(drivenCount * 3);
+	std::vector<double> output(drivenCount * 3);
+	Mesh animated = driver;
+	Stage driverUpdate{ "driverUpdate", 0.0, compactCount, 0 };
+	Stage deform{ "deform", 0.0, drivenCount, 0 };
+	Stage writeBack{ "writeBack", 0.0, drivenCount, 0 };
+	Stage outputKey{ "outputKey", 0.0, drivenCount, 0 };
+	uint64_t previousKey = 0;
+	result.repeatedOutputKeys = 0;
+	// Other threads of the pool are not counted, so only single thread runs count misses
+	CacheMissCounter counter;
+	bool countMisses = counter.available() && result.threads == 1;
+	long long cacheMisses = 0;
+	result.bestFrameSeconds = 0.0;
+	result.restError = 0.0;
+	for (unsigned int frame = 0; frame <= options.frames; ++frame) {
+		if (frame > 0) {
+			AnimateDriver(driver, frame, animated);
+		}
+		// kBindMatrix carries the input positions through, the deformer gathers them in element order
+		std::copy(inputPoints.begin(), inputPoints.end(), points.begin());
+
+		Timer updateTimer;
+		ParallelFor(compactCount, grainSize, [&](unsigned int begin, unsigned int end) {
+			GatherReferencedVertices(binding, animated.points.data(), nullptr, begin, end,
+									 compactPoints.data(), compactNormals.data());
+			ComputeVertexNormals(adjacency, animated.triangles.data(), animated.points.data(),
+								 binding.referencedVertices.data(), begin, end, compactNormals.data());
+		});
+		double updateSeconds = updateTimer.seconds();
+
+		if (countMisses) {
+			counter.Start();
+		}
+		Timer deformTimer;
+		ParallelFor(drivenCount, grainSize, [&](unsigned int begin, unsigned int end) {
+			DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), identity, begin, end, points.data());
+		});
+		double deformSeconds = deformTimer.seconds();
+		long long frameMisses = countMisses ? counter.Stop() : 0;
+
+		// Back to driven vertex order, like the deformer writing the Maya points
+		Timer writeBackTimer;
+		ParallelFor(drivenCount, grainSize, [&](unsigned int begin, unsigned int end) {
+			ScatterDrivenPoints(binding, points.data(), begin, end, output.data());
+		});
+		double writeBackSeconds = writeBackTimer.seconds();
+
+		// What the deformer hashes to look up a kept output, only paid with an output cache
+		Timer keyTimer;
+		uint64_t key = HashBuffer(animated.points.data(), animated.points.size() * sizeof(double));
+		key = HashBuffer(drivenPoints.data(), drivenPoints.size() * sizeof(double), key);
+		double keySeconds = keyTimer.seconds();
+		// Counted so the hashes can not be optimized away, and a repeat would return the wrong output
+		result.repeatedOutputKeys += frame > 0 && key == previousKey ? 1 : 0;
+		previousKey = key;
+
+		if (frame == 0) {
+			for (unsigned int i = 0; i < drivenCount * 3; ++i) {
+				result.restError = std::max(result.restError, std::abs(output[i] - drivenPoints[i]));
+			}
+			continue;
+		}
+		cacheMisses += frameMisses;
+		driverUpdate.seconds += updateSeconds;
+		++driverUpdate.repeats;
+		deform.seconds += deformSeconds;
+		++deform.repeats;
+		writeBack.seconds += writeBackSeconds;
+		++writeBack.repeats;
+		outputKey.seconds += keySeconds;
+		++outputKey.repeats;
+		double frameSeconds = updateSeconds + deformSeconds + writeBackSeconds;
+		if (frame == 1 || frameSeconds < result.bestFrameSeconds) {
+			result.bestFrameSeconds = frameSeconds;
+		}
+	}
+	result.stages.push_back(driverUpdate);
+	result.stages.push_back(deform);
+	result.stages.push_back(writeBack);
+	result.stages.push_back(outputKey);
+	result.frameSeconds = options.frames > 0 ?
+		(driverUpdate.seconds + deform.seconds + writeBack.seconds) / options.frames : 0.0;
+	if (countMisses && options.frames > 0) {
+		result.cacheMisses = cacheMisses / options.frames;
+	}
+}
+
+CaseResult RunCase(const Options& options, const std::string& driverName, unsigned int drivenCount,
+				   BindMode mode, Precision precision, bool locality, unsigned int threads) {
+	ThreadPool::Instance().SetThreadLimit(threads);
+	unsigned int grainSize = options.grainSize;
+
+	CaseResult result;
+	result.driver = driverName;
+	result.mode = mode;
+	result.precision = precision;
+	result.locality = locality;
+	result.drivenVertices = drivenCount;
+	result.threads = ThreadPool::Instance().threadLimit();
+
+	unsigned int driverCount = std::max(64u, (unsigned int)(drivenCount * options.driverRatio));
+	Mesh driver = driverName == "sphere" ? CreateSphere(driverCount) : CreateNoisyGrid(driverCount);
+	std::vector<double> drivenPoints = CreateDrivenPoints(driverName, drivenCount);
+	result.driverVertices = driver.vertexCount();
+	result.driverTriangles = driver.triangleCount();
+	std::vector<Stage>& stages = result.stages;
+
+	// Bind
+	VertexTriangles adjacency;
+	std::vector<float> driverNormals(driver.points.size());
+	double bindSeconds = TimeStage(stages, "bindNormals", driver.vertexCount(), [&] {
+		adjacency.Build(driver.triangles.data(), driver.triangleCount(), driver.vertexCount());
+		ParallelFor(driver.vertexCount(), grainSize, [&](unsigned int begin, unsigned int end) {
+			ComputeVertexNormals(adjacency, driver.triangles.data(), driver.points.data(),
+								 nullptr, begin, end, driverNormals.data());
+		});
+	});
+
+	TriangleBvh bvh;
+	bindSeconds += TimeStage(stages, "bvhBuild", driver.triangleCount(), [&] {
+		bvh.Build(driver.points.data(), driver.triangles.data(), driver.triangleCount());
+	});
+
+	std::vector<int> triangles(drivenCount);
+	std::vector<double> closestPoints(drivenCount * 3);
+	bindSeconds += TimeStage(stages, "closestPoint", drivenCount, [&] {
+		bvh.ClosestPoints(drivenPoints.data(), drivenCount, triangles.data(), closestPoints.data(), grainSize);
+	});
+
+	WrapBinding binding;
+	binding.mode = mode;
+	binding.resize(drivenCount);
+	bindSeconds += TimeStage(stages, "barycentric", drivenCount, [&] {
+		ParallelFor(drivenCount, grainSize, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; ++i) {
+				const int* corners = &driver.triangles[triangles[i] * 3];
+				std::copy(corners, corners + 3, &binding.triangleVerts[i * 3]);
+				GetBarycentricCoordinates(&closestPoints[i * 3],
+										  &driver.points[corners[0] * 3],
+										  &driver.points[corners[1] * 3],
+										  &driver.points[corners[2] * 3],
+										  binding.coords[i]);
+			}
+		});
+	});
+
+	bindSeconds += TimeStage(stages, "bindFrames", drivenCount, [&] {
+		ParallelFor(drivenCount, grainSize, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; ++i) {
+				double origin[3], up[3], normal[3], matrix[16];
+				CalculateBasisComponents(binding.coords[i], &binding.triangleVerts[i * 3],
+										 driver.points.data(), driverNormals.data(), origin, up, normal);
+				CreateMatrix(origin, normal, up, matrix);
+				if (mode == kBindOffset) {
+					double inverse[16], offset[3];
+					InvertMatrix(matrix, inverse);
+					TransformPoint(&drivenPoints[i * 3], inverse, offset);
+					for (int axis = 0; axis < 3; ++axis) {
+						binding.offsets[i * 3 + axis] = (float)offset[axis];
+					}
+				} else {
+					InvertMatrix(matrix, &binding.bindMatrices[i * 16]);
+				}
+			}
+		});
+	});
+
+	if (locality) {
+		bindSeconds += TimeStage(stages, "localityOrder", drivenCount, [&] {
+			OrderBindingForLocality(drivenPoints.data(), binding);
+		});
+	}
+
+	bindSeconds += TimeStage(stages, "compactIndex", drivenCount, [&] {
+		binding.UpdateReferencedVertices();
+	});
+	result.bindSeconds = bindSeconds;
+	result.referencedVertices = binding.referencedVertexCount();
+	binding.UpdateFloatBindMatrices(precision);
+	result.bindingBytes = BindingBytes(binding);
+	ModelDriverMisses(binding, precision == kPrecisionFloat ? sizeof(float) : sizeof(double), result);
+
+	if (precision == kPrecisionFloat) {
+		RunFrames<float>(options, driver, adjacency, binding, drivenPoints, result);
+	} else {
+		RunFrames<double>(options, driver, adjacency, binding, drivenPoints, result);
+	}
+	result.peakMemoryBytes = GetPeakMemory();
+	ThreadPool::Instance().SetThreadLimit(0);
+	return result;
+}
+
+const char* GetModeName(BindMode mode) {
+	return mode == kBindOffset ? "offset" : "matrix";
+}
+
+const char* GetPrecisionName(Precision precision) {
+	return precision == kPrecisionFloat ? "float" : "double";
+}
+
+const char* GetOrderName(bool locality) {
+	return locality ? "locality" : "mesh";
+}
+
+/**
+ * @return true if two results ran the same case apart from the threads and the order
+ */
+bool SameCase(const CaseResult& a, const CaseResult& b) {
+	return a.driver == b.driver && a.drivenVertices == b.drivenVertices && a.mode == b.mode &&
+		a.precision == b.precision;
+}
+
+double PerSecond(double count, double seconds) {
+	return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+/**
+ * Fills in the speedups against the single thread runs of the same driver, size, mode, precision and order
+ */
+void ComputeSpeedups(std::vector<CaseResult>& results) {
+	for (CaseResult& result : results) {
+		for (const CaseResult& serial : results) {
+			if (serial.threads == 1 && SameCase(serial, result) && serial.locality == result.locality) {
+				result.bindSpeedup = result.bindSeconds > 0.0 ? serial.bindSeconds / result.bindSeconds : 0.0;
+				result.frameSpeedup = result.frameSeconds > 0.0 ? serial.frameSeconds / result.frameSeconds : 0.0;
+			}
+		}
+	}
+}
+
+void PrintTable(const std::vector<CaseResult>& results, std::ostream& out) {
+	out << std::left << std::setw(8) << "driver" << std::setw(8) << "mode" << std::setw(8) << "prec"
+		<< std::setw(10) << "order" << std::right << std::setw(10) << "driven" << std::setw(10) << "driver" << std::setw(5) << "thr"
+		<< std::setw(11) << "bind s" << std::setw(13) << "bind v/s" << std::setw(11) << "frame ms"
+		<< std::setw(13) << "deform v/s" << std::setw(9) << "speedup" << std::setw(9) << "L1 m/v"
+		<< std::setw(9) << "L2 m/v" << std::setw(10) << "peak MB" << "\n";
+	for (const CaseResult& result : results) {
+		out << std::left << std::setw(8) << result.driver << std::setw(8) << GetModeName(result.mode)
+			<< std::setw(8) << GetPrecisionName(result.precision) << std::setw(10) << GetOrderName(result.locality)
+			<< std::right << std::setw(10) << result.drivenVertices << std::setw(10) << result.driverVertices
+			<< std::setw(5) << result.threads
+			<< std::fixed << std::setprecision(3) << std::setw(11) << result.bindSeconds
+			<< std::scientific << std::setprecision(3)
+			<< std::setw(13) << PerSecond(result.drivenVertices, result.bindSeconds)
+			<< std::fixed << std::setprecision(3) << std::setw(11) << result.frameSeconds * 1000.0
+			<< std::scientific << std::setprecision(3)
+			<< std::setw(13) << PerSecond(result.drivenVertices, result.frameSeconds)
+			<< std::fixed << std::setprecision(2) << std::setw(9) << result.frameSpeedup
+			<< std::setw(9) << result.l1MissesPerVertex << std::setw(9) << result.l2MissesPerVertex
+			<< std::setprecision(1) << std::setw(10) << result.peakMemoryBytes / (1024.0 * 1024.0) << "\n";
+		out.unsetf(std::ios::floatfield);
+	}
+}
+
+/**
+ * Compares every locality order run to the driven vertex order run of the same case
+ */
+void PrintLocality(const std::vector<CaseResult>& results, std::ostream& out) {
+	for (const CaseResult& result : results) {
+		if (!result.locality) {
+			continue;
+		}
+		for (const CaseResult& mesh : results) {
+			if (mesh.locality || !SameCase(mesh, result) || mesh.threads != result.threads) {
+				continue;
+			}
+			out << "locality " << result.driver << " " << GetModeName(result.mode) << " "
+				<< GetPrecisionName(result.precision) << " " << result.drivenVertices << " x" << result.threads
+				<< std::fixed << std::setprecision(3)
+				<< ": frame " << mesh.frameSeconds * 1000.0 << " -> " << result.frameSeconds * 1000.0 << " ms"
+				<< ", L1 misses/vertex " << mesh.l1MissesPerVertex << " -> " << result.l1MissesPerVertex
+				<< ", L2 misses/vertex " << mesh.l2MissesPerVertex << " -> " << result.l2MissesPerVertex;
+			if (mesh.cacheMisses >= 0 && result.cacheMisses >= 0) {
+				out << ", hardware misses " << mesh.cacheMisses << " -> " << result.cacheMisses;
+			}
+			out << "\n";
+			out.unsetf(std::ios::floatfield);
+		}
+	}
+}
+
+void WriteJson(const Options& options, const std::vector<CaseResult>& results, std::ostream& out) {
+	out << std::setprecision(9);
+	out << "{\n";
+	out << "  \"version\": 3,\n";
+	out << "  \"simd\": \"" << GetSimdLevelName(GetSimdLevel()) << "\",\n";
+	out << "  \"hardwareThreads\": " << ThreadPool::Instance().threadCount() << ",\n";
+	out << "  \"frames\": " << options.frames << ",\n";
+	out << "  \"driverRatio\": " << options.driverRatio << ",\n";
+	out << "  \"grainSize\": " << options.grainSize << ",\n";
+	out << "  \"results\": [";
+	for (size_t r = 0; r < results.size(); ++r) {
+		const CaseResult& result = results[r];
+		out << (r == 0 ? "\n" : ",\n") << "    {\n";
+		out << "      \"driver\": \"" << result.driver << "\",\n";
+		out << "      \"mode\": \"" << GetModeName(result.mode) << "\",\n";
+		out << "      \"precision\": \"" << GetPrecisionName(result.precision) << "\",\n";
+		out << "      \"order\": \"" << GetOrderName(result.locality) << "\",\n";
+		out << "      \"drivenVertices\": " << result.drivenVertices << ",\n";
+		out << "      \"driverVertices\": " << result.driverVertices << ",\n";
+		out << "      \"driverTriangles\": " << result.driverTriangles << ",\n";
+		out << "      \"referencedVertices\": " << result.referencedVertices << ",\n";
+		out << "      \"threads\": " << result.threads << ",\n";
+		out << "      \"bindSeconds\": " << result.bindSeconds << ",\n";
+		out << "      \"bindVerticesPerSecond\": " << PerSecond(result.drivenVertices, result.bindSeconds) << ",\n";
+		out << "      \"frameSeconds\": " << result.frameSeconds << ",\n";
+		out << "      \"bestFrameSeconds\": " << result.bestFrameSeconds << ",\n";
+		out << "      \"deformVerticesPerSecond\": " << PerSecond(result.drivenVertices, result.frameSeconds) << ",\n";
+		out << "      \"bindSpeedup\": " << result.bindSpeedup << ",\n";
+		out << "      \"frameSpeedup\": " << result.frameSpeedup << ",\n";
+		out << "      \"restError\": " << result.restError << ",\n";
+		out << "      \"repeatedOutputKeys\": " << result.repeatedOutputKeys << ",\n";
+		out << "      \"bindingBytes\": " << result.bindingBytes << ",\n";
+		out << "      \"peakMemoryBytes\": " << result.peakMemoryBytes << ",\n";
+		out << "      \"l1MissesPerVertex\": " << result.l1MissesPerVertex << ",\n";
+		out << "      \"l2MissesPerVertex\": " << result.l2MissesPerVertex << ",\n";
+		out << "      \"cacheMisses\": " << result.cacheMisses << ",\n";
+		out << "      \"stages\": {";
+		for (size_t s = 0; s < result.stages.size(); ++s) {
+			const Stage& stage = result.stages[s];
+			double seconds = stage.repeats > 0 ? stage.seconds / stage.repeats : 0.0;
+			out << (s == 0 ? "\n" : ",\n");
+			out << "        \"" << stage.name << "\": { \"seconds\": " << seconds
+				<< ", \"count\": " << stage.count
+				<< ", \"perSecond\": " << PerSecond(stage.count, seconds) << " }";
+		}
+		out << "\n      }\n    }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void PrintUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [options]\n"
+		"  --sizes N,...      Driven vertex counts (1000,10000,100000,1000000,5000000)\n"
+		"  --drivers NAME,... sphere and/or grid (sphere,grid)\n"
+		"  --modes MODE,...   matrix and/or offset (matrix,offset)\n"
+		"  --precisions P,... double and/or float (double,float)\n"
+		"  --orders ORDER,... mesh and/or locality binding order (mesh,locality)\n"
+		"  --threads N,...    Threads per loop, 0 for every thread (1,0)\n"
+		"  --frames N         Deformed frames per case (10)\n"
+		"  --driver-ratio R   Driver vertices per driven vertex (0.25)\n"
+		"  --grain N          Driven vertices per parallel task\n"
+		"  --simd LEVEL       scalar, sse, avx2 or avx512\n"
+		"  --json PATH        Write the results as JSON, - for stdout\n";
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+bool ParseUnsigned(const std::string& text, unsigned int& value) {
+	char* end = nullptr;
+	unsigned long parsed = std::strtoul(text.c_str(), &end, 10);
+	if (text.empty() || *end != '\0' || text[0] == '-') {
+		return false;
+	}
+	value = (unsigned int)parsed;
+	return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string flag = argv[i];
+		if (flag == "--help" || flag == "-h" || i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (flag == "--sizes" || flag == "--threads") {
+			std::vector<unsigned int>& list = flag == "--sizes" ? options.sizes : options.threads;
+			list.clear();
+			for (const std::string& item : SplitList(value)) {
+				unsigned int number;
+				if (!ParseUnsigned(item, number) || (flag == "--sizes" && number == 0)) {
+					return false;
+				}
+				list.push_back(number);
+			}
+			if (list.empty()) {
+				return false;
+			}
+		} else if (flag == "--drivers") {
+			options.drivers = SplitList(value);
+			for (const std::string& driver : options.drivers) {
+				if (driver != "sphere" && driver != "grid") {
+					return false;
+				}
+			}
+		} else if (flag == "--modes") {
+			options.modes.clear();
+			for (const std::string& mode : SplitList(value)) {
+				if (mode != "matrix" && mode != "offset") {
+					return false;
+				}
+				options.modes.push_back(mode == "offset" ? kBindOffset : kBindMatrix);
+			}
+		} else if (flag == "--precisions") {
+			options.precisions.clear();
+			for (const std::string& precision : SplitList(value)) {
+				if (precision != "double" && precision != "float") {
+					return false;
+				}
+				options.precisions.push_back(precision == "float" ? kPrecisionFloat : kPrecisionDouble);
+			}
+		} else if (flag == "--orders") {
+			options.orders.clear();
+			for (const std::string& order : SplitList(value)) {
+				if (order != "mesh" && order != "locality") {
+					return false;
+				}
+				options.orders.push_back(order == "locality");
+			}
+		} else if (flag == "--frames") {
+			if (!ParseUnsigned(value, options.frames)) {
+				return false;
+			}
+		} else if (flag == "--driver-ratio") {
+			options.driverRatio = std::atof(value.c_str());
+			if (!(options.driverRatio > 0.0)) {
+				return false;
+			}
+		} else if (flag == "--grain") {
+			if (!ParseUnsigned(value, options.grainSize) || options.grainSize == 0) {
+				return false;
+			}
+		} else if (flag == "--simd") {
+			SimdLevel level = kSimdScalar;
+			bool found = false;
+			for (int l = kSimdScalar; l <= kSimdAvx512; ++l) {
+				if (value == GetSimdLevelName((SimdLevel)l)) {
+					level = (SimdLevel)l;
+					found = true;
+				}
+			}
+			if (!found) {
+				return false;
+			}
+			SetSimdLevel(level);
+		} else if (flag == "--json") {
+			options.jsonPath = value;
+		} else {
+			return false;
+		}
+	}
+	return !options.drivers.empty() && !options.modes.empty() && !options.precisions.empty() &&
+		!options.orders.empty();
+}
+
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage(argv[0]);
+		return 2;
+	}
+	if (options.threads.empty()) {
+		options.threads.push_back(1);
+		if (ThreadPool::Instance().threadCount() > 1) {
+			options.threads.push_back(0);
+		}
+	}
+	// The table goes to stderr when the JSON takes stdout
+	std::ostream& log = options.jsonPath == "-" ? std::cerr : std::cout;
+	log << "simd " << GetSimdLevelName(GetSimdLevel()) << ", "
+		<< ThreadPool::Instance().threadCount() << " threads\n";
+
+	// Smallest cases first, peak memory only grows
+	std::vector<unsigned int> sizes = options.sizes;
+	std::sort(sizes.begin(), sizes.end());
+	std::vector<CaseResult> results;
+	bool bindPoseKept = true;
+	for (unsigned int size : sizes) {
+		for (const std::string& driver : options.drivers) {
+			for (BindMode mode : options.modes) {
+				for (Precision precision : options.precisions) {
+					double maxRestError = precision == kPrecisionFloat ? options.maxFloatRestError : options.maxRestError;
+					for (bool locality : options.orders) {
+						for (unsigned int threads : options.threads) {
+							results.push_back(RunCase(options, driver, size, mode, precision, locality, threads));
+							if (results.back().restError > maxRestError) {
+								std::cerr << driver << " " << GetModeName(mode) << " " << GetPrecisionName(precision) << " "
+									<< GetOrderName(locality) << " " << size << ": deforming the bind pose moved points by "
+									<< results.back().restError << "\n";
+								bindPoseKept = false;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	ComputeSpeedups(results);
+	PrintTable(results, log);
+	PrintLocality(results, log);
+
+	if (options.jsonPath == "-") {
+		WriteJson(options, results, std::cout);
+	} else if (!options.jsonPath.empty()) {
+		std::ofstream file(options.jsonPath);
+		WriteJson(options, results, file);
+		if (!file) {
+			std::cerr << "Could not write " << options.jsonPath << "\n";
+			return 1;
+		}
+	}
+	return bindPoseKept ? 0 : 1;
+}
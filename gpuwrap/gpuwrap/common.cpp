@@ -1,53 +1,98 @@
 #include "common.h"
 
-#include <maya/MVector.h>
-
-void CalculateBasisComponents(const BaryCoords& coords,
-	const MIntArray& triangleVertices,
-	const MPointArray& points,
-	const MFloatVectorArray& normals,
-	MPoint& origin, MVector& up, MVector& normal) {
-	
-	// Use barycentric coordinates to calculate origin and normal
-	// Calculate origin
-	// calculate normal
-	origin = MPoint::origin;
-	normal = MVector::zero;
-	for (int i = 0; i < 3; ++i) {
-		origin += points[triangleVertices[i]] * coords[i];
-		normal += MVector(normals[triangleVertices[i]]) * coords[i];
-	}
-		
-	// calculate up vector
-	// The up vector will be the vector to the lowest weighted point on a barycentric system
-	// Find the lowest barycentric weight
-
-	float lowestWeight = coords[0];
-	int lowestVertexId = triangleVertices[0];
-	for (int i = 1; i < 3; i++) {
-		if (coords[i] < lowestWeight) {
-			lowestWeight = coords[i];
-			lowestVertexId = triangleVertices[i];
+#include <algorithm>
+
+void GetPointBuffer(const MPointArray& points, std::vector<double>& buffer) {
+	unsigned int count = points.length();
+	buffer.resize(count * 3);
+	for (unsigned int i = 0; i < count; ++i) {
+		const MPoint& point = points[i];
+		buffer[i * 3] = point.x;
+		buffer[i * 3 + 1] = point.y;
+		buffer[i * 3 + 2] = point.z;
+	}
+}
+
+void GetPointBuffer(const float* points, unsigned int count, const MMatrix& matrix, std::vector<double>& buffer) {
+	buffer.resize(count * 3);
+	if (matrix == MMatrix::identity) {
+		std::copy(points, points + count * 3, buffer.begin());
+		return;
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		double x = points[i * 3], y = points[i * 3 + 1], z = points[i * 3 + 2];
+		// Maya points are row vectors
+		for (int axis = 0; axis < 3; ++axis) {
+			buffer[i * 3 + axis] = x * matrix(0, axis) + y * matrix(1, axis) + z * matrix(2, axis) + matrix(3, axis);
+		}
+	}
+}
+
+void SetPointBuffer(const std::vector<double>& buffer, MPointArray& points, const unsigned int* order) {
+	unsigned int count = (unsigned int)buffer.size() / 3;
+	points.setLength(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		points[order != nullptr ? order[i] : i] = MPoint(buffer[i * 3], buffer[i * 3 + 1], buffer[i * 3 + 2]);
+	}
+}
+
+void SetPointBuffer(const std::vector<float>& buffer, MPointArray& points, const unsigned int* order) {
+	unsigned int count = (unsigned int)buffer.size() / 3;
+	points.setLength(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		points[order != nullptr ? order[i] : i] = MPoint(buffer[i * 3], buffer[i * 3 + 1], buffer[i * 3 + 2]);
+	}
+}
+
+template <typename Real>
+void SetPointBuffer(const Real* buffer, unsigned int begin, unsigned int end, const unsigned int* order,
+					MFloatPoint* points) {
+	for (unsigned int i = begin; i < end; ++i) {
+		points[order != nullptr ? order[i] : i] =
+			MFloatPoint((float)buffer[i * 3], (float)buffer[i * 3 + 1], (float)buffer[i * 3 + 2]);
+	}
+}
+
+template <typename Real>
+void SetPointBuffer(const Real* buffer, const unsigned int* indices, unsigned int count, const unsigned int* order,
+					MFloatPoint* points) {
+	for (unsigned int j = 0; j < count; ++j) {
+		unsigned int i = indices[j];
+		points[order != nullptr ? order[i] : i] =
+			MFloatPoint((float)buffer[i * 3], (float)buffer[i * 3 + 1], (float)buffer[i * 3 + 2]);
+	}
+}
+
+void GetNormalBuffer(const MFloatVectorArray& normals, std::vector<float>& buffer) {
+	unsigned int count = normals.length();
+	buffer.resize(count * 3);
+	for (unsigned int i = 0; i < count; ++i) {
+		const MFloatVector& normal = normals[i];
+		buffer[i * 3] = normal.x;
+		buffer[i * 3 + 1] = normal.y;
+		buffer[i * 3 + 2] = normal.z;
+	}
+}
+
+void GetMatrixBuffer(const MMatrix& matrix, double* buffer) {
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			buffer[row * 4 + column] = matrix(row, column);
+		}
+	}
+}
+
+MMatrix GetMatrix(const double* buffer) {
+	MMatrix matrix;
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			matrix[row][column] = buffer[row * 4 + column];
 		}
 	}
+	return matrix;
+}
 
-	up = points[lowestVertexId] - origin;
-	normal.normalize();
-	up.normalize();
-};
-
-void CreateMatrix(const MPoint& origin,
-				  const MVector& normal,
-				  const MVector& up,
-				  MMatrix& matrix)
-{
-	const MPoint& t = origin;
-	const MVector& y = normal;
-	MVector x = y ^ up;
-	MVector z = y ^ x;
-	matrix[0][0] = x.x; matrix[0][1] = x.y; matrix[0][2] = x.z; matrix[0][3] = 0.0;
-	matrix[1][0] = y.x; matrix[1][1] = y.y; matrix[1][2] = y.z; matrix[1][3] = 0.0;
-	matrix[2][0] = z.x; matrix[2][1] = z.y; matrix[2][2] = z.z; matrix[2][3] = 0.0;
-	matrix[3][0] = t.x; matrix[3][1] = t.y; matrix[3][2] = t.z; matrix[3][3] = 1.0;
-	
-}
\ No newline at end of file
+template void SetPointBuffer(const double*, unsigned int, unsigned int, const unsigned int*, MFloatPoint*);
+template void SetPointBuffer(const float*, unsigned int, unsigned int, const unsigned int*, MFloatPoint*);
+template void SetPointBuffer(const double*, const unsigned int*, unsigned int, const unsigned int*, MFloatPoint*);
+template void SetPointBuffer(const float*, const unsigned int*, unsigned int, const unsigned int*, MFloatPoint*);
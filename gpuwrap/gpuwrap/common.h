@@ -1,57 +1,92 @@
 /*
- * Contains helper functions
+ * Contains helper functions to move data between Maya types and the flat
+ * buffers used by the core wrap library.
  */
 
 #ifndef WRAP_COMMON_H
 #define WRAP_COMMON_H
-#include <maya/MIntArray.h>
+#include "core/wrapMath.h"
+#include "core/wrapKernel.h"
+
+#include <vector>
+
 #include <maya/MPointArray.h>
-#include <maya/MIntArray.h>
-#include <maya/MFloatVector.h>
-#include <maya/MPoint.h>
-#include <maya/MVector.h>
-#include <maya/MDoubleArray.h>
+#include <maya/MFloatPointArray.h>
 #include <maya/MFloatVectorArray.h>
 #include <maya/MMatrix.h>
 
 
 /**
- * Helper struct to hold the 3 barycentric coordinates
- *
+ * Copies Maya points into an xyz buffer
+ * @param[in] points Maya points
+ * @param[out] buffer 3 doubles per point
  */
+void GetPointBuffer(const MPointArray& points, std::vector<double>& buffer);
 
-struct BaryCoords {
-	float coords[3];
-	float operator[](int index) const { return coords[index]; }
-	float& operator[](int index) { return coords[index]; }
-};
+/**
+ * Copies raw mesh points into an xyz buffer, without the MPointArray of getPoints
+ * @param[in] points 3 floats per point, from MFnMesh::getRawPoints
+ * @param[in] count Number of points
+ * @param[in] matrix Applied to every point, the transform of the geometry data for world space
+ * @param[out] buffer 3 doubles per point
+ */
+void GetPointBuffer(const float* points, unsigned int count, const MMatrix& matrix, std::vector<double>& buffer);
 
+/**
+ * Copies an xyz buffer back into Maya points
+ * @param[in] buffer 3 doubles per point
+ * @param[out] points Maya points, resized to the buffer length
+ * @param[in] order Maya point of each buffer point, null for the buffer order
+ */
+void SetPointBuffer(const std::vector<double>& buffer, MPointArray& points, const unsigned int* order = nullptr);
 
+/**
+ * Copies a float xyz buffer back into Maya points
+ * @param[in] buffer 3 floats per point
+ * @param[out] points Maya points, resized to the buffer length
+ * @param[in] order Maya point of each buffer point, null for the buffer order
+ */
+void SetPointBuffer(const std::vector<float>& buffer, MPointArray& points, const unsigned int* order = nullptr);
 
 /**
- * Calculates the components necessary to create a wrap basis matrix
- * @param[in] coords The barycentric coordinates of the closest point
- * @param[in] triangleVertices The vertex ids forming the triangle of the closest point.
- * @param[in] points The driver point array
- * @param[in] normals the driver per-vertex normal array
- * @param[out] origin The origin of the coordinate system
- * @param[out] up The up vector of the coordinate system
- * @param[out] normal The normal vector of the coordinate system
-*/
+ * Copies a range of an xyz buffer into Maya float points, as MFnMesh::setPoints takes them
+ * @param[in] buffer 3 scalars per point
+ * @param[in] begin First buffer point to copy
+ * @param[in] end One past the last buffer point to copy
+ * @param[in] order Maya point of each buffer point, null for the buffer order
+ * @param[out] points Maya float points, as many as the buffer
+ */
+template <typename Real>
+void SetPointBuffer(const Real* buffer, unsigned int begin, unsigned int end, const unsigned int* order,
+					MFloatPoint* points);
 
-void CalculateBasisComponents(const BaryCoords& coords,
-							  const MIntArray& triangleVertices,
-						      const MPointArray& points,
-							  const MFloatVectorArray& normals,
-							  MPoint& origin, MVector& up, MVector& normal);
+/**
+ * Copies some points of an xyz buffer into Maya float points, leaving the others alone
+ * @param[in] buffer 3 scalars per point
+ * @param[in] indices Buffer points to copy
+ * @param[in] count Number of indices
+ * @param[in] order Maya point of each buffer point, null for the buffer order
+ * @param[out] points Maya float points, as many as the buffer
+ */
+template <typename Real>
+void SetPointBuffer(const Real* buffer, const unsigned int* indices, unsigned int count, const unsigned int* order,
+					MFloatPoint* points);
 
-/*
- * Creates an orthonormal basis using the given point and two axes.
- * @param[in] origin Position
- * @param[in] normal Normal Vector
- * @param[in] up Up vector
- * @param[out] matrix Generated matrix
+/**
+ * Copies Maya normals into an xyz buffer
+ * @param[in] normals Maya normals
+ * @param[out] buffer 3 floats per normal
+ */
+void GetNormalBuffer(const MFloatVectorArray& normals, std::vector<float>& buffer);
+
+/**
+ * Copies an MMatrix into 16 doubles
+ */
+void GetMatrixBuffer(const MMatrix& matrix, double* buffer);
+
+/**
+ * Creates an MMatrix from 16 doubles
  */
-void CreateMatrix(const MPoint& origin, const MVector& normal, const MVector& up, MMatrix& matrix);
+MMatrix GetMatrix(const double* buffer);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Array of a stored binding that can view read-only memory, such as a
+ * memory-mapped bind cache, instead of owning a copy.
+ */
+
+#ifndef WRAP_CORE_BIND_ARRAY_H
+#define WRAP_CORE_BIND_ARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * A std::vector like array that either owns its elements or views memory
+ * kept alive by a shared owner. Reading a view copies nothing, anything that
+ * can write copies the elements into owned storage first, so a view is
+ * never written through. Const access is what the deform kernels use.
+ */
+template <typename T>
+class BindArray {
+public:
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+
+	BindArray() : view_(nullptr), viewSize_(0) {}
+
+	size_t size() const { return view_ != nullptr ? viewSize_ : storage_.size(); }
+	bool empty() const { return size() == 0; }
+	/**
+	 * @return Elements allocated by this array, 0 for a view
+	 */
+	size_t capacity() const { return view_ != nullptr ? 0 : storage_.capacity(); }
+	/**
+	 * @return true if the elements are viewed rather than owned
+	 */
+	bool isView() const { return view_ != nullptr; }
+
+	const T* data() const { return view_ != nullptr ? view_ : storage_.data(); }
+	T* data() { Detach(); return storage_.data(); }
+	const T& operator[](size_t i) const { return data()[i]; }
+	T& operator[](size_t i) { Detach(); return storage_[i]; }
+	const T& back() const { return data()[size() - 1]; }
+	T& back() { Detach(); return storage_.back(); }
+	const_iterator begin() const { return data(); }
+	const_iterator end() const { return data() + size(); }
+	iterator begin() { return data(); }
+	iterator end() { return data() + size(); }
+
+	void resize(size_t count) { Detach(); storage_.resize(count); }
+	void resize(size_t count, const T& value) { Detach(); storage_.resize(count, value); }
+	void assign(size_t count, const T& value) { Release(); storage_.assign(count, value); }
+	template <typename Iterator>
+	void assign(Iterator first, Iterator last) { Release(); storage_.assign(first, last); }
+	void clear() { Release(); storage_.clear(); }
+	void shrink_to_fit() { storage_.shrink_to_fit(); }
+
+	/**
+	 * Views count elements at data instead of owning them
+	 * @param[in] data First element, has to stay valid while owner is alive
+	 * @param[in] count Number of elements
+	 * @param[in] owner Keeps the memory alive, shared by every copy of the view
+	 */
+	void SetView(const T* data, size_t count, const std::shared_ptr<const void>& owner) {
+		storage_.clear();
+		storage_.shrink_to_fit();
+		view_ = count > 0 ? data : nullptr;
+		viewSize_ = count;
+		owner_ = count > 0 ? owner : nullptr;
+	}
+
+private:
+	void Detach() {
+		if (view_ != nullptr) {
+			storage_.assign(view_, view_ + viewSize_);
+			Release();
+		}
+	}
+
+	void Release() {
+		view_ = nullptr;
+		viewSize_ = 0;
+		owner_.reset();
+	}
+
+	std::vector<T> storage_;
+	const T* view_; // Viewed elements, null when owning
+	size_t viewSize_;
+	std::shared_ptr<const void> owner_;
+};
+
+template <typename T>
+bool operator==(const BindArray<T>& a, const BindArray<T>& b) {
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T>
+bool operator!=(const BindArray<T>& a, const BindArray<T>& b) {
+	return !(a == b);
+}
+
+#endif
@@ -0,0 +1,289 @@
+#include "bindCache.h"
+#include "mappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace {
+
+const char kMagic[4] = { 'A', 'W', 'W', 'C' };
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlignment = 64;
+
+struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t mode;
+	uint64_t key;
+	uint32_t normals;
+	uint32_t count;
+	uint32_t sampleCount;
+	uint32_t orderCount;
+	uint64_t fileSize;
+};
+
+/**
+ * Where each array of a cache file starts
+ */
+struct CacheLayout {
+	size_t triangleVerts;
+	size_t coords;
+	size_t bindMatrices;
+	size_t offsets;
+	size_t sampleOffsets;
+	size_t sampleVertices;
+	size_t sampleWeights;
+	size_t vertexOrder;
+	size_t fileSize;
+};
+
+size_t AlignUp(size_t offset) {
+	return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+CacheLayout GetLayout(uint32_t mode, uint64_t count, uint64_t sampleCount, uint64_t orderCount) {
+	CacheLayout layout;
+	size_t offset = AlignUp(sizeof(CacheHeader));
+	auto place = [&](size_t bytes) {
+		size_t start = offset;
+		offset = AlignUp(offset + bytes);
+		return start;
+	};
+	layout.triangleVerts = place(count * 3 * sizeof(int32_t));
+	layout.coords = place(count * sizeof(BaryCoords));
+	layout.bindMatrices = place(mode == kBindMatrix ? count * 16 * sizeof(double) : 0);
+	layout.offsets = place(mode == kBindOffset ? count * 3 * sizeof(float) : 0);
+	layout.sampleOffsets = place(sampleCount > 0 ? (count + 1) * sizeof(uint32_t) : 0);
+	layout.sampleVertices = place(sampleCount * sizeof(int32_t));
+	layout.sampleWeights = place(sampleCount * sizeof(float));
+	layout.vertexOrder = place(orderCount * sizeof(uint32_t));
+	layout.fileSize = offset;
+	return layout;
+}
+
+/**
+ * 64-bit hash over 8 byte words, murmur style mixing
+ */
+class Hasher {
+public:
+	Hasher() : hash_(0x9E3779B97F4A7C15ull) {}
+
+	void Add(const void* data, size_t size) {
+		AddWord(size);
+		const unsigned char* bytes = (const unsigned char*)data;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i, 8);
+			AddWord(word);
+		}
+		if (i < size) {
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + i, size - i);
+			AddWord(word);
+		}
+	}
+
+	void AddWord(uint64_t word) {
+		word *= 0x87C37B91114253D5ull;
+		word = (word << 31) | (word >> 33);
+		word *= 0x4CF5AD432745937Full;
+		hash_ ^= word;
+		hash_ = ((hash_ << 27) | (hash_ >> 37)) * 5 + 0x52DCE729;
+	}
+
+	uint64_t Finish() const {
+		uint64_t hash = hash_;
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+private:
+	uint64_t hash_;
+};
+
+template <typename Array>
+void WriteAligned(std::ostream& stream, const Array& values, size_t offset) {
+	static const char kPadding[kAlignment] = {};
+	size_t position = (size_t)stream.tellp();
+	if (position < offset) {
+		stream.write(kPadding, offset - position);
+	}
+	if (!values.empty()) {
+		stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(typename Array::value_type));
+	}
+}
+
+template <typename T>
+void SetView(BindArray<T>& array, const std::shared_ptr<const MappedFile>& file, size_t offset, size_t count) {
+	array.SetView(reinterpret_cast<const T*>(file->data() + offset), count, file);
+}
+
+}
+
+uint64_t HashBindInputs(const double* driverPoints, unsigned int driverVertexCount,
+						const int* triangleVertices, unsigned int triangleCount,
+						const double* drivenPoints, unsigned int drivenCount,
+						BindMode mode, const SampleSettings& settings) {
+	Hasher hasher;
+	hasher.Add(driverPoints, driverVertexCount * 3 * sizeof(double));
+	hasher.Add(triangleVertices, triangleCount * 3 * sizeof(int));
+	hasher.Add(drivenPoints, drivenCount * 3 * sizeof(double));
+	hasher.AddWord((uint64_t)mode);
+	// Bindings made with the built-in normals only
+	hasher.AddWord((uint64_t)kAreaWeightedNormals);
+	// Without a radius the influences make no difference to the binding
+	if (settings.radius > 0.0) {
+		uint64_t radius;
+		std::memcpy(&radius, &settings.radius, sizeof(radius));
+		hasher.AddWord(radius);
+		hasher.AddWord(settings.maxInfluences);
+	}
+	return hasher.Finish();
+}
+
+std::string GetBindCacheFileName(uint64_t key) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.awwc", (unsigned long long)key);
+	return name;
+}
+
+bool WriteBindCache(const std::string& path, uint64_t key, const WrapBinding& binding) {
+	uint32_t sampleCount = binding.hasSamples() ? (uint32_t)binding.sampleVertices.size() : 0;
+	uint32_t orderCount = (uint32_t)binding.vertexOrder.size();
+	CacheLayout layout = GetLayout(binding.mode, binding.size(), sampleCount, orderCount);
+	CacheHeader header = {};
+	std::memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kBindCacheFormatVersion;
+	header.byteOrder = kByteOrderMark;
+	header.mode = (uint32_t)binding.mode;
+	header.key = key;
+	header.normals = (uint32_t)binding.normals;
+	header.count = binding.size();
+	header.sampleCount = sampleCount;
+	header.orderCount = orderCount;
+	header.fileSize = layout.fileSize;
+
+	// A name no other writer of the same key uses, several machines may bind the same asset at once
+	size_t unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+		(size_t)std::chrono::steady_clock::now().time_since_epoch().count();
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ".%zx.tmp", unique);
+	std::string temporaryPath = path + suffix;
+	{
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteAligned(stream, binding.triangleVerts, layout.triangleVerts);
+		WriteAligned(stream, binding.coords, layout.coords);
+		if (binding.mode == kBindMatrix) {
+			WriteAligned(stream, binding.bindMatrices, layout.bindMatrices);
+		} else {
+			WriteAligned(stream, binding.offsets, layout.offsets);
+		}
+		if (sampleCount > 0) {
+			WriteAligned(stream, binding.sampleOffsets, layout.sampleOffsets);
+			WriteAligned(stream, binding.sampleVertices, layout.sampleVertices);
+			WriteAligned(stream, binding.sampleWeights, layout.sampleWeights);
+		}
+		if (orderCount > 0) {
+			WriteAligned(stream, binding.vertexOrder, layout.vertexOrder);
+		}
+		// Pad the end so the file size matches the layout
+		BindArray<char> none;
+		WriteAligned(stream, none, layout.fileSize);
+		if (!stream) {
+			stream.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		// Windows does not rename over an existing file
+		std::remove(path.c_str());
+		if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ReadBindCache(const std::string& path, WrapBinding& binding, uint64_t* key) {
+	binding.clear();
+	std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+	if (!file || file->size() < sizeof(CacheHeader)) {
+		return false;
+	}
+	CacheHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+		header.version != kBindCacheFormatVersion ||
+		header.byteOrder != kByteOrderMark ||
+		header.mode > kBindOffset ||
+		header.normals > kAreaWeightedNormals ||
+		(header.orderCount != 0 && header.orderCount != header.count)) {
+		return false;
+	}
+	CacheLayout layout = GetLayout(header.mode, header.count, header.sampleCount, header.orderCount);
+	if (header.fileSize != layout.fileSize || file->size() != layout.fileSize) {
+		// Truncated or written by something else
+		return false;
+	}
+
+	uint32_t count = header.count, sampleCount = header.sampleCount;
+	const char* data = file->data();
+	const int32_t* triangleVerts = reinterpret_cast<const int32_t*>(data + layout.triangleVerts);
+	bool valid = true;
+	for (size_t i = 0; valid && i < (size_t)count * 3; ++i) {
+		valid = triangleVerts[i] >= 0;
+	}
+	if (valid && sampleCount > 0) {
+		// Rows have to be in order and cover the samples exactly
+		const uint32_t* sampleOffsets = reinterpret_cast<const uint32_t*>(data + layout.sampleOffsets);
+		const int32_t* sampleVertices = reinterpret_cast<const int32_t*>(data + layout.sampleVertices);
+		valid = sampleOffsets[0] == 0 && sampleOffsets[count] == sampleCount;
+		for (uint32_t i = 0; valid && i < count; ++i) {
+			valid = sampleOffsets[i] <= sampleOffsets[i + 1];
+		}
+		for (uint32_t i = 0; valid && i < sampleCount; ++i) {
+			valid = sampleVertices[i] >= 0;
+		}
+	}
+	if (valid && header.orderCount > 0) {
+		valid = IsPermutation(reinterpret_cast<const uint32_t*>(data + layout.vertexOrder), count);
+	}
+	if (!valid) {
+		return false;
+	}
+
+	binding.mode = (BindMode)header.mode;
+	binding.normals = (DriverNormals)header.normals;
+	SetView(binding.triangleVerts, file, layout.triangleVerts, (size_t)count * 3);
+	SetView(binding.coords, file, layout.coords, count);
+	if (binding.mode == kBindMatrix) {
+		SetView(binding.bindMatrices, file, layout.bindMatrices, (size_t)count * 16);
+	} else {
+		SetView(binding.offsets, file, layout.offsets, (size_t)count * 3);
+	}
+	if (sampleCount > 0) {
+		SetView(binding.sampleOffsets, file, layout.sampleOffsets, (size_t)count + 1);
+		SetView(binding.sampleVertices, file, layout.sampleVertices, sampleCount);
+		SetView(binding.sampleWeights, file, layout.sampleWeights, sampleCount);
+	}
+	if (header.orderCount > 0) {
+		SetView(binding.vertexOrder, file, layout.vertexOrder, count);
+	}
+	if (key != nullptr) {
+		*key = header.key;
+	}
+	return true;
+}
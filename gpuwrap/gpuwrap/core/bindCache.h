@@ -0,0 +1,80 @@
+/*
+ * External bind cache files, keyed by a hash of everything a binding is made
+ * from, so rebinding an unchanged asset is a file lookup and a node can
+ * deform straight out of the memory-mapped file.
+ *
+ * Layout, little-endian, every array starting at a multiple of 64 bytes so it
+ * can be used in place:
+ *   char[4]  magic "AWWC"
+ *   uint32   cache format version
+ *   uint32   byte order mark 0x01020304
+ *   uint32   bind mode
+ *   uint64   key, HashBindInputs of the binding
+ *   uint32   driver normals
+ *   uint32   driven vertex count
+ *   uint32   sample count, 0 without samples
+ *   uint32   vertex order count, 0 or count
+ *   uint64   file size
+ *   int32    triangleVerts[count * 3]
+ *   float    coords[count * 3]
+ *   double   bindMatrices[count * 16]   kBindMatrix only
+ *   float    offsets[count * 3]         kBindOffset only
+ *   uint32   sampleOffsets[count + 1]   only with samples
+ *   int32    sampleVertices[samples]    only with samples
+ *   float    sampleWeights[samples]     only with samples
+ *   uint32   vertexOrder[count]         only with a vertex order
+ */
+
+#ifndef WRAP_CORE_BIND_CACHE_H
+#define WRAP_CORE_BIND_CACHE_H
+
+#include "wrapKernel.h"
+
+#include <cstdint>
+#include <string>
+
+/** Version written by WriteBindCache, older or newer files are rebound */
+const unsigned int kBindCacheFormatVersion = 2;
+
+/**
+ * Hashes everything BindPoints makes a binding from. Equal inputs always give
+ * the same key, on any machine of the same byte order.
+ * @param[in] driverPoints World space driver points, 3 doubles per vertex
+ * @param[in] driverVertexCount Number of driver vertices
+ * @param[in] triangleVertices Driver triangles, 3 vertex ids each
+ * @param[in] triangleCount Number of driver triangles
+ * @param[in] drivenPoints World space driven points, 3 doubles per vertex
+ * @param[in] drivenCount Number of driven vertices
+ * @param[in] mode How the binding is stored
+ * @param[in] settings Sampling of the binding
+ * @return The key of the binding
+ */
+uint64_t HashBindInputs(const double* driverPoints, unsigned int driverVertexCount,
+						const int* triangleVertices, unsigned int triangleCount,
+						const double* drivenPoints, unsigned int drivenCount,
+						BindMode mode, const SampleSettings& settings);
+
+/**
+ * @return The file name of the binding with the key, without a directory
+ */
+std::string GetBindCacheFileName(uint64_t key);
+
+/**
+ * Writes a binding to a cache file. The file is written next to path first
+ * and renamed into place, so readers never see a partial file.
+ * @return false if the file could not be written
+ */
+bool WriteBindCache(const std::string& path, uint64_t key, const WrapBinding& binding);
+
+/**
+ * Maps a cache file and points the stored arrays of the binding into it, so
+ * nothing is copied until the binding is modified. The mapping stays alive as
+ * long as a binding uses it.
+ * @param[in] path Cache file
+ * @param[out] binding Binding viewing the file, cleared on failure
+ * @param[out] key Key stored in the file, may be null
+ * @return false if the file is missing, of another version or corrupt
+ */
+bool ReadBindCache(const std::string& path, WrapBinding& binding, uint64_t* key = nullptr);
+
+#endif
@@ -0,0 +1,148 @@
+#include "mappedFile.h"
+
+#include <map>
+#include <mutex>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * What a path looked like on disk when it was mapped
+ */
+struct FileIdentity {
+	long long size = -1;
+	long long modified = 0;
+	long long modifiedNanoseconds = 0;
+	unsigned long long node = 0;
+
+	bool operator==(const FileIdentity& other) const {
+		return size == other.size && modified == other.modified &&
+			modifiedNanoseconds == other.modifiedNanoseconds && node == other.node;
+	}
+};
+
+bool GetFileIdentity(const std::string& path, FileIdentity& identity) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0) {
+		return false;
+	}
+	identity.node = 0;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return false;
+	}
+	identity.node = (unsigned long long)info.st_ino;
+	// A replaced file can get the inode of the one it replaced back within the same second
+#ifdef __APPLE__
+	identity.modifiedNanoseconds = (long long)info.st_mtimespec.tv_nsec;
+#else
+	identity.modifiedNanoseconds = (long long)info.st_mtim.tv_nsec;
+#endif
+#endif
+	identity.size = (long long)info.st_size;
+	identity.modified = (long long)info.st_mtime;
+	return true;
+}
+
+struct OpenFile {
+	FileIdentity identity;
+	std::weak_ptr<const MappedFile> file;
+};
+
+std::mutex openFilesMutex;
+std::map<std::string, OpenFile> openFiles;
+
+}
+
+MappedFile::MappedFile() : data_(nullptr), size_(0) {
+#ifdef _WIN32
+	file_ = INVALID_HANDLE_VALUE;
+	mapping_ = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data_ != nullptr) {
+		UnmapViewOfFile(data_);
+	}
+	if (mapping_ != nullptr) {
+		CloseHandle(mapping_);
+	}
+	if (file_ != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_);
+	}
+#else
+	if (data_ != nullptr) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& path) {
+	FileIdentity identity;
+	if (!GetFileIdentity(path, identity) || identity.size <= 0) {
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(openFilesMutex);
+	OpenFile& openFile = openFiles[path];
+	std::shared_ptr<const MappedFile> shared = openFile.file.lock();
+	if (shared && openFile.identity == identity) {
+		return shared;
+	}
+
+	// Not mapped yet, or replaced on disk since. Mappings of the old file stay valid.
+	std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+	file->file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file->file_ == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file->file_, &size) || size.QuadPart <= 0) {
+		return nullptr;
+	}
+	file->mapping_ = CreateFileMappingA(file->file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (file->mapping_ == nullptr) {
+		return nullptr;
+	}
+	file->data_ = (const char*)MapViewOfFile(file->mapping_, FILE_MAP_READ, 0, 0, 0);
+	if (file->data_ == nullptr) {
+		return nullptr;
+	}
+	file->size_ = (size_t)size.QuadPart;
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return nullptr;
+	}
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+		close(descriptor);
+		return nullptr;
+	}
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	// The mapping keeps the file alive on its own
+	close(descriptor);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+	file->data_ = (const char*)data;
+	file->size_ = (size_t)info.st_size;
+#endif
+	openFile.identity = identity;
+	openFile.file = file;
+	return file;
+}
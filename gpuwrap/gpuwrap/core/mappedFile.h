@@ -0,0 +1,43 @@
+/*
+ * Read-only memory mapping of a whole file.
+ */
+
+#ifndef WRAP_CORE_MAPPED_FILE_H
+#define WRAP_CORE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * A file mapped read-only into memory, unmapped when the last reference goes
+ */
+class MappedFile {
+public:
+	/**
+	 * Maps a file. Opening a path that is still mapped and unchanged on disk
+	 * shares the mapping, so several nodes reading one file only map it once.
+	 * @param[in] path File to map
+	 * @return null if the file can not be opened or mapped, or is empty
+	 */
+	static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	MappedFile();
+
+	const char* data_;
+	size_t size_;
+#ifdef _WIN32
+	void* file_;
+	void* mapping_;
+#endif
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "outputCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t kPrime3 = 0x165667B19E3779F9ull;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const unsigned char* bytes) {
+	uint64_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+inline uint32_t Read32(const unsigned char* bytes) {
+	uint32_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+	accumulator += input * kPrime2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator) {
+	hash ^= Round(0, accumulator);
+	return hash * kPrime1 + kPrime4;
+}
+
+}
+
+uint64_t HashBuffer(const void* data, size_t size, uint64_t seed) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned char* end = bytes + size;
+	uint64_t hash;
+	if (size >= 32) {
+		// Four lanes over 32 byte stripes, each lane only depends on itself
+		uint64_t lane0 = seed + kPrime1 + kPrime2;
+		uint64_t lane1 = seed + kPrime2;
+		uint64_t lane2 = seed;
+		uint64_t lane3 = seed - kPrime1;
+		const unsigned char* lastStripe = end - 32;
+		do {
+			lane0 = Round(lane0, Read64(bytes));
+			lane1 = Round(lane1, Read64(bytes + 8));
+			lane2 = Round(lane2, Read64(bytes + 16));
+			lane3 = Round(lane3, Read64(bytes + 24));
+			bytes += 32;
+		} while (bytes <= lastStripe);
+		hash = RotateLeft(lane0, 1) + RotateLeft(lane1, 7) + RotateLeft(lane2, 12) + RotateLeft(lane3, 18);
+		hash = MergeRound(hash, lane0);
+		hash = MergeRound(hash, lane1);
+		hash = MergeRound(hash, lane2);
+		hash = MergeRound(hash, lane3);
+	} else {
+		hash = seed + kPrime5;
+	}
+	hash += (uint64_t)size;
+
+	for (; bytes + 8 <= end; bytes += 8) {
+		hash ^= Round(0, Read64(bytes));
+		hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+	}
+	if (bytes + 4 <= end) {
+		hash ^= (uint64_t)Read32(bytes) * kPrime1;
+		hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+		bytes += 4;
+	}
+	for (; bytes < end; ++bytes) {
+		hash ^= (*bytes) * kPrime5;
+		hash = RotateLeft(hash, 11) * kPrime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+void OutputCache::SetCapacity(unsigned int capacity) {
+	capacity_ = capacity;
+	if (entries_.size() > capacity_) {
+		entries_.resize(capacity_);
+	}
+}
+
+const std::vector<float>* OutputCache::Find(uint64_t key) {
+	for (size_t i = 0; i < entries_.size(); ++i) {
+		if (entries_[i].key == key) {
+			// Only a few outputs are kept, moving them costs a few pointer swaps
+			std::rotate(entries_.begin(), entries_.begin() + i, entries_.begin() + i + 1);
+			return &entries_.front().points;
+		}
+	}
+	return nullptr;
+}
+
+std::vector<float>* OutputCache::Insert(uint64_t key) {
+	if (capacity_ == 0) {
+		return nullptr;
+	}
+	if (entries_.size() < capacity_) {
+		entries_.push_back(Entry());
+	}
+	// The least recently used entry, or the new one, becomes the most recent
+	std::rotate(entries_.begin(), entries_.end() - 1, entries_.end());
+	Entry& entry = entries_.front();
+	entry.key = key;
+	return &entry.points;
+}
+
+void OutputCache::clear() {
+	std::vector<Entry>().swap(entries_);
+}
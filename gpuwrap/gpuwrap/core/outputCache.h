@@ -0,0 +1,73 @@
+/*
+ * Memoized deform outputs. Scrubbing back and forth and renders that evaluate
+ * a frame several times deform the same driver and input again, so the last
+ * outputs are kept by a hash of everything the deform read and copied back
+ * instead of being deformed again.
+ */
+
+#ifndef WRAP_CORE_OUTPUT_CACHE_H
+#define WRAP_CORE_OUTPUT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 64-bit XXH64 hash of a buffer. The four independent accumulators keep every
+ * multiplier busy, so a buffer is hashed at several bytes per cycle, far less
+ * than a deform costs per vertex.
+ * @param[in] data Bytes to hash
+ * @param[in] size Number of bytes
+ * @param[in] seed Chains hashes, the hash of the previous buffer
+ */
+uint64_t HashBuffer(const void* data, size_t size, uint64_t seed = 0);
+
+/**
+ * The outputs of the last few evaluations of one geometry, most recently used first
+ */
+class OutputCache {
+public:
+	OutputCache() : capacity_(0) {}
+
+	/**
+	 * Sets how many outputs are kept, dropping the least recently used ones
+	 * @param[in] capacity Outputs kept, 0 to keep none
+	 */
+	void SetCapacity(unsigned int capacity);
+	unsigned int capacity() const { return capacity_; }
+
+	/**
+	 * @return The number of outputs kept
+	 */
+	unsigned int size() const { return (unsigned int)entries_.size(); }
+
+	/**
+	 * Looks up an output and makes it the most recently used
+	 * @param[in] key Hash of the inputs the output was deformed from
+	 * @return The output points, null if it is not kept
+	 */
+	const std::vector<float>* Find(uint64_t key);
+
+	/**
+	 * Makes room for a new output, reusing the memory of the least recently used one when full
+	 * @param[in] key Hash of the inputs the output is deformed from
+	 * @return The buffer to store the output points in, null with a capacity of 0
+	 */
+	std::vector<float>* Insert(uint64_t key);
+
+	/**
+	 * Drops every output, when something outside of the key changed the results
+	 */
+	void clear();
+
+private:
+	struct Entry {
+		uint64_t key;
+		std::vector<float> points;
+	};
+
+	std::vector<Entry> entries_; // Most recently used first
+	unsigned int capacity_; // Most entries kept
+};
+
+#endif
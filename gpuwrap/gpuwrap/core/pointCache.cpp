@@ -0,0 +1,202 @@
+#include "pointCache.h"
+#include "mappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = { 'A', 'W', 'P', 'C' };
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kFramesOffset = 64;
+
+struct PointCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t vertexCount;
+	uint32_t chunkFrames;
+	uint32_t frameCount;
+	double startFrame;
+	double frameStep;
+};
+
+bool WriteHeader(std::ostream& stream, const PointCacheInfo& info) {
+	PointCacheHeader header = {};
+	std::memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kPointCacheFormatVersion;
+	header.byteOrder = kByteOrderMark;
+	header.vertexCount = info.vertexCount;
+	header.chunkFrames = info.chunkFrames;
+	header.frameCount = info.frameCount;
+	header.startFrame = info.startFrame;
+	header.frameStep = info.frameStep;
+	char bytes[kFramesOffset] = {};
+	std::memcpy(bytes, &header, sizeof(header));
+	stream.seekp(0);
+	stream.write(bytes, sizeof(bytes));
+	return (bool)stream;
+}
+
+size_t FrameFloats(const PointCacheInfo& info) {
+	return (size_t)info.vertexCount * 3;
+}
+
+}
+
+PointCacheWriter::PointCacheWriter()
+	: nextChunk_(0), writing_(nullptr), closing_(false), failed_(false) {}
+
+PointCacheWriter::~PointCacheWriter() {
+	Abort();
+}
+
+bool PointCacheWriter::Open(const std::string& path, const PointCacheInfo& info) {
+	Abort();
+	info_ = info;
+	info_.chunkFrames = info.chunkFrames > 0 ? info.chunkFrames : 1;
+	info_.frameCount = 0;
+	path_ = path;
+	temporaryPath_ = path + ".tmp";
+	stream_.open(temporaryPath_, std::ios::binary | std::ios::trunc);
+	// The frame count is filled in by Close
+	if (!stream_ || !WriteHeader(stream_, info_)) {
+		Abort();
+		return false;
+	}
+	for (Chunk& chunk : chunks_) {
+		chunk.points.resize(info_.chunkFrames * FrameFloats(info_));
+		chunk.frameCount = 0;
+	}
+	nextChunk_ = 0;
+	closing_ = false;
+	failed_ = false;
+	writer_ = std::thread(&PointCacheWriter::WriterLoop, this);
+	return true;
+}
+
+float* PointCacheWriter::AcquireChunk() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	Chunk* chunk = &chunks_[nextChunk_];
+	condition_.wait(lock, [&] {
+		return writing_ != chunk && std::find(queue_.begin(), queue_.end(), chunk) == queue_.end();
+	});
+	return chunk->points.data();
+}
+
+void PointCacheWriter::SubmitChunk(unsigned int frameCount) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Chunk* chunk = &chunks_[nextChunk_];
+		chunk->frameCount = std::min(frameCount, info_.chunkFrames);
+		queue_.push_back(chunk);
+		nextChunk_ ^= 1;
+	}
+	condition_.notify_all();
+}
+
+void PointCacheWriter::WriterLoop() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		condition_.wait(lock, [&] { return !queue_.empty() || closing_; });
+		if (queue_.empty()) {
+			return;
+		}
+		writing_ = queue_.front();
+		queue_.pop_front();
+		bool failed = failed_;
+		lock.unlock();
+		// The caller fills the other chunk meanwhile
+		if (!failed) {
+			stream_.write(reinterpret_cast<const char*>(writing_->points.data()),
+						  writing_->frameCount * FrameFloats(info_) * sizeof(float));
+			failed = !stream_;
+		}
+		lock.lock();
+		if (!failed) {
+			info_.frameCount += writing_->frameCount;
+		}
+		failed_ = failed;
+		writing_ = nullptr;
+		condition_.notify_all();
+	}
+}
+
+void PointCacheWriter::Finish() {
+	if (!writer_.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closing_ = true;
+	}
+	condition_.notify_all();
+	writer_.join();
+}
+
+bool PointCacheWriter::Close() {
+	if (!stream_.is_open()) {
+		return false;
+	}
+	Finish();
+	bool written = !failed_ && WriteHeader(stream_, info_);
+	stream_.close();
+	written = written && !stream_.fail();
+	if (written && std::rename(temporaryPath_.c_str(), path_.c_str()) != 0) {
+		// Windows does not rename over an existing file
+		std::remove(path_.c_str());
+		written = std::rename(temporaryPath_.c_str(), path_.c_str()) == 0;
+	}
+	if (!written) {
+		std::remove(temporaryPath_.c_str());
+	}
+	for (Chunk& chunk : chunks_) {
+		std::vector<float>().swap(chunk.points);
+	}
+	return written;
+}
+
+void PointCacheWriter::Abort() {
+	Finish();
+	queue_.clear();
+	if (stream_.is_open()) {
+		stream_.close();
+		std::remove(temporaryPath_.c_str());
+	}
+}
+
+bool PointCacheReader::Open(const std::string& path) {
+	file_.reset();
+	info_ = PointCacheInfo();
+	std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+	if (!file || file->size() < kFramesOffset) {
+		return false;
+	}
+	PointCacheHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+		header.version != kPointCacheFormatVersion ||
+		header.byteOrder != kByteOrderMark ||
+		header.chunkFrames == 0) {
+		return false;
+	}
+	PointCacheInfo info;
+	info.vertexCount = header.vertexCount;
+	info.chunkFrames = header.chunkFrames;
+	info.frameCount = header.frameCount;
+	info.startFrame = header.startFrame;
+	info.frameStep = header.frameStep;
+	if (file->size() != kFramesOffset + (uint64_t)info.frameCount * FrameFloats(info) * sizeof(float)) {
+		// Truncated or written by something else
+		return false;
+	}
+	file_ = file;
+	info_ = info;
+	return true;
+}
+
+const float* PointCacheReader::frame(unsigned int frame) const {
+	return reinterpret_cast<const float*>(file_->data() + kFramesOffset) + frame * FrameFloats(info_);
+}
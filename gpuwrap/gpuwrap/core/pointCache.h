@@ -0,0 +1,143 @@
+/*
+ * Baked point caches, the deformed points of one geometry over a frame range.
+ * Frames are written in chunks by a background thread while the next chunk is
+ * deformed, and read back by mapping the file.
+ *
+ * Layout, little-endian, the frames starting at byte 64:
+ *   char[4]  magic "AWPC"
+ *   uint32   point cache format version
+ *   uint32   byte order mark 0x01020304
+ *   uint32   vertex count
+ *   uint32   frames per chunk
+ *   uint32   frame count
+ *   double   first frame
+ *   double   frame step
+ *   float    points[frames][count * 3]
+ */
+
+#ifndef WRAP_CORE_POINT_CACHE_H
+#define WRAP_CORE_POINT_CACHE_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MappedFile;
+
+/** Version written by PointCacheWriter */
+const unsigned int kPointCacheFormatVersion = 1;
+
+/**
+ * Frame range and size of a point cache
+ */
+struct PointCacheInfo {
+	unsigned int vertexCount = 0; /**< Points per frame */
+	unsigned int chunkFrames = 1; /**< Frames written at once */
+	unsigned int frameCount = 0; /**< Frames in the file */
+	double startFrame = 0.0; /**< Time of the first frame, in frames */
+	double frameStep = 1.0; /**< Time between frames, in frames */
+};
+
+/**
+ * Streams chunks of frames to a point cache file. Filling a chunk and writing
+ * the previous one overlap: chunks are handed to a writer thread, and only
+ * when both buffers are queued does AcquireChunk wait for the disk.
+ * The file is written next to the path and renamed into place by Close, so a
+ * failed or abandoned bake never leaves a partial cache behind.
+ */
+class PointCacheWriter {
+public:
+	PointCacheWriter();
+	/** Abandons the file unless Close succeeded */
+	~PointCacheWriter();
+	PointCacheWriter(const PointCacheWriter&) = delete;
+	PointCacheWriter& operator=(const PointCacheWriter&) = delete;
+
+	/**
+	 * Starts a cache file
+	 * @param[in] info Points per frame, frames per chunk and time of the frames, the frame count is ignored
+	 * @return false if the file can not be created
+	 */
+	bool Open(const std::string& path, const PointCacheInfo& info);
+
+	/**
+	 * @return A buffer for the next chunk, info().chunkFrames frames of vertexCount * 3 floats,
+	 * waiting for the writer thread if every buffer is still queued
+	 */
+	float* AcquireChunk();
+
+	/**
+	 * Queues the buffer of the last AcquireChunk for writing
+	 * @param[in] frameCount Frames filled in the buffer, at most info().chunkFrames
+	 */
+	void SubmitChunk(unsigned int frameCount);
+
+	/**
+	 * Waits for the queued chunks, completes the header and moves the file into place
+	 * @return false if anything could not be written, the file is then removed
+	 */
+	bool Close();
+
+	/**
+	 * Stops writing and removes the unfinished file
+	 */
+	void Abort();
+
+	const PointCacheInfo& info() const { return info_; }
+
+private:
+	struct Chunk {
+		std::vector<float> points;
+		unsigned int frameCount = 0;
+	};
+
+	void WriterLoop();
+	/**
+	 * Joins the writer thread after the queued chunks
+	 */
+	void Finish();
+
+	PointCacheInfo info_;
+	std::string path_;
+	std::string temporaryPath_;
+	std::ofstream stream_;
+	Chunk chunks_[2]; // Filled by the caller while the other one is written
+	unsigned int nextChunk_; // Chunk handed out by the next AcquireChunk
+	std::deque<Chunk*> queue_; // Chunks waiting for the writer thread
+	Chunk* writing_; // Chunk the writer thread is writing
+	bool closing_; // No more chunks, the writer thread exits once the queue is empty
+	bool failed_; // A write failed, later chunks are dropped
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::thread writer_;
+};
+
+/**
+ * A point cache file mapped for reading
+ */
+class PointCacheReader {
+public:
+	/**
+	 * Maps a cache file
+	 * @return false if the file is missing, of another version or truncated
+	 */
+	bool Open(const std::string& path);
+
+	const PointCacheInfo& info() const { return info_; }
+
+	/**
+	 * @return The vertexCount * 3 floats of a frame, frame < info().frameCount
+	 */
+	const float* frame(unsigned int frame) const;
+
+private:
+	std::shared_ptr<const MappedFile> file_;
+	PointCacheInfo info_;
+};
+
+#endif
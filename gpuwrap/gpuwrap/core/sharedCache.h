@@ -0,0 +1,78 @@
+/*
+ * Process-wide values shared by key between the nodes that use them. Several
+ * wrap nodes on the same driver evaluate the same driver data, so the first
+ * one to need a value computes it and the others reuse it.
+ */
+
+#ifndef WRAP_CORE_SHARED_CACHE_H
+#define WRAP_CORE_SHARED_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Shared values by a 64-bit key. The cache only keeps weak references, so a
+ * value is freed with its last user and nothing outlives the nodes. Safe to use
+ * from several threads. Values are created empty, their users fill them in,
+ * guarding each part with a std::once_flag of the value so it is computed once.
+ */
+template <typename Value>
+class SharedCache {
+public:
+	SharedCache() : purgeSize_(kMinPurgeSize) {}
+	SharedCache(const SharedCache&) = delete;
+	SharedCache& operator=(const SharedCache&) = delete;
+
+	/**
+	 * @param[in] key Hash of everything the value is computed from
+	 * @return The value still in use under key, or a new empty one
+	 */
+	std::shared_ptr<Value> Acquire(uint64_t key) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::weak_ptr<Value>& entry = entries_[key];
+		std::shared_ptr<Value> value = entry.lock();
+		if (!value) {
+			// Not make_shared, the weak reference would keep the memory of the value
+			value = std::shared_ptr<Value>(new Value);
+			entry = value;
+			if (entries_.size() >= purgeSize_) {
+				Purge();
+			}
+		}
+		return value;
+	}
+
+	/**
+	 * @return The number of values still in use
+	 */
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		size_t count = 0;
+		for (const auto& entry : entries_) {
+			count += entry.second.expired() ? 0 : 1;
+		}
+		return count;
+	}
+
+private:
+	static const size_t kMinPurgeSize = 16;
+
+	/**
+	 * Drops the keys of freed values, amortized over the insertions
+	 */
+	void Purge() {
+		for (auto it = entries_.begin(); it != entries_.end();) {
+			it = it->second.expired() ? entries_.erase(it) : std::next(it);
+		}
+		purgeSize_ = std::max<size_t>(size_t(kMinPurgeSize), entries_.size() * 2);
+	}
+
+	mutable std::mutex mutex_;
+	std::unordered_map<uint64_t, std::weak_ptr<Value>> entries_;
+	size_t purgeSize_; // Entries that trigger the next purge
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "simd.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(WRAP_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+SimdLevel DetectSimdLevel() {
+#if defined(WRAP_SIMD_X86)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave || maxLeaf < 7) {
+		return kSimdSse;
+	}
+	unsigned long long xcr0 = _xgetbv(0);
+	bool ymmState = (xcr0 & 0x6) == 0x6;
+	bool zmmState = (xcr0 & 0xe6) == 0xe6;
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	bool avx512 = (info[1] & (1 << 16)) != 0;
+#if defined(WRAP_SIMD_AVX512)
+	if (avx512 && zmmState) {
+		return kSimdAvx512;
+	}
+#else
+	(void)avx512;
+	(void)zmmState;
+#endif
+	if (avx2 && fma && ymmState) {
+		return kSimdAvx2;
+	}
+	return kSimdSse;
+#else
+	__builtin_cpu_init();
+#if defined(WRAP_SIMD_AVX512)
+	if (__builtin_cpu_supports("avx512f")) {
+		return kSimdAvx512;
+	}
+#endif
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return kSimdAvx2;
+	}
+	return kSimdSse;
+#endif
+#else
+	return kSimdScalar;
+#endif
+}
+
+SimdLevel InitialSimdLevel() {
+	SimdLevel level = GetSupportedSimdLevel();
+	const char* requested = std::getenv("WRAP_SIMD");
+	if (requested) {
+		for (int i = kSimdScalar; i <= kSimdAvx512; ++i) {
+			if (std::strcmp(requested, GetSimdLevelName((SimdLevel)i)) == 0 && i < level) {
+				level = (SimdLevel)i;
+			}
+		}
+	}
+	return level;
+}
+
+std::atomic<int>& CurrentSimdLevel() {
+	static std::atomic<int> level(InitialSimdLevel());
+	return level;
+}
+
+}
+
+SimdLevel GetSupportedSimdLevel() {
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+SimdLevel GetSimdLevel() {
+	return (SimdLevel)CurrentSimdLevel().load();
+}
+
+SimdLevel SetSimdLevel(SimdLevel level) {
+	if (level > GetSupportedSimdLevel()) {
+		level = GetSupportedSimdLevel();
+	}
+	CurrentSimdLevel() = level;
+	return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+	switch (level) {
+	case kSimdSse: return "sse";
+	case kSimdAvx2: return "avx2";
+	case kSimdAvx512: return "avx512";
+	default: return "scalar";
+	}
+}
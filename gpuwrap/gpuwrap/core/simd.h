@@ -0,0 +1,49 @@
+/*
+ * Runtime selection of the instruction set used by the deform kernels.
+ */
+
+#ifndef WRAP_CORE_SIMD_H
+#define WRAP_CORE_SIMD_H
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WRAP_SIMD_X86 1
+// AVX-512 intrinsics need Visual Studio 2017 15.3 or newer
+#if !defined(_MSC_VER) || _MSC_VER >= 1911
+#define WRAP_SIMD_AVX512 1
+#endif
+#endif
+
+/**
+ * Instruction sets with a deform kernel, in increasing order of width
+ */
+enum SimdLevel {
+	kSimdScalar = 0, /**< Scalar reference kernel */
+	kSimdSse, /**< SSE2, 2 driven vertices per iteration */
+	kSimdAvx2, /**< AVX2 + FMA, 4 driven vertices per iteration */
+	kSimdAvx512, /**< AVX-512F, 8 driven vertices per iteration */
+};
+
+/**
+ * @return The widest instruction set supported by this CPU and build
+ */
+SimdLevel GetSupportedSimdLevel();
+
+/**
+ * @return The instruction set the kernels currently use
+ */
+SimdLevel GetSimdLevel();
+
+/**
+ * Restricts the kernels to an instruction set, clamped to the supported level.
+ * The initial level is the supported level, or the WRAP_SIMD environment
+ * variable (scalar, sse, avx2 or avx512) when it is set.
+ * @return The level actually used
+ */
+SimdLevel SetSimdLevel(SimdLevel level);
+
+/**
+ * @return A lower case name for the level, as accepted by WRAP_SIMD
+ */
+const char* GetSimdLevelName(SimdLevel level);
+
+#endif
@@ -0,0 +1,136 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Set on pool worker threads so nested loops run serially instead of waiting on the pool
+thread_local bool isWorkerThread = false;
+
+}
+
+struct ThreadPool::Job {
+	const RangeFunction* function;
+	unsigned int count;
+	unsigned int grainSize;
+	unsigned int chunkCount;
+	unsigned int maxWorkers; // Workers that may join besides the caller
+	unsigned int joinedWorkers; // Guarded by the pool mutex
+	std::atomic<unsigned int> nextChunk;
+	std::atomic<unsigned int> remainingChunks;
+	std::mutex doneMutex;
+	std::condition_variable doneCondition;
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount) : stopping_(false), threadLimit_(0) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wakeCondition_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+unsigned int ThreadPool::threadLimit() const {
+	unsigned int limit = threadLimit_;
+	return limit == 0 ? threadCount() : std::min(limit, threadCount());
+}
+
+ThreadPool& ThreadPool::Instance() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::RunChunks(Job& job) {
+	for (;;) {
+		unsigned int chunk = job.nextChunk.fetch_add(1);
+		if (chunk >= job.chunkCount) {
+			return;
+		}
+		unsigned int begin = chunk * job.grainSize;
+		unsigned int end = std::min(job.count, begin + job.grainSize);
+		(*job.function)(begin, end);
+		if (job.remainingChunks.fetch_sub(1) == 1) {
+			std::lock_guard<std::mutex> lock(job.doneMutex);
+			job.doneCondition.notify_all();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop() {
+	isWorkerThread = true;
+	for (;;) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wakeCondition_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+			if (stopping_) {
+				return;
+			}
+			job = jobs_.front();
+			if (job->nextChunk.load() >= job->chunkCount) {
+				// Every chunk has been handed out, stop advertising the job
+				jobs_.pop_front();
+				continue;
+			}
+			if (++job->joinedWorkers >= job->maxWorkers) {
+				// The job has all the threads it may use
+				jobs_.pop_front();
+			}
+		}
+		RunChunks(*job);
+	}
+}
+
+void ThreadPool::ParallelFor(unsigned int count, unsigned int grainSize, const RangeFunction& function) {
+	if (count == 0) {
+		return;
+	}
+	grainSize = std::max(1u, grainSize);
+	unsigned int chunkCount = (count + grainSize - 1) / grainSize;
+	unsigned int maxWorkers = threadLimit() - 1;
+	if (chunkCount == 1 || maxWorkers == 0 || isWorkerThread) {
+		function(0, count);
+		return;
+	}
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->function = &function;
+	job->count = count;
+	job->grainSize = grainSize;
+	job->chunkCount = chunkCount;
+	job->maxWorkers = maxWorkers;
+	job->joinedWorkers = 0;
+	job->nextChunk = 0;
+	job->remainingChunks = chunkCount;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+	}
+	wakeCondition_.notify_all();
+
+	// Work on our own loop while the workers join in
+	RunChunks(*job);
+
+	std::unique_lock<std::mutex> lock(job->doneMutex);
+	job->doneCondition.wait(lock, [&job] { return job->remainingChunks.load() == 0; });
+}
+
+void ParallelFor(unsigned int count, unsigned int grainSize, const ThreadPool::RangeFunction& function) {
+	if (count <= grainSize) {
+		function(0, count);
+		return;
+	}
+	ThreadPool::Instance().ParallelFor(count, grainSize, function);
+}
@@ -0,0 +1,130 @@
+/*
+ * Maya-independent thread pool used to split per-vertex work across cores.
+ */
+
+#ifndef WRAP_CORE_THREADPOOL_H
+#define WRAP_CORE_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Default number of items processed by one task */
+const unsigned int kDefaultGrainSize = 1024;
+
+/**
+ * A fixed set of worker threads that run chunked loops.
+ * Several threads may submit loops at the same time. The submitting thread
+ * always works on its own loop, so a loop finishes even when every worker is
+ * busy, and loops submitted from inside a worker run serially.
+ */
+class ThreadPool {
+public:
+	typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+	/**
+	 * @param[in] threadCount Total threads including the caller, 0 for the hardware concurrency
+	 */
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	/**
+	 * The process-wide pool
+	 */
+	static ThreadPool& Instance();
+
+	/**
+	 * @return The number of threads that can run a loop, including the caller
+	 */
+	unsigned int threadCount() const { return (unsigned int)workers_.size() + 1; }
+
+	/**
+	 * Limits how many threads, including the caller, work on each loop
+	 * @param[in] threadLimit Maximum threads per loop, 0 for threadCount
+	 */
+	void SetThreadLimit(unsigned int threadLimit) { threadLimit_ = threadLimit; }
+
+	/**
+	 * @return The number of threads that work on each loop, including the caller
+	 */
+	unsigned int threadLimit() const;
+
+	/**
+	 * Calls function on consecutive ranges of [0, count) in parallel and waits for all of them.
+	 * @param[in] count Number of items
+	 * @param[in] grainSize Maximum number of items per call
+	 * @param[in] function Called with a [begin, end) range
+	 */
+	void ParallelFor(unsigned int count, unsigned int grainSize, const RangeFunction& function);
+
+private:
+	struct Job;
+
+	void WorkerLoop();
+	/**
+	 * Runs chunks of the job until none are left
+	 */
+	static void RunChunks(Job& job);
+
+	std::vector<std::thread> workers_;
+	std::deque<std::shared_ptr<Job>> jobs_;
+	std::mutex mutex_;
+	std::condition_variable wakeCondition_;
+	bool stopping_;
+	std::atomic<unsigned int> threadLimit_; // 0 for every thread
+};
+
+/**
+ * Progress of a long parallel job and a request to stop it, shared with the
+ * thread waiting for the job. Jobs check for a cancel between chunks, so they
+ * stop within a grain of work.
+ */
+class TaskProgress {
+public:
+	TaskProgress() : cancelled_(false), done_(0), total_(0) {}
+	TaskProgress(const TaskProgress&) = delete;
+	TaskProgress& operator=(const TaskProgress&) = delete;
+
+	/**
+	 * Asks the job to stop, its results are then incomplete
+	 */
+	void Cancel() { cancelled_ = true; }
+	bool cancelled() const { return cancelled_; }
+
+	/**
+	 * Adds steps the job still has to take
+	 */
+	void AddTotal(unsigned long long steps) { total_ += steps; }
+
+	/**
+	 * Marks steps as done, from any thread
+	 */
+	void Advance(unsigned long long steps) { done_ += steps; }
+
+	/**
+	 * @return Fraction of the steps done, from 0 to 1
+	 */
+	double fraction() const {
+		unsigned long long total = total_;
+		return total > 0 ? std::min(1.0, (double)done_ / total) : 0.0;
+	}
+
+private:
+	std::atomic<bool> cancelled_;
+	std::atomic<unsigned long long> done_;
+	std::atomic<unsigned long long> total_;
+};
+
+/**
+ * Runs a chunked loop on the process-wide pool.
+ * Loops that fit in a single grain run serially on the calling thread.
+ */
+void ParallelFor(unsigned int count, unsigned int grainSize, const ThreadPool::RangeFunction& function);
+
+#endif
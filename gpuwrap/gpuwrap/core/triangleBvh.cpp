@@ -0,0 +1,298 @@
+#include "triangleBvh.h"
+#include "wrapMath.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+const unsigned int kMaxLeafSize = 4;
+const unsigned int kBinCount = 16;
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+struct Bounds {
+	double min[3] = { kInfinity, kInfinity, kInfinity };
+	double max[3] = { -kInfinity, -kInfinity, -kInfinity };
+
+	void Grow(const double* p) {
+		for (int axis = 0; axis < 3; ++axis) {
+			min[axis] = std::min(min[axis], p[axis]);
+			max[axis] = std::max(max[axis], p[axis]);
+		}
+	}
+
+	void Grow(const Bounds& other) {
+		Grow(other.min);
+		Grow(other.max);
+	}
+
+	double HalfArea() const {
+		double x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+		return x < 0.0 ? 0.0 : x * y + y * z + z * x;
+	}
+};
+
+struct BuildTriangle {
+	Bounds bounds;
+	double centroid[3];
+};
+
+struct BuildTask {
+	unsigned int node;
+	unsigned int begin;
+	unsigned int end;
+};
+
+struct Bin {
+	Bounds bounds;
+	unsigned int count = 0;
+};
+
+// Squared distance from p to the box, 0 inside
+inline double BoxDistance(const double* boundsMin, const double* boundsMax, const double* p) {
+	double distance = 0.0;
+	for (int axis = 0; axis < 3; ++axis) {
+		double d = std::max(std::max(boundsMin[axis] - p[axis], p[axis] - boundsMax[axis]), 0.0);
+		distance += d * d;
+	}
+	return distance;
+}
+
+// Spreads the low 10 bits of v so there are two zero bits between each
+inline uint32_t SpreadBits(uint32_t v) {
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+}
+
+TriangleBvh::TriangleBvh() {}
+
+void TriangleBvh::Build(const double* points, const int* triangleVertices, unsigned int triangleCount) {
+	nodes_.clear();
+	triangles_.resize(triangleCount);
+	trianglePoints_.clear();
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<BuildTriangle> buildTriangles(triangleCount);
+	for (unsigned int t = 0; t < triangleCount; ++t) {
+		BuildTriangle& triangle = buildTriangles[t];
+		for (int i = 0; i < 3; ++i) {
+			triangle.bounds.Grow(&points[triangleVertices[t * 3 + i] * 3]);
+		}
+		for (int axis = 0; axis < 3; ++axis) {
+			triangle.centroid[axis] = 0.5 * (triangle.bounds.min[axis] + triangle.bounds.max[axis]);
+		}
+		triangles_[t] = (int)t;
+	}
+
+	nodes_.reserve(2 * (triangleCount / kMaxLeafSize + 1));
+	nodes_.push_back(Node());
+	std::vector<BuildTask> tasks(1, BuildTask{ 0, 0, triangleCount });
+	while (!tasks.empty()) {
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		Bounds bounds, centroidBounds;
+		for (unsigned int i = task.begin; i < task.end; ++i) {
+			const BuildTriangle& triangle = buildTriangles[triangles_[i]];
+			bounds.Grow(triangle.bounds);
+			centroidBounds.Grow(triangle.centroid);
+		}
+		Node& node = nodes_[task.node];
+		std::copy(bounds.min, bounds.min + 3, node.boundsMin);
+		std::copy(bounds.max, bounds.max + 3, node.boundsMax);
+		unsigned int count = task.end - task.begin;
+		if (count <= kMaxLeafSize) {
+			node.first = task.begin;
+			node.count = count;
+			continue;
+		}
+
+		// Binned surface area heuristic over the triangle centroids
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		double bestCost = kInfinity;
+		for (int axis = 0; axis < 3; ++axis) {
+			double extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			if (extent <= 0.0) {
+				continue;
+			}
+			double scale = kBinCount / extent;
+			Bin bins[kBinCount];
+			for (unsigned int i = task.begin; i < task.end; ++i) {
+				const BuildTriangle& triangle = buildTriangles[triangles_[i]];
+				unsigned int bin = std::min((unsigned int)((triangle.centroid[axis] - centroidBounds.min[axis]) * scale), kBinCount - 1);
+				bins[bin].bounds.Grow(triangle.bounds);
+				++bins[bin].count;
+			}
+			// Sweep from the right to get the cost of everything above each split
+			double rightCosts[kBinCount];
+			Bounds rightBounds;
+			unsigned int rightCount = 0;
+			for (unsigned int bin = kBinCount - 1; bin > 0; --bin) {
+				rightBounds.Grow(bins[bin].bounds);
+				rightCount += bins[bin].count;
+				rightCosts[bin] = rightBounds.HalfArea() * rightCount;
+			}
+			Bounds leftBounds;
+			unsigned int leftCount = 0;
+			for (unsigned int split = 1; split < kBinCount; ++split) {
+				leftBounds.Grow(bins[split - 1].bounds);
+				leftCount += bins[split - 1].count;
+				if (leftCount == 0 || leftCount == count) {
+					continue;
+				}
+				double cost = leftBounds.HalfArea() * leftCount + rightCosts[split];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		unsigned int middle;
+		if (bestAxis >= 0) {
+			double scale = kBinCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+			double splitMin = centroidBounds.min[bestAxis];
+			int* split = std::partition(&triangles_[task.begin], &triangles_[0] + task.end, [&](int t) {
+				unsigned int bin = std::min((unsigned int)((buildTriangles[t].centroid[bestAxis] - splitMin) * scale), kBinCount - 1);
+				return bin < bestSplit;
+			});
+			middle = (unsigned int)(split - &triangles_[0]);
+		} else {
+			// Every centroid is in the same place, any halving is as good
+			middle = task.begin + count / 2;
+		}
+
+		unsigned int firstChild = (unsigned int)nodes_.size();
+		node.first = firstChild;
+		node.count = 0;
+		nodes_.push_back(Node());
+		nodes_.push_back(Node());
+		tasks.push_back(BuildTask{ firstChild + 1, middle, task.end });
+		tasks.push_back(BuildTask{ firstChild, task.begin, middle });
+	}
+
+	// Copy the triangle corners in leaf order so a leaf reads one contiguous block
+	trianglePoints_.resize(triangleCount * 9);
+	for (unsigned int i = 0; i < triangleCount; ++i) {
+		const int* vertices = &triangleVertices[triangles_[i] * 3];
+		for (int corner = 0; corner < 3; ++corner) {
+			std::copy(&points[vertices[corner] * 3], &points[vertices[corner] * 3] + 3, &trianglePoints_[i * 9 + corner * 3]);
+		}
+	}
+}
+
+int TriangleBvh::ClosestPoint(const double* point, double* closest) const {
+	std::vector<unsigned int> stack;
+	return ClosestPoint(point, closest, stack);
+}
+
+int TriangleBvh::ClosestPoint(const double* point, double* closest, std::vector<unsigned int>& stack) const {
+	if (nodes_.empty()) {
+		return -1;
+	}
+	int bestTriangle = -1;
+	double bestDistance = kInfinity;
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const Node& node = nodes_[stack.back()];
+		stack.pop_back();
+		// Nodes exactly at the best distance may still hold a lower triangle id
+		if (BoxDistance(node.boundsMin, node.boundsMax, point) > bestDistance) {
+			continue;
+		}
+		if (node.count > 0) {
+			for (unsigned int i = node.first; i < node.first + node.count; ++i) {
+				const double* corners = &trianglePoints_[i * 9];
+				double candidate[3];
+				double distance = ClosestPointOnTriangle(point, corners, corners + 3, corners + 6, candidate);
+				int triangle = triangles_[i];
+				if (distance < bestDistance || (distance == bestDistance && triangle < bestTriangle)) {
+					bestDistance = distance;
+					bestTriangle = triangle;
+					closest[0] = candidate[0];
+					closest[1] = candidate[1];
+					closest[2] = candidate[2];
+				}
+			}
+			continue;
+		}
+		// Visit the nearer child first so the far one is more likely to be culled
+		unsigned int nearChild = node.first, farChild = node.first + 1;
+		double nearDistance = BoxDistance(nodes_[nearChild].boundsMin, nodes_[nearChild].boundsMax, point);
+		double farDistance = BoxDistance(nodes_[farChild].boundsMin, nodes_[farChild].boundsMax, point);
+		if (farDistance < nearDistance) {
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+		if (farDistance <= bestDistance) {
+			stack.push_back(farChild);
+		}
+		if (nearDistance <= bestDistance) {
+			stack.push_back(nearChild);
+		}
+	}
+	return bestTriangle;
+}
+
+void TriangleBvh::ClosestPoints(const double* points, unsigned int count,
+								int* triangles, double* closest,
+								unsigned int grainSize,
+								TaskProgress* progress) const {
+	if (count == 0) {
+		return;
+	}
+	std::vector<unsigned int> order;
+	GetMortonOrder(points, count, order);
+
+	ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+		if (progress != nullptr && progress->cancelled()) {
+			return;
+		}
+		std::vector<unsigned int> stack;
+		stack.reserve(64);
+		for (unsigned int k = begin; k < end; ++k) {
+			unsigned int i = order[k];
+			triangles[i] = ClosestPoint(&points[i * 3], &closest[i * 3], stack);
+		}
+		if (progress != nullptr) {
+			progress->Advance(end - begin);
+		}
+	});
+}
+
+void GetMortonOrder(const double* points, unsigned int count, std::vector<unsigned int>& order) {
+	Bounds bounds;
+	for (unsigned int i = 0; i < count; ++i) {
+		bounds.Grow(&points[i * 3]);
+	}
+	double scale[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		double extent = bounds.max[axis] - bounds.min[axis];
+		scale[axis] = extent > 0.0 ? 1023.0 / extent : 0.0;
+	}
+	std::vector<uint64_t> keys(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		uint32_t code = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			uint32_t cell = (uint32_t)((points[i * 3 + axis] - bounds.min[axis]) * scale[axis]);
+			code |= SpreadBits(std::min(cell, 1023u)) << axis;
+		}
+		keys[i] = ((uint64_t)code << 32) | i;
+	}
+	std::sort(keys.begin(), keys.end());
+	order.resize(count);
+	for (unsigned int k = 0; k < count; ++k) {
+		order[k] = (unsigned int)(keys[k] & 0xFFFFFFFF);
+	}
+}
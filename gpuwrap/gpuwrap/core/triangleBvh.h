@@ -0,0 +1,80 @@
+/*
+ * Maya-independent closest point queries against a triangle mesh.
+ */
+
+#ifndef WRAP_CORE_TRIANGLEBVH_H
+#define WRAP_CORE_TRIANGLEBVH_H
+
+#include "threadPool.h"
+
+#include <vector>
+
+/**
+ * Bounding volume hierarchy over the triangles of a mesh, built with binned
+ * SAH splits. Triangle ids are the ones of the triangle table it was built
+ * from, e.g. MFnMesh::getTriangles order. Queries are read-only and may run
+ * from several threads at once.
+ */
+class TriangleBvh {
+public:
+	TriangleBvh();
+
+	/**
+	 * Builds the tree, replacing any previous one
+	 * @param[in] points Mesh points, 3 doubles per vertex
+	 * @param[in] triangleVertices 3 vertex ids per triangle
+	 * @param[in] triangleCount Number of triangles
+	 */
+	void Build(const double* points, const int* triangleVertices, unsigned int triangleCount);
+
+	unsigned int triangleCount() const { return (unsigned int)triangles_.size(); }
+
+	/**
+	 * Finds the closest point on the mesh. Of triangles at the same distance
+	 * the lowest triangle id is returned, like a brute force search in order.
+	 * @param[in] point Query point, 3 doubles
+	 * @param[out] closest The closest point, 3 doubles
+	 * @return The triangle id of the closest point, -1 if the tree is empty
+	 */
+	int ClosestPoint(const double* point, double* closest) const;
+
+	/**
+	 * ClosestPoint for many points, in parallel. The queries are processed in
+	 * spatially sorted order so neighbouring queries walk the same nodes.
+	 * @param[in] points Query points, 3 doubles per point
+	 * @param[in] count Number of query points
+	 * @param[out] triangles Triangle id per query point
+	 * @param[out] closest Closest point per query point, 3 doubles per point
+	 * @param[in] grainSize Queries per parallel task
+	 * @param[in,out] progress Advanced by one step per query, stops the queries when cancelled. May be null.
+	 */
+	void ClosestPoints(const double* points, unsigned int count,
+					   int* triangles, double* closest,
+					   unsigned int grainSize = kDefaultGrainSize,
+					   TaskProgress* progress = nullptr) const;
+
+private:
+	struct Node {
+		double boundsMin[3];
+		double boundsMax[3];
+		unsigned int first; // Leaf: first entry in triangles_. Interior: first child, the second child follows it.
+		unsigned int count; // Leaf: number of triangles. Interior: 0.
+	};
+
+	int ClosestPoint(const double* point, double* closest, std::vector<unsigned int>& stack) const;
+
+	std::vector<Node> nodes_;
+	std::vector<int> triangles_; // Triangle ids in leaf order
+	std::vector<double> trianglePoints_; // 9 doubles per triangle in leaf order
+};
+
+/**
+ * Sorts points along a Morton curve over their bounds, so points next to each
+ * other in the order are close in space. Ties keep the input order.
+ * @param[in] points Points, 3 doubles per point
+ * @param[in] count Number of points
+ * @param[out] order Point ids in curve order
+ */
+void GetMortonOrder(const double* points, unsigned int count, std::vector<unsigned int>& order);
+
+#endif
@@ -0,0 +1,51 @@
+#include "vertexNormals.h"
+
+#include <cmath>
+
+void VertexTriangles::Build(const int* triangleVertices, unsigned int triangleCount, unsigned int vertexCount) {
+	// Counting sort by vertex, triangles are visited in order so each row is ascending
+	offsets.assign(vertexCount + 1, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i) {
+		++offsets[triangleVertices[i] + 1];
+	}
+	for (unsigned int v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] += offsets[v];
+	}
+	triangles.resize(triangleCount * 3);
+	std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; ++t) {
+		for (int corner = 0; corner < 3; ++corner) {
+			triangles[next[triangleVertices[t * 3 + corner]]++] = (int)t;
+		}
+	}
+}
+
+void ComputeVertexNormals(const VertexTriangles& adjacency,
+						  const int* triangleVertices,
+						  const double* points,
+						  const int* vertices,
+						  unsigned int begin, unsigned int end,
+						  float* normals) {
+	for (unsigned int i = begin; i < end; ++i) {
+		unsigned int vertex = vertices != nullptr ? (unsigned int)vertices[i] : i;
+		// The unnormalized cross product is twice the area times the unit normal
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		for (unsigned int j = adjacency.offsets[vertex]; j < adjacency.offsets[vertex + 1]; ++j) {
+			const int* corners = &triangleVertices[adjacency.triangles[j] * 3];
+			const double* a = &points[corners[0] * 3];
+			const double* b = &points[corners[1] * 3];
+			const double* c = &points[corners[2] * 3];
+			double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			sum[0] += e0[1] * e1[2] - e0[2] * e1[1];
+			sum[1] += e0[2] * e1[0] - e0[0] * e1[2];
+			sum[2] += e0[0] * e1[1] - e0[1] * e1[0];
+		}
+		double length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+		double scale = length > 0.0 ? 1.0 / length : 0.0;
+		float* normal = &normals[i * 3];
+		normal[0] = (float)(sum[0] * scale);
+		normal[1] = (float)(sum[1] * scale);
+		normal[2] = (float)(sum[2] * scale);
+	}
+}
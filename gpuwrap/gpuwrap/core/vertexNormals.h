@@ -0,0 +1,49 @@
+/*
+ * Maya-independent area weighted vertex normals.
+ */
+
+#ifndef WRAP_CORE_VERTEXNORMALS_H
+#define WRAP_CORE_VERTEXNORMALS_H
+
+#include <vector>
+
+/**
+ * The triangles around each vertex of a triangle mesh, as compressed rows.
+ * Only depends on the topology, so it is built once and reused while the
+ * points move.
+ */
+struct VertexTriangles {
+	std::vector<unsigned int> offsets; /**< Start of each vertex in triangles, one extra at the end */
+	std::vector<int> triangles; /**< Ids of the triangles using each vertex, ascending */
+
+	unsigned int vertexCount() const { return offsets.empty() ? 0 : (unsigned int)offsets.size() - 1; }
+
+	/**
+	 * @param[in] triangleVertices 3 vertex ids per triangle
+	 * @param[in] triangleCount Number of triangles
+	 * @param[in] vertexCount Number of mesh vertices
+	 */
+	void Build(const int* triangleVertices, unsigned int triangleCount, unsigned int vertexCount);
+};
+
+/**
+ * Computes vertex normals as the normalized sum of the adjacent triangle
+ * normals weighted by triangle area. Vertices without area get a zero normal.
+ * Each normal only depends on its own triangles, so ranges can run in parallel
+ * and a vertex gets the same normal whichever other vertices are computed.
+ * @param[in] adjacency Triangles around each vertex
+ * @param[in] triangleVertices 3 vertex ids per triangle
+ * @param[in] points Mesh points, 3 doubles per vertex
+ * @param[in] vertices Vertex ids to compute, null for every vertex in order
+ * @param[in] begin First entry of vertices to compute
+ * @param[in] end One past the last entry of vertices to compute
+ * @param[out] normals 3 floats per entry of vertices, indexed like vertices
+ */
+void ComputeVertexNormals(const VertexTriangles& adjacency,
+						  const int* triangleVertices,
+						  const double* points,
+						  const int* vertices,
+						  unsigned int begin, unsigned int end,
+						  float* normals);
+
+#endif
@@ -0,0 +1,88 @@
+#include "wrapBake.h"
+#include "threadPool.h"
+
+#include <vector>
+
+namespace {
+
+/**
+ * Deforms one frame on the calling thread, the way Wrap::deform does a full evaluation
+ * @param[in] active Elements with a non-zero weight
+ * @param[in] allWeightsOne Every weight is exactly 1
+ */
+template <typename Real>
+void DeformFrame(const WrapBinding& binding, const BakeTopology& topology, const float* weights,
+				 const std::vector<unsigned int>& active, bool allWeightsOne, const BakeFrame& frame,
+				 float* points) {
+	unsigned int count = binding.size();
+	std::vector<Real> deformed(count * 3);
+	if (frame.drivenPoints != nullptr) {
+		GatherDrivenPoints(binding, frame.drivenPoints, 0, count, deformed.data());
+	}
+	if (frame.envelope != 0.0f && !active.empty()) {
+		// Fetch every driver vertex in use once, the normals only for those vertices
+		unsigned int compactCount = binding.referencedVertexCount();
+		bool computeNormals = binding.normals == kAreaWeightedNormals;
+		std::vector<Real> compactPoints(compactCount * 3);
+		std::vector<float> compactNormals(compactCount * 3);
+		GatherReferencedVertices(binding, frame.driverPoints, computeNormals ? nullptr : frame.driverNormals,
+								 0, compactCount, compactPoints.data(), compactNormals.data());
+		if (computeNormals) {
+			ComputeVertexNormals(*topology.adjacency, topology.triangleVertices, frame.driverPoints,
+								 binding.referencedVertices.data(), 0, compactCount, compactNormals.data());
+		}
+
+		std::vector<Real> inputPoints;
+		bool fullStrength = frame.envelope == 1.0f && allWeightsOne;
+		if (!fullStrength) {
+			inputPoints = deformed;
+		}
+		if (active.size() == count) {
+			DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), frame.localToWorld,
+								0, count, deformed.data());
+		} else {
+			DeformPointsCompactIndexed(binding, compactPoints.data(), compactNormals.data(), frame.localToWorld,
+									   active.data(), (unsigned int)active.size(), deformed.data());
+		}
+		if (!fullStrength) {
+			ApplyWeights(inputPoints.data(), weights, frame.envelope, active.data(), (unsigned int)active.size(),
+						 deformed.data());
+		}
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		float* point = points + binding.vertexId(i) * 3;
+		point[0] = (float)deformed[i * 3];
+		point[1] = (float)deformed[i * 3 + 1];
+		point[2] = (float)deformed[i * 3 + 2];
+	}
+}
+
+}
+
+void DeformFrames(const WrapBinding& binding,
+				  const BakeTopology& topology,
+				  const float* weights,
+				  const BakeFrame* frames, unsigned int frameCount,
+				  Precision precision,
+				  float* points) {
+	unsigned int count = binding.size();
+	std::vector<float> ones;
+	if (weights == nullptr) {
+		ones.assign(count, 1.0f);
+		weights = ones.data();
+	}
+	std::vector<unsigned int> active;
+	bool allWeightsOne = FindActiveVertices(weights, count, active);
+
+	// Frames are independent, so each task deforms whole frames and nothing is shared but the binding
+	ParallelFor(frameCount, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int f = begin; f < end; ++f) {
+			float* framePoints = points + (size_t)f * count * 3;
+			if (precision == kPrecisionFloat) {
+				DeformFrame<float>(binding, topology, weights, active, allWeightsOne, frames[f], framePoints);
+			} else {
+				DeformFrame<double>(binding, topology, weights, active, allWeightsOne, frames[f], framePoints);
+			}
+		}
+	});
+}
@@ -0,0 +1,51 @@
+/*
+ * Offline evaluation of a wrap over many frames. Once the driver points of a
+ * frame are known, frames do not depend on each other, so a bake deforms
+ * whole frames in parallel instead of stepping the scene one deform at a time.
+ */
+
+#ifndef WRAP_CORE_BAKE_H
+#define WRAP_CORE_BAKE_H
+
+#include "vertexNormals.h"
+#include "wrapKernel.h"
+
+/**
+ * Everything one frame of a bake reads besides the binding
+ */
+struct BakeFrame {
+	const double* driverPoints = nullptr; /**< World space driver points, 3 doubles per vertex */
+	const float* driverNormals = nullptr; /**< Driver vertex normals of kMayaNormals bindings, 3 floats per vertex */
+	const double* drivenPoints = nullptr; /**< Input positions in driven vertex order, 3 doubles per vertex.
+												 May be null for kBindOffset bindings at full strength. */
+	double localToWorld[16]; /**< Driven geometry local to world matrix */
+	float envelope = 1.0f; /**< Envelope of the deformer at the frame */
+};
+
+/**
+ * Driver topology shared by every frame of a bake, for kAreaWeightedNormals bindings
+ */
+struct BakeTopology {
+	const int* triangleVertices = nullptr; /**< 3 driver vertex ids per triangle */
+	const VertexTriangles* adjacency = nullptr; /**< Triangles around each driver vertex */
+};
+
+/**
+ * Deforms frames in parallel, one frame per task, each exactly like a full
+ * evaluation of the deformer at that frame
+ * @param[in] binding Binding with up to date referenced vertices, and float bind matrices for kPrecisionFloat
+ * @param[in] topology Driver triangles, only read for kAreaWeightedNormals bindings
+ * @param[in] weights Painted weight per element, null for a weight of 1 everywhere
+ * @param[in] frames Inputs of each frame
+ * @param[in] frameCount Number of frames
+ * @param[in] precision Scalar type each frame is deformed in
+ * @param[out] points binding.size() * 3 floats per frame, in driven vertex order
+ */
+void DeformFrames(const WrapBinding& binding,
+				  const BakeTopology& topology,
+				  const float* weights,
+				  const BakeFrame* frames, unsigned int frameCount,
+				  Precision precision,
+				  float* points);
+
+#endif
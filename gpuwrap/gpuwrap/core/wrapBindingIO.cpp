@@ -0,0 +1,203 @@
+#include "wrapBindingIO.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = { 'A', 'W', 'W', 'B' };
+
+const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+template <typename Array>
+void WriteArray(std::ostream& stream, const Array& values) {
+	if (!values.empty()) {
+		stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(typename Array::value_type));
+	}
+}
+
+template <typename Array>
+bool ReadArray(std::istream& stream, Array& values, size_t count) {
+	values.resize(count);
+	if (count == 0) {
+		return true;
+	}
+	stream.read(reinterpret_cast<char*>(values.data()), count * sizeof(typename Array::value_type));
+	return (size_t)stream.gcount() == count * sizeof(typename Array::value_type);
+}
+
+void WriteUInt32(std::ostream& stream, uint32_t value) {
+	stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ReadUInt32(std::istream& stream, uint32_t& value) {
+	stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+	return stream.gcount() == sizeof(value);
+}
+
+int DecodeBase64Character(char c) {
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+') return 62;
+	if (c == '/') return 63;
+	return -1;
+}
+
+}
+
+size_t GetBindingByteSize(const WrapBinding& binding) {
+	return sizeof(kMagic) + 4 * sizeof(uint32_t) +
+		binding.triangleVerts.size() * sizeof(int32_t) +
+		binding.coords.size() * sizeof(BaryCoords) +
+		binding.bindMatrices.size() * sizeof(double) +
+		binding.offsets.size() * sizeof(float) +
+		sizeof(uint32_t) +
+		binding.sampleOffsets.size() * sizeof(uint32_t) +
+		binding.sampleVertices.size() * sizeof(int32_t) +
+		binding.sampleWeights.size() * sizeof(float) +
+		sizeof(uint32_t) +
+		binding.vertexOrder.size() * sizeof(uint32_t);
+}
+
+bool WriteBinding(const WrapBinding& binding, std::ostream& stream) {
+	stream.write(kMagic, sizeof(kMagic));
+	WriteUInt32(stream, kBindingFormatVersion);
+	WriteUInt32(stream, (uint32_t)binding.mode);
+	WriteUInt32(stream, (uint32_t)binding.normals);
+	WriteUInt32(stream, binding.size());
+	WriteArray(stream, binding.triangleVerts);
+	WriteArray(stream, binding.coords);
+	if (binding.mode == kBindOffset) {
+		WriteArray(stream, binding.offsets);
+	} else {
+		WriteArray(stream, binding.bindMatrices);
+	}
+	WriteUInt32(stream, (uint32_t)binding.sampleVertices.size());
+	if (binding.hasSamples()) {
+		WriteArray(stream, binding.sampleOffsets);
+		WriteArray(stream, binding.sampleVertices);
+		WriteArray(stream, binding.sampleWeights);
+	}
+	WriteUInt32(stream, (uint32_t)binding.vertexOrder.size());
+	WriteArray(stream, binding.vertexOrder);
+	return !stream.fail();
+}
+
+bool ReadBinding(std::istream& stream, size_t length, WrapBinding& binding) {
+	binding.clear();
+	char magic[4];
+	stream.read(magic, sizeof(magic));
+	uint32_t version = 0, mode = 0, normals = kMayaNormals, count = 0;
+	if (stream.gcount() != sizeof(magic) || std::memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+		!ReadUInt32(stream, version) || version == 0 || version > kBindingFormatVersion ||
+		!ReadUInt32(stream, mode) || mode > kBindOffset) {
+		return false;
+	}
+	// Version 1 bindings were all made with Maya's vertex normals
+	if (version >= 2 && (!ReadUInt32(stream, normals) || normals > kAreaWeightedNormals)) {
+		return false;
+	}
+	if (!ReadUInt32(stream, count)) {
+		return false;
+	}
+
+	// Reject counts the data cannot hold before allocating for them
+	size_t perVertex = 3 * sizeof(int32_t) + sizeof(BaryCoords) +
+		(mode == kBindOffset ? 3 * sizeof(float) : 16 * sizeof(double));
+	size_t header = sizeof(kMagic) + (version >= 2 ? 4 : 3) * sizeof(uint32_t);
+	if (length < header || (length - header) / perVertex < count) {
+		return false;
+	}
+
+	binding.mode = (BindMode)mode;
+	binding.normals = (DriverNormals)normals;
+	bool valid = ReadArray(stream, binding.triangleVerts, count * 3) &&
+				 ReadArray(stream, binding.coords, count);
+	if (valid && binding.mode == kBindOffset) {
+		valid = ReadArray(stream, binding.offsets, count * 3);
+	} else if (valid) {
+		valid = ReadArray(stream, binding.bindMatrices, count * 16);
+	}
+
+	// Samples from version 3 on
+	uint32_t sampleCount = 0;
+	if (valid && version >= 3) {
+		valid = ReadUInt32(stream, sampleCount);
+	}
+	size_t used = header + count * perVertex + sizeof(uint32_t);
+	if (valid && sampleCount > 0) {
+		size_t perSample = sizeof(int32_t) + sizeof(float);
+		valid = length >= used + (count + 1) * sizeof(uint32_t) &&
+				(length - used - (count + 1) * sizeof(uint32_t)) / perSample >= sampleCount &&
+				ReadArray(stream, binding.sampleOffsets, count + 1) &&
+				ReadArray(stream, binding.sampleVertices, sampleCount) &&
+				ReadArray(stream, binding.sampleWeights, sampleCount);
+		// Rows have to be in order and cover the samples exactly
+		for (uint32_t i = 0; valid && i < count; ++i) {
+			valid = binding.sampleOffsets[i] <= binding.sampleOffsets[i + 1];
+		}
+		valid = valid && binding.sampleOffsets[0] == 0 && binding.sampleOffsets[count] == sampleCount;
+		for (uint32_t i = 0; valid && i < sampleCount; ++i) {
+			valid = binding.sampleVertices[i] >= 0;
+		}
+		used += (count + 1) * sizeof(uint32_t) + sampleCount * perSample;
+	}
+
+	// Vertex order from version 4 on, every driven vertex exactly once
+	uint32_t orderCount = 0;
+	if (valid && version >= 4) {
+		valid = ReadUInt32(stream, orderCount) && (orderCount == 0 || orderCount == count);
+	}
+	if (valid && orderCount > 0) {
+		used += sizeof(uint32_t);
+		valid = length >= used && (length - used) / sizeof(uint32_t) >= orderCount &&
+				ReadArray(stream, binding.vertexOrder, orderCount) &&
+				IsPermutation(binding.vertexOrder.data(), orderCount);
+	}
+	if (!valid) {
+		binding.clear();
+	}
+	return valid;
+}
+
+std::string EncodeBase64(const char* data, size_t size) {
+	std::string out;
+	out.reserve((size + 2) / 3 * 4);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i += 3) {
+		uint32_t group = (uint32_t)bytes[i] << 16;
+		if (i + 1 < size) group |= (uint32_t)bytes[i + 1] << 8;
+		if (i + 2 < size) group |= bytes[i + 2];
+		out += kBase64Alphabet[(group >> 18) & 63];
+		out += kBase64Alphabet[(group >> 12) & 63];
+		out += i + 1 < size ? kBase64Alphabet[(group >> 6) & 63] : '=';
+		out += i + 2 < size ? kBase64Alphabet[group & 63] : '=';
+	}
+	return out;
+}
+
+bool DecodeBase64(const std::string& text, std::string& out) {
+	if (text.size() % 4 != 0) {
+		return false;
+	}
+	out.reserve(out.size() + text.size() / 4 * 3);
+	for (size_t i = 0; i < text.size(); i += 4) {
+		int values[4];
+		int padding = 0;
+		for (int k = 0; k < 4; ++k) {
+			char c = text[i + k];
+			if (c == '=' && i + 4 == text.size() && k >= 2) {
+				values[k] = 0;
+				++padding;
+			} else if (padding > 0 || (values[k] = DecodeBase64Character(c)) < 0) {
+				return false;
+			}
+		}
+		uint32_t group = (values[0] << 18) | (values[1] << 12) | (values[2] << 6) | values[3];
+		out += (char)((group >> 16) & 0xff);
+		if (padding < 2) out += (char)((group >> 8) & 0xff);
+		if (padding < 1) out += (char)(group & 0xff);
+	}
+	return true;
+}
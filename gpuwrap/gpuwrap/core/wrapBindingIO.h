@@ -0,0 +1,66 @@
+/*
+ * Packed, versioned binary form of a WrapBinding.
+ *
+ * Layout, little-endian:
+ *   char[4]  magic "AWWB"
+ *   uint32   format version
+ *   uint32   bind mode
+ *   uint32   driver normals             version 2 and later, kMayaNormals before
+ *   uint32   driven vertex count
+ *   int32    triangleVerts[count * 3]
+ *   float    coords[count * 3]
+ *   double   bindMatrices[count * 16]   kBindMatrix only
+ *   float    offsets[count * 3]         kBindOffset only
+ *   uint32   sample count               version 3 and later, 0 without samples
+ *   uint32   sampleOffsets[count + 1]   only with samples
+ *   int32    sampleVertices[samples]    only with samples
+ *   float    sampleWeights[samples]     only with samples
+ *   uint32   vertex order count         version 4 and later, 0 or count
+ *   uint32   vertexOrder[count]         only with a vertex order
+ */
+
+#ifndef WRAP_CORE_BINDING_IO_H
+#define WRAP_CORE_BINDING_IO_H
+
+#include "wrapKernel.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/** Version written by WriteBinding */
+const unsigned int kBindingFormatVersion = 4;
+
+/**
+ * @return The number of bytes WriteBinding produces for the binding
+ */
+size_t GetBindingByteSize(const WrapBinding& binding);
+
+/**
+ * Writes the packed binding
+ * @return false if the stream failed
+ */
+bool WriteBinding(const WrapBinding& binding, std::ostream& stream);
+
+/**
+ * Reads a packed binding written by any supported format version
+ * @param[in] stream Stream positioned at the magic
+ * @param[in] length Number of bytes available in the stream
+ * @param[out] binding Decoded binding, cleared on failure
+ * @return false if the data is truncated, corrupt or from a newer version
+ */
+bool ReadBinding(std::istream& stream, size_t length, WrapBinding& binding);
+
+/**
+ * Encodes bytes as base64, for text scene formats
+ */
+std::string EncodeBase64(const char* data, size_t size);
+
+/**
+ * Decodes base64 text, appending to out
+ * @return false if the text is not valid base64
+ */
+bool DecodeBase64(const std::string& text, std::string& out);
+
+#endif
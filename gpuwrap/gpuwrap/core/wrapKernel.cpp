@@ -0,0 +1,844 @@
+#include "wrapKernel.h"
+#include "wrapKernelSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+void WrapBinding::resize(unsigned int count) {
+	triangleVerts.resize(count * 3);
+	coords.resize(count);
+	vertexOrder.clear();
+	if (mode == kBindOffset) {
+		bindMatrices.clear();
+		offsets.resize(count * 3);
+	} else {
+		bindMatrices.resize(count * 16);
+		offsets.clear();
+	}
+}
+
+void WrapBinding::clear() {
+	triangleVerts.clear();
+	coords.clear();
+	bindMatrices.clear();
+	offsets.clear();
+	sampleOffsets.clear();
+	sampleVertices.clear();
+	sampleWeights.clear();
+	vertexOrder.clear();
+	referencedVertices.clear();
+	compactTriangleVerts.clear();
+	compactSampleVertices.clear();
+	drivenOffsets.clear();
+	drivenVertices.clear();
+	floatBindMatrices.clear();
+}
+
+void WrapBinding::UpdateReferencedVertices() {
+	// Read the stored arrays through const references, so views of a bind cache are not copied
+	const BindArray<int>& corners = triangleVerts;
+	const BindArray<unsigned int>& rows = sampleOffsets;
+	const BindArray<int>& samples = sampleVertices;
+	int maxVertex = -1;
+	for (int vertex : corners) {
+		maxVertex = std::max(maxVertex, vertex);
+	}
+	for (int vertex : samples) {
+		maxVertex = std::max(maxVertex, vertex);
+	}
+	// Compact ids in order of first use, so driven vertices next to each other read nearby driver data
+	std::vector<int> compactIds(maxVertex + 1, -1);
+	referencedVertices.clear();
+	auto getCompactId = [&](int vertex) {
+		int& compactId = compactIds[vertex];
+		if (compactId < 0) {
+			compactId = (int)referencedVertices.size();
+			referencedVertices.push_back(vertex);
+		}
+		return compactId;
+	};
+	compactTriangleVerts.resize(corners.size());
+	compactSampleVertices.resize(samples.size());
+	for (unsigned int i = 0; i < size(); ++i) {
+		for (int corner = 0; corner < 3; ++corner) {
+			compactTriangleVerts[i * 3 + corner] = getCompactId(corners[i * 3 + corner]);
+		}
+		if (hasSamples()) {
+			for (unsigned int j = rows[i]; j < rows[i + 1]; ++j) {
+				compactSampleVertices[j] = getCompactId(samples[j]);
+			}
+		}
+	}
+
+	// Reverse index, counting sort by compact vertex keeps each list ascending.
+	// A driven vertex using a compact vertex as corner and sample is listed once.
+	std::vector<int> used;
+	auto getUsed = [&](unsigned int i) {
+		used.assign(&compactTriangleVerts[i * 3], &compactTriangleVerts[i * 3] + 3);
+		if (hasSamples()) {
+			used.insert(used.end(), compactSampleVertices.begin() + rows[i],
+						compactSampleVertices.begin() + rows[i + 1]);
+		}
+		std::sort(used.begin(), used.end());
+		used.erase(std::unique(used.begin(), used.end()), used.end());
+	};
+	drivenOffsets.assign(referencedVertices.size() + 1, 0);
+	for (unsigned int i = 0; i < size(); ++i) {
+		getUsed(i);
+		for (int compactId : used) {
+			++drivenOffsets[compactId + 1];
+		}
+	}
+	for (size_t i = 1; i < drivenOffsets.size(); ++i) {
+		drivenOffsets[i] += drivenOffsets[i - 1];
+	}
+	drivenVertices.resize(drivenOffsets.back());
+	std::vector<unsigned int> next(drivenOffsets.begin(), drivenOffsets.end() - 1);
+	for (unsigned int i = 0; i < size(); ++i) {
+		getUsed(i);
+		for (int compactId : used) {
+			drivenVertices[next[compactId]++] = i;
+		}
+	}
+}
+
+void WrapBinding::UpdateFloatBindMatrices(Precision precision) {
+	if (precision != kPrecisionFloat || mode != kBindMatrix) {
+		std::vector<float>().swap(floatBindMatrices);
+		return;
+	}
+	// Through a const reference, so views of a bind cache are not copied
+	const BindArray<double>& matrices = bindMatrices;
+	unsigned int count = size();
+	floatBindMatrices.resize((size_t)count * 12);
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 3; ++column) {
+			float* entries = &floatBindMatrices[(size_t)(row * 3 + column) * count];
+			for (unsigned int i = 0; i < count; ++i) {
+				entries[i] = (float)matrices[i * 16 + row * 4 + column];
+			}
+		}
+	}
+}
+
+void BindPoint(const double* closestPoint,
+			   const int* triangleVertices,
+			   const double* driverPoints,
+			   const float* driverNormals,
+			   BaryCoords& coords,
+			   double* bindMatrix) {
+	GetBarycentricCoordinates(closestPoint,
+							  &driverPoints[triangleVertices[0] * 3],
+							  &driverPoints[triangleVertices[1] * 3],
+							  &driverPoints[triangleVertices[2] * 3],
+							  coords);
+
+	// Three things needed to generate transform matrix
+	double origin[3], up[3], normal[3];
+	CalculateBasisComponents(coords, triangleVertices, driverPoints, driverNormals, origin, up, normal);
+
+	double matrix[16];
+	CreateMatrix(origin, normal, up, matrix);
+	InvertMatrix(matrix, bindMatrix);
+}
+
+void BindVertex(const double* drivenPoint,
+				const double* closestPoint,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				unsigned int i,
+				WrapBinding& binding) {
+	binding.triangleVerts[i * 3] = triangleVertices[0];
+	binding.triangleVerts[i * 3 + 1] = triangleVertices[1];
+	binding.triangleVerts[i * 3 + 2] = triangleVertices[2];
+	if (binding.mode == kBindOffset) {
+		double bindMatrix[16];
+		BindPoint(closestPoint, triangleVertices, driverPoints, driverNormals, binding.coords[i], bindMatrix);
+		// Pre-multiply the bind position into the bind frame
+		double offset[3];
+		TransformPoint(drivenPoint, bindMatrix, offset);
+		binding.offsets[i * 3] = (float)offset[0];
+		binding.offsets[i * 3 + 1] = (float)offset[1];
+		binding.offsets[i * 3 + 2] = (float)offset[2];
+	} else {
+		BindPoint(closestPoint, triangleVertices, driverPoints, driverNormals, binding.coords[i], &binding.bindMatrices[i * 16]);
+	}
+}
+
+namespace {
+
+/**
+ * @return true if the bind was cancelled, the binding is then cleared
+ */
+bool IsCancelled(const TaskProgress* progress, WrapBinding& binding) {
+	if (progress == nullptr || !progress->cancelled()) {
+		return false;
+	}
+	binding.clear();
+	return true;
+}
+
+}
+
+void BindPoints(const TriangleBvh& bvh,
+				const double* drivenPoints,
+				unsigned int count,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				WrapBinding& binding,
+				unsigned int grainSize,
+				TaskProgress* progress) {
+	if (bvh.triangleCount() == 0) {
+		// Nothing to bind to
+		binding.clear();
+		return;
+	}
+	binding.resize(count);
+	std::vector<int> triangles(count);
+	std::vector<double> closestPoints(count * 3);
+	bvh.ClosestPoints(drivenPoints, count, triangles.data(), closestPoints.data(), grainSize, progress);
+	if (IsCancelled(progress, binding)) {
+		return;
+	}
+	// Each driven vertex only writes its own binding elements
+	ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+		if (progress != nullptr && progress->cancelled()) {
+			return;
+		}
+		for (unsigned int i = begin; i < end; ++i) {
+			BindVertex(&drivenPoints[i * 3], &closestPoints[i * 3], &triangleVertices[triangles[i] * 3],
+					   driverPoints, driverNormals, i, binding);
+		}
+		if (progress != nullptr) {
+			progress->Advance(end - begin);
+		}
+	});
+	IsCancelled(progress, binding);
+}
+
+namespace {
+
+/**
+ * Finds the samples of driven vertices, nearest first over the driver edges.
+ * Keeps its scratch buffers between vertices, one per thread.
+ */
+class SampleCrawler {
+public:
+	SampleCrawler(const VertexTriangles& adjacency, const int* triangleVertices, const double* driverPoints,
+				  const SampleSettings& settings)
+		: adjacency_(adjacency), triangleVertices_(triangleVertices), driverPoints_(driverPoints),
+		  maxInfluences_(settings.maxInfluences), radiusSquared_(settings.radius * settings.radius) {}
+
+	/**
+	 * @param[in] corners The 3 vertex ids of the closest triangle
+	 * @param[in] closestPoint The closest point on the driver
+	 * @param[out] vertices Up to maxInfluences vertex ids, ascending
+	 * @param[out] weights Weight of each vertex, summing to 1
+	 * @return Number of samples, 0 if no driver vertex is in reach
+	 */
+	unsigned int Crawl(const int* corners, const double* closestPoint, int* vertices, float* weights) {
+		ClearVisited();
+		queue_.clear();
+		for (int corner = 0; corner < 3; ++corner) {
+			Visit(corners[corner], closestPoint);
+		}
+		unsigned int count = 0;
+		while (!queue_.empty() && count < maxInfluences_) {
+			// Nearest candidate first, so the samples are the closest ones reachable
+			std::pop_heap(queue_.begin(), queue_.end(), std::greater<Candidate>());
+			Candidate candidate = queue_.back();
+			queue_.pop_back();
+			vertices[count] = candidate.second;
+			// Smooth falloff, 1 at the closest point and 0 at the radius
+			double falloff = 1.0 - candidate.first / radiusSquared_;
+			weights[count] = (float)(falloff * falloff);
+			++count;
+			for (unsigned int j = adjacency_.offsets[candidate.second]; j < adjacency_.offsets[candidate.second + 1]; ++j) {
+				const int* triangle = &triangleVertices_[adjacency_.triangles[j] * 3];
+				for (int corner = 0; corner < 3; ++corner) {
+					Visit(triangle[corner], closestPoint);
+				}
+			}
+		}
+		if (count == 0) {
+			return 0;
+		}
+
+		// Ascending vertex ids so each driven vertex reads the driver in order
+		std::vector<std::pair<int, float>>& samples = samples_;
+		samples.resize(count);
+		double sum = 0.0;
+		for (unsigned int i = 0; i < count; ++i) {
+			samples[i] = std::make_pair(vertices[i], weights[i]);
+			sum += weights[i];
+		}
+		std::sort(samples.begin(), samples.end());
+		for (unsigned int i = 0; i < count; ++i) {
+			vertices[i] = samples[i].first;
+			// Every sample exactly on the radius has no weight, blend them evenly
+			weights[i] = sum > 0.0 ? (float)(samples[i].second / sum) : 1.0f / count;
+		}
+		return count;
+	}
+
+private:
+	typedef std::pair<double, int> Candidate; // Squared distance, vertex id
+
+	// Queues the vertex if it is in reach and was not seen yet
+	void Visit(int vertex, const double* closestPoint) {
+		if (!InsertVisited(vertex)) {
+			return;
+		}
+		const double* p = &driverPoints_[vertex * 3];
+		double d[3] = { p[0] - closestPoint[0], p[1] - closestPoint[1], p[2] - closestPoint[2] };
+		double distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance <= radiusSquared_) {
+			queue_.push_back(Candidate(distance, vertex));
+			std::push_heap(queue_.begin(), queue_.end(), std::greater<Candidate>());
+		}
+	}
+
+	// Open addressing set of the vertices seen by this crawl, kept at most half full
+	bool InsertVisited(int vertex) {
+		if ((visitedSlots_.size() + 1) * 2 > visited_.size()) {
+			GrowVisited();
+		}
+		size_t mask = visited_.size() - 1;
+		uint32_t hash = (uint32_t)vertex * 0x9E3779B1u;
+		for (size_t slot = (hash ^ (hash >> 16)) & mask;; slot = (slot + 1) & mask) {
+			if (visited_[slot] == vertex) {
+				return false;
+			}
+			if (visited_[slot] < 0) {
+				visited_[slot] = vertex;
+				visitedSlots_.push_back(slot);
+				return true;
+			}
+		}
+	}
+
+	// Empties the set through the used slots, so clearing costs what the crawl visited
+	void ClearVisited() {
+		for (size_t slot : visitedSlots_) {
+			visited_[slot] = -1;
+		}
+		visitedSlots_.clear();
+	}
+
+	void GrowVisited() {
+		std::vector<int> vertices;
+		for (size_t slot : visitedSlots_) {
+			vertices.push_back(visited_[slot]);
+		}
+		visited_.assign(std::max<size_t>(visited_.size() * 2, 256), -1);
+		visitedSlots_.clear();
+		for (int vertex : vertices) {
+			InsertVisited(vertex);
+		}
+	}
+
+	const VertexTriangles& adjacency_;
+	const int* triangleVertices_;
+	const double* driverPoints_;
+	unsigned int maxInfluences_;
+	double radiusSquared_;
+	std::vector<int> visited_; // Hash table of vertex ids, -1 for empty slots
+	std::vector<size_t> visitedSlots_; // Filled slots of visited_
+	std::vector<Candidate> queue_;
+	std::vector<std::pair<int, float>> samples_;
+};
+
+}
+
+void BindPoints(const TriangleBvh& bvh,
+				const VertexTriangles& adjacency,
+				const SampleSettings& settings,
+				const double* drivenPoints,
+				unsigned int count,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				WrapBinding& binding,
+				unsigned int grainSize,
+				TaskProgress* progress) {
+	if (settings.radius <= 0.0 || settings.maxInfluences == 0 || bvh.triangleCount() == 0) {
+		binding.sampleOffsets.clear();
+		binding.sampleVertices.clear();
+		binding.sampleWeights.clear();
+		BindPoints(bvh, drivenPoints, count, triangleVertices, driverPoints, driverNormals, binding, grainSize, progress);
+		return;
+	}
+	binding.resize(count);
+	std::vector<int> triangles(count);
+	std::vector<double> closestPoints(count * 3);
+	bvh.ClosestPoints(drivenPoints, count, triangles.data(), closestPoints.data(), grainSize, progress);
+	if (IsCancelled(progress, binding)) {
+		return;
+	}
+
+	// Samples go to fixed size slots first, then are packed into rows once the counts are known
+	unsigned int maxInfluences = std::max(settings.maxInfluences, 3u);
+	std::vector<int> slotVertices((size_t)count * maxInfluences);
+	std::vector<float> slotWeights((size_t)count * maxInfluences);
+	std::vector<unsigned int> sampleCounts(count);
+	ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+		if (progress != nullptr && progress->cancelled()) {
+			return;
+		}
+		SampleCrawler crawler(adjacency, triangleVertices, driverPoints, settings);
+		for (unsigned int i = begin; i < end; ++i) {
+			const int* corners = &triangleVertices[triangles[i] * 3];
+			int* vertices = &slotVertices[(size_t)i * maxInfluences];
+			float* weights = &slotWeights[(size_t)i * maxInfluences];
+			BaryCoords& coords = binding.coords[i];
+			GetBarycentricCoordinates(&closestPoints[i * 3],
+									  &driverPoints[corners[0] * 3],
+									  &driverPoints[corners[1] * 3],
+									  &driverPoints[corners[2] * 3],
+									  coords);
+			unsigned int sampleCount = crawler.Crawl(corners, &closestPoints[i * 3], vertices, weights);
+			if (sampleCount == 0) {
+				// Nothing in reach, follow the triangle like a single sample binding
+				sampleCount = 3;
+				for (int corner = 0; corner < 3; ++corner) {
+					vertices[corner] = corners[corner];
+					weights[corner] = coords[corner];
+				}
+			}
+			sampleCounts[i] = sampleCount;
+
+			binding.triangleVerts[i * 3] = corners[0];
+			binding.triangleVerts[i * 3 + 1] = corners[1];
+			binding.triangleVerts[i * 3 + 2] = corners[2];
+			double origin[3], up[3], normal[3], matrix[16], bindMatrix[16];
+			CalculateSampleBasisComponents(coords, corners, vertices, weights, sampleCount,
+										   driverPoints, driverNormals, origin, up, normal);
+			CreateMatrix(origin, normal, up, matrix);
+			if (binding.mode == kBindOffset) {
+				InvertMatrix(matrix, bindMatrix);
+				double offset[3];
+				TransformPoint(&drivenPoints[i * 3], bindMatrix, offset);
+				binding.offsets[i * 3] = (float)offset[0];
+				binding.offsets[i * 3 + 1] = (float)offset[1];
+				binding.offsets[i * 3 + 2] = (float)offset[2];
+			} else {
+				InvertMatrix(matrix, &binding.bindMatrices[i * 16]);
+			}
+		}
+		if (progress != nullptr) {
+			progress->Advance(end - begin);
+		}
+	});
+	if (IsCancelled(progress, binding)) {
+		return;
+	}
+
+	binding.sampleOffsets.resize(count + 1);
+	binding.sampleOffsets[0] = 0;
+	for (unsigned int i = 0; i < count; ++i) {
+		binding.sampleOffsets[i + 1] = binding.sampleOffsets[i] + sampleCounts[i];
+	}
+	binding.sampleVertices.resize(binding.sampleOffsets[count]);
+	binding.sampleWeights.resize(binding.sampleOffsets[count]);
+	ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; ++i) {
+			std::copy(&slotVertices[(size_t)i * maxInfluences], &slotVertices[(size_t)i * maxInfluences] + sampleCounts[i],
+					  &binding.sampleVertices[binding.sampleOffsets[i]]);
+			std::copy(&slotWeights[(size_t)i * maxInfluences], &slotWeights[(size_t)i * maxInfluences] + sampleCounts[i],
+					  &binding.sampleWeights[binding.sampleOffsets[i]]);
+		}
+	});
+}
+
+void OrderBindingForLocality(const double* drivenPoints, WrapBinding& binding) {
+	unsigned int count = binding.size();
+	// Read through a const reference, so views of a bind cache are not copied
+	const WrapBinding& source = binding;
+	std::vector<double> points((size_t)count * 3);
+	for (unsigned int i = 0; i < count; ++i) {
+		std::copy(&drivenPoints[source.vertexId(i) * 3], &drivenPoints[source.vertexId(i) * 3] + 3, &points[i * 3]);
+	}
+	std::vector<unsigned int> order;
+	GetMortonOrder(points.data(), count, order);
+
+	WrapBinding ordered;
+	ordered.mode = source.mode;
+	ordered.normals = source.normals;
+	ordered.resize(count);
+	ordered.vertexOrder.resize(count);
+	if (source.hasSamples()) {
+		ordered.sampleOffsets.resize(count + 1);
+		ordered.sampleVertices.resize(source.sampleVertices.size());
+		ordered.sampleWeights.resize(source.sampleWeights.size());
+		ordered.sampleOffsets[0] = 0;
+	}
+	for (unsigned int k = 0; k < count; ++k) {
+		unsigned int i = order[k];
+		ordered.vertexOrder[k] = source.vertexId(i);
+		std::copy(&source.triangleVerts[i * 3], &source.triangleVerts[i * 3] + 3, &ordered.triangleVerts[k * 3]);
+		ordered.coords[k] = source.coords[i];
+		if (source.mode == kBindOffset) {
+			std::copy(&source.offsets[i * 3], &source.offsets[i * 3] + 3, &ordered.offsets[k * 3]);
+		} else {
+			std::copy(&source.bindMatrices[i * 16], &source.bindMatrices[i * 16] + 16, &ordered.bindMatrices[k * 16]);
+		}
+		if (source.hasSamples()) {
+			unsigned int first = source.sampleOffsets[i], last = source.sampleOffsets[i + 1];
+			unsigned int start = ordered.sampleOffsets[k];
+			std::copy(source.sampleVertices.data() + first, source.sampleVertices.data() + last, &ordered.sampleVertices[start]);
+			std::copy(source.sampleWeights.data() + first, source.sampleWeights.data() + last, &ordered.sampleWeights[start]);
+			ordered.sampleOffsets[k + 1] = start + last - first;
+		}
+	}
+	binding = std::move(ordered);
+}
+
+bool IsPermutation(const unsigned int* order, unsigned int count) {
+	std::vector<bool> seen(count, false);
+	for (unsigned int i = 0; i < count; ++i) {
+		if (order[i] >= count || seen[order[i]]) {
+			return false;
+		}
+		seen[order[i]] = true;
+	}
+	return true;
+}
+
+template <typename Real>
+void GatherDrivenPoints(const WrapBinding& binding, const double* drivenPoints,
+						unsigned int begin, unsigned int end, Real* points) {
+	for (unsigned int i = begin; i < end; ++i) {
+		const double* point = &drivenPoints[binding.vertexId(i) * 3];
+		points[i * 3] = (Real)point[0];
+		points[i * 3 + 1] = (Real)point[1];
+		points[i * 3 + 2] = (Real)point[2];
+	}
+}
+
+template <typename Real>
+void ScatterDrivenPoints(const WrapBinding& binding, const Real* points,
+						 unsigned int begin, unsigned int end, double* drivenPoints) {
+	for (unsigned int i = begin; i < end; ++i) {
+		double* point = &drivenPoints[binding.vertexId(i) * 3];
+		point[0] = points[i * 3];
+		point[1] = points[i * 3 + 1];
+		point[2] = points[i * 3 + 2];
+	}
+}
+
+namespace {
+
+void SetBindMatrices(const WrapBinding& binding, DeformBuffers<double>& buffers) {
+	buffers.bindMatrices = binding.bindMatrices.data();
+	buffers.bindMatrixVertexStride = 16;
+	buffers.bindMatrixRowStride = 4;
+	buffers.bindMatrixColumnStride = 1;
+}
+
+void SetBindMatrices(const WrapBinding& binding, DeformBuffers<float>& buffers) {
+	buffers.bindMatrices = binding.floatBindMatrices.data();
+	buffers.bindMatrixVertexStride = 1;
+	buffers.bindMatrixRowStride = (size_t)binding.size() * 3;
+	buffers.bindMatrixColumnStride = binding.size();
+}
+
+// Inverse bind matrix of driven vertex i in any layout
+template <typename Real>
+void GetBindMatrix(const DeformBuffers<Real>& buffers, unsigned int i, Real* matrix) {
+	const Real* entries = buffers.bindMatrices + i * buffers.bindMatrixVertexStride;
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 3; ++column) {
+			matrix[row * 4 + column] = entries[row * buffers.bindMatrixRowStride + column * buffers.bindMatrixColumnStride];
+		}
+		matrix[row * 4 + 3] = row == 3 ? Real(1) : Real(0);
+	}
+}
+
+// compact picks the vertex ids remapped by UpdateReferencedVertices
+template <typename Real>
+DeformBuffers<Real> GetDeformBuffers(const WrapBinding& binding,
+									 bool compact,
+									 const Real* driverPoints,
+									 const float* driverNormals,
+									 const Real* localToWorld,
+									 const Real* worldToLocal,
+									 Real* points) {
+	DeformBuffers<Real> buffers;
+	buffers.triangleVerts = compact ? binding.compactTriangleVerts.data() : binding.triangleVerts.data();
+	buffers.coords = binding.coords.empty() ? nullptr : binding.coords[0].coords;
+	SetBindMatrices(binding, buffers);
+	if (binding.mode != kBindMatrix) {
+		buffers.bindMatrices = nullptr;
+	}
+	buffers.offsets = binding.mode == kBindOffset ? binding.offsets.data() : nullptr;
+	buffers.sampleOffsets = binding.hasSamples() ? binding.sampleOffsets.data() : nullptr;
+	buffers.sampleVertices = compact ? binding.compactSampleVertices.data() : binding.sampleVertices.data();
+	buffers.sampleWeights = binding.sampleWeights.data();
+	buffers.driverPoints = driverPoints;
+	buffers.driverNormals = driverNormals;
+	buffers.localToWorld = localToWorld;
+	buffers.worldToLocal = worldToLocal;
+	buffers.points = points;
+	return buffers;
+}
+
+/**
+ * localToWorld and its inverse in the precision of the deform
+ */
+template <typename Real>
+struct DeformMatrices {
+	explicit DeformMatrices(const double* matrix) {
+		double inverse[16];
+		InvertMatrix(matrix, inverse);
+		std::copy(matrix, matrix + 16, localToWorld);
+		std::copy(inverse, inverse + 16, worldToLocal);
+	}
+
+	Real localToWorld[16];
+	Real worldToLocal[16];
+};
+
+template <typename Real>
+void DeformRangeScalar(const DeformBuffers<Real>& buffers, unsigned int begin, unsigned int end) {
+	Real matrix[16];
+	Real bindMatrix[16];
+	Real offset[16];
+	for (unsigned int i = begin; i < end; ++i) {
+		const int* triangleVertices = &buffers.triangleVerts[i * 3];
+		const BaryCoords& coords = *reinterpret_cast<const BaryCoords*>(&buffers.coords[i * 3]);
+
+		// Three things needed to generate transform matrix
+		Real origin[3], up[3], normal[3];
+		if (buffers.sampleOffsets != nullptr) {
+			unsigned int first = buffers.sampleOffsets[i];
+			CalculateSampleBasisComponents(coords, triangleVertices,
+										   &buffers.sampleVertices[first], &buffers.sampleWeights[first],
+										   buffers.sampleOffsets[i + 1] - first,
+										   buffers.driverPoints, buffers.driverNormals,
+										   origin, up, normal);
+		} else {
+			CalculateBasisComponents(coords, triangleVertices,
+									 buffers.driverPoints, buffers.driverNormals,
+									 origin, up, normal);
+		}
+		CreateMatrix(origin, normal, up, matrix);
+
+		Real* point = &buffers.points[i * 3];
+		if (buffers.offsets != nullptr) {
+			const float* localOffset = &buffers.offsets[i * 3];
+			Real local[3] = { localOffset[0], localOffset[1], localOffset[2] };
+			TransformPoint(local, matrix, point);
+		} else {
+			// multiplying bindMatrix * matrix gives you an offset from where it was bound, to where it currently is.
+			GetBindMatrix(buffers, i, bindMatrix);
+			MultiplyMatrix(bindMatrix, matrix, offset);
+			TransformPoint(point, buffers.localToWorld, point);
+			TransformPoint(point, offset, point);
+		}
+		TransformPoint(point, buffers.worldToLocal, point);
+	}
+}
+
+template <typename Real>
+void DeformRange(const DeformBuffers<Real>& buffers, unsigned int begin, unsigned int end) {
+	SimdLevel level = GetSimdLevel();
+	unsigned int done = begin;
+#if defined(WRAP_SIMD_X86)
+	if (begin < end) {
+		switch (level) {
+#if defined(WRAP_SIMD_AVX512)
+		case kSimdAvx512:
+			done = DeformPointsAvx512(buffers, begin, end);
+			break;
+#endif
+		case kSimdAvx2:
+			done = DeformPointsAvx2(buffers, begin, end);
+			break;
+		case kSimdSse:
+			done = DeformPointsSse(buffers, begin, end);
+			break;
+		default:
+			break;
+		}
+	}
+#endif
+	// Vertices that do not fill a whole vector
+	DeformRangeScalar(buffers, done, end);
+}
+
+}
+
+template <typename Real>
+void DeformPointsScalar(const WrapBinding& binding,
+						const Real* driverPoints,
+						const float* driverNormals,
+						const double* localToWorld,
+						unsigned int begin, unsigned int end,
+						Real* points) {
+	DeformMatrices<Real> matrices(localToWorld);
+	DeformRangeScalar(GetDeformBuffers(binding, false, driverPoints, driverNormals,
+									   matrices.localToWorld, matrices.worldToLocal, points),
+					  begin, end);
+}
+
+template <typename Real>
+void DeformPoints(const WrapBinding& binding,
+				  const Real* driverPoints,
+				  const float* driverNormals,
+				  const double* localToWorld,
+				  unsigned int begin, unsigned int end,
+				  Real* points) {
+	DeformMatrices<Real> matrices(localToWorld);
+	DeformRange(GetDeformBuffers(binding, false, driverPoints, driverNormals,
+								 matrices.localToWorld, matrices.worldToLocal, points),
+				begin, end);
+}
+
+template <typename Real>
+void GatherReferencedVertices(const WrapBinding& binding,
+							  const double* driverPoints,
+							  const float* driverNormals,
+							  unsigned int begin, unsigned int end,
+							  Real* compactPoints,
+							  float* compactNormals) {
+	for (unsigned int i = begin; i < end; ++i) {
+		int vertex = binding.referencedVertices[i];
+		compactPoints[i * 3] = (Real)driverPoints[vertex * 3];
+		compactPoints[i * 3 + 1] = (Real)driverPoints[vertex * 3 + 1];
+		compactPoints[i * 3 + 2] = (Real)driverPoints[vertex * 3 + 2];
+	}
+	if (driverNormals == nullptr) {
+		return;
+	}
+	for (unsigned int i = begin; i < end; ++i) {
+		int vertex = binding.referencedVertices[i];
+		compactNormals[i * 3] = driverNormals[vertex * 3];
+		compactNormals[i * 3 + 1] = driverNormals[vertex * 3 + 1];
+		compactNormals[i * 3 + 2] = driverNormals[vertex * 3 + 2];
+	}
+}
+
+template <typename Real>
+void DeformPointsCompact(const WrapBinding& binding,
+						 const Real* compactPoints,
+						 const float* compactNormals,
+						 const double* localToWorld,
+						 unsigned int begin, unsigned int end,
+						 Real* points) {
+	DeformMatrices<Real> matrices(localToWorld);
+	// The compact vertices stand in for the driver vertices, so the kernels are the same
+	DeformRange(GetDeformBuffers(binding, true, compactPoints, compactNormals,
+								 matrices.localToWorld, matrices.worldToLocal, points),
+				begin, end);
+}
+
+template <typename Real>
+void DeformPointsCompactIndexed(const WrapBinding& binding,
+								const Real* compactPoints,
+								const float* compactNormals,
+								const double* localToWorld,
+								const unsigned int* indices, unsigned int count,
+								Real* points) {
+	DeformMatrices<Real> matrices(localToWorld);
+	DeformBuffers<Real> buffers = GetDeformBuffers(binding, true, compactPoints, compactNormals,
+												   matrices.localToWorld, matrices.worldToLocal, points);
+	for (unsigned int i = 0; i < count;) {
+		unsigned int runEnd = i + 1;
+		while (runEnd < count && indices[runEnd] == indices[runEnd - 1] + 1) {
+			++runEnd;
+		}
+		DeformRange(buffers, indices[i], indices[runEnd - 1] + 1);
+		i = runEnd;
+	}
+}
+
+bool FindActiveVertices(const float* weights, unsigned int count, std::vector<unsigned int>& active) {
+	active.clear();
+	bool allOne = true;
+	for (unsigned int i = 0; i < count; ++i) {
+		if (weights[i] != 0.0f) {
+			active.push_back(i);
+		}
+		allOne = allOne && weights[i] == 1.0f;
+	}
+	return allOne;
+}
+
+template <typename Real>
+void ApplyWeights(const Real* inputPoints,
+				  const float* weights,
+				  float envelope,
+				  const unsigned int* indices, unsigned int count,
+				  Real* points) {
+	for (unsigned int j = 0; j < count; ++j) {
+		unsigned int i = indices[j];
+		Real weight = (Real)weights[i] * envelope;
+		const Real* input = &inputPoints[i * 3];
+		Real* point = &points[i * 3];
+		point[0] = input[0] + (point[0] - input[0]) * weight;
+		point[1] = input[1] + (point[1] - input[1]) * weight;
+		point[2] = input[2] + (point[2] - input[2]) * weight;
+	}
+}
+
+template <typename Real>
+bool FindAffectedVertices(const WrapBinding& binding,
+						  const Real* previousPoints,
+						  const float* previousNormals,
+						  const Real* compactPoints,
+						  const float* compactNormals,
+						  unsigned int maxChangedVertices,
+						  std::vector<unsigned int>& affected) {
+	affected.clear();
+	unsigned int changedCount = 0;
+	for (unsigned int v = 0; v < binding.referencedVertexCount(); ++v) {
+		const Real* p = &compactPoints[v * 3];
+		const Real* previousP = &previousPoints[v * 3];
+		const float* n = &compactNormals[v * 3];
+		const float* previousN = &previousNormals[v * 3];
+		if (p[0] == previousP[0] && p[1] == previousP[1] && p[2] == previousP[2] &&
+			n[0] == previousN[0] && n[1] == previousN[1] && n[2] == previousN[2]) {
+			continue;
+		}
+		if (++changedCount > maxChangedVertices) {
+			return false;
+		}
+		affected.insert(affected.end(),
+						binding.drivenVertices.begin() + binding.drivenOffsets[v],
+						binding.drivenVertices.begin() + binding.drivenOffsets[v + 1]);
+	}
+	std::sort(affected.begin(), affected.end());
+	affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+	return true;
+}
+
+// kPrecisionDouble and kPrecisionFloat deforms
+template void GatherDrivenPoints(const WrapBinding&, const double*, unsigned int, unsigned int, double*);
+template void ScatterDrivenPoints(const WrapBinding&, const double*, unsigned int, unsigned int, double*);
+template void DeformPointsScalar(const WrapBinding&, const double*, const float*, const double*, unsigned int, unsigned int, double*);
+template void DeformPoints(const WrapBinding&, const double*, const float*, const double*, unsigned int, unsigned int, double*);
+template void GatherReferencedVertices(const WrapBinding&, const double*, const float*, unsigned int, unsigned int,
+									   double*, float*);
+template void DeformPointsCompact(const WrapBinding&, const double*, const float*, const double*, unsigned int, unsigned int, double*);
+template void DeformPointsCompactIndexed(const WrapBinding&, const double*, const float*, const double*,
+										 const unsigned int*, unsigned int, double*);
+template void ApplyWeights(const double*, const float*, float, const unsigned int*, unsigned int, double*);
+template bool FindAffectedVertices(const WrapBinding&, const double*, const float*, const double*, const float*, unsigned int,
+								   std::vector<unsigned int>&);
+template void GatherDrivenPoints(const WrapBinding&, const double*, unsigned int, unsigned int, float*);
+template void ScatterDrivenPoints(const WrapBinding&, const float*, unsigned int, unsigned int, double*);
+template void DeformPointsScalar(const WrapBinding&, const float*, const float*, const double*, unsigned int, unsigned int, float*);
+template void DeformPoints(const WrapBinding&, const float*, const float*, const double*, unsigned int, unsigned int, float*);
+template void GatherReferencedVertices(const WrapBinding&, const double*, const float*, unsigned int, unsigned int,
+									   float*, float*);
+template void DeformPointsCompact(const WrapBinding&, const float*, const float*, const double*, unsigned int, unsigned int, float*);
+template void DeformPointsCompactIndexed(const WrapBinding&, const float*, const float*, const double*,
+										 const unsigned int*, unsigned int, float*);
+template void ApplyWeights(const float*, const float*, float, const unsigned int*, unsigned int, float*);
+template bool FindAffectedVertices(const WrapBinding&, const float*, const float*, const float*, const float*, unsigned int,
+								   std::vector<unsigned int>&);
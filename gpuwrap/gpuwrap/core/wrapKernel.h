@@ -0,0 +1,385 @@
+/*
+ * Maya-independent bind and deform kernels.
+ *
+ * Binding always runs in double. The deform functions are templated on the
+ * scalar type of the driver and driven points and instantiated for double
+ * and float, see Precision.
+ */
+
+#ifndef WRAP_CORE_KERNEL_H
+#define WRAP_CORE_KERNEL_H
+
+#include "bindArray.h"
+#include "threadPool.h"
+#include "triangleBvh.h"
+#include "vertexNormals.h"
+#include "wrapMath.h"
+
+#include <vector>
+
+/**
+ * How the driven vertex position relative to its driver frame is stored
+ */
+enum BindMode {
+	/**
+	 * Inverse bind frame per vertex, 16 doubles. The current input position is
+	 * carried through it, so upstream deformation of the driven mesh is kept.
+	 */
+	kBindMatrix = 0,
+	/**
+	 * Bind position already expressed in the bind frame, 3 floats per vertex.
+	 * Deforming is one affine transform by the current frame.
+	 */
+	kBindOffset = 1,
+};
+
+/**
+ * Which driver vertex normals a binding was made with. Deforming has to use
+ * the same ones or the driven mesh moves away from its bind pose.
+ */
+enum DriverNormals {
+	/** MFnMesh::getVertexNormals, bindings made before the built-in normals */
+	kMayaNormals = 0,
+	/** ComputeVertexNormals over the driver triangles */
+	kAreaWeightedNormals = 1,
+};
+
+/**
+ * Scalar type a geometry is deformed in
+ */
+enum Precision {
+	/** Doubles for the driver, the frames and the driven points, for precision critical cases */
+	kPrecisionDouble = 0,
+	/**
+	 * Floats throughout, enough for rendering and playback. Half the memory
+	 * traffic of double and twice the vertices per vector instruction.
+	 */
+	kPrecisionFloat = 1,
+};
+
+/**
+ * Binding of one driven geometry to the driver, stored as flat arrays.
+ * Element i belongs to the driven vertex vertexOrder[i], or to the driven
+ * vertex with logical index i without a vertex order. Points passed to the
+ * deform functions are in element order, see GatherDrivenPoints.
+ */
+struct WrapBinding {
+	BindMode mode = kBindMatrix;
+	DriverNormals normals = kAreaWeightedNormals;
+	BindArray<int> triangleVerts; /**< 3 driver vertex ids per driven vertex */
+	BindArray<BaryCoords> coords; /**< Barycentric weights of the closest point */
+	BindArray<double> bindMatrices; /**< kBindMatrix: inverse bind matrix, 16 doubles per driven vertex */
+	BindArray<float> offsets; /**< kBindOffset: position in the bind frame, 3 floats per driven vertex */
+
+	// Multi-sample bindings blend the frame origin and normal from several driver
+	// vertices instead of the triangle corners. Empty when the corners are used.
+	BindArray<unsigned int> sampleOffsets; /**< Start of each driven vertex in sampleVertices, one extra at the end */
+	BindArray<int> sampleVertices; /**< Driver vertex ids blended by each driven vertex, ascending per driven vertex */
+	BindArray<float> sampleWeights; /**< Weight of each sample, summing to 1 per driven vertex */
+	BindArray<unsigned int> vertexOrder; /**< Driven vertex of each element, empty when element i is driven vertex i */
+
+	// Derived by UpdateReferencedVertices, not stored in scenes
+	std::vector<int> referencedVertices; /**< Driver vertex id of each compact vertex */
+	std::vector<int> compactTriangleVerts; /**< triangleVerts remapped to compact vertex ids */
+	std::vector<int> compactSampleVertices; /**< sampleVertices remapped to compact vertex ids */
+	std::vector<unsigned int> drivenOffsets; /**< Start of each compact vertex in drivenVertices, one extra at the end */
+	std::vector<unsigned int> drivenVertices; /**< Driven vertices using each compact vertex, ascending */
+	std::vector<float> floatBindMatrices; /**< kBindMatrix: affine part of bindMatrices in float for kPrecisionFloat deforms,
+											   entry major: entry row * 3 + column of every driven vertex is contiguous */
+
+	unsigned int size() const { return (unsigned int)coords.size(); }
+	unsigned int referencedVertexCount() const { return (unsigned int)referencedVertices.size(); }
+	bool hasSamples() const { return !sampleOffsets.empty(); }
+	bool hasVertexOrder() const { return !vertexOrder.empty(); }
+	/**
+	 * @return The driven vertex of element i
+	 */
+	unsigned int vertexId(unsigned int i) const { return vertexOrder.empty() ? i : vertexOrder[i]; }
+	/**
+	 * Resizes the per driven vertex arrays of the mode and drops the vertex order, the samples are left alone
+	 */
+	void resize(unsigned int count);
+	void clear();
+	/**
+	 * Collects the driver vertices used by triangleVerts and sampleVertices into a compact index
+	 * space, for GatherReferencedVertices and DeformPointsCompact, and indexes
+	 * the driven vertices using each of them
+	 */
+	void UpdateReferencedVertices();
+	/**
+	 * Fills floatBindMatrices from bindMatrices for float deforms, or releases them
+	 * @param[in] precision Precision the binding is deformed in
+	 */
+	void UpdateFloatBindMatrices(Precision precision);
+};
+
+/**
+ * Settings of multi-sample bindings
+ */
+struct SampleSettings {
+	unsigned int maxInfluences = 8; /**< Most driver vertices blended per driven vertex */
+	double radius = 0.0; /**< Falloff radius around the closest point, 0 only follows the triangle corners */
+};
+
+/** Progress steps BindPoints takes per driven point, the closest point and the bind frame */
+const unsigned int kBindStepsPerPoint = 2;
+
+/**
+ * Calculates the binding of a single driven vertex
+ * @param[in] closestPoint The closest point on the driver, in the driver space
+ * @param[in] triangleVertices The 3 vertex ids of the driver triangle containing closestPoint
+ * @param[in] driverPoints The driver points, 3 doubles per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex
+ * @param[out] coords Barycentric coordinates of the closest point
+ * @param[out] bindMatrix Inverse of the basis matrix at the closest point, 16 doubles
+ */
+void BindPoint(const double* closestPoint,
+			   const int* triangleVertices,
+			   const double* driverPoints,
+			   const float* driverNormals,
+			   BaryCoords& coords,
+			   double* bindMatrix);
+
+/**
+ * Calculates the binding of driven vertex i and stores it in the binding's mode
+ * @param[in] drivenPoint The driven vertex position, in the driver space
+ * @param[in] closestPoint The closest point on the driver, in the driver space
+ * @param[in] triangleVertices The 3 vertex ids of the driver triangle containing closestPoint
+ * @param[in] driverPoints The driver points, 3 doubles per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex
+ * @param[in] i Driven vertex index
+ * @param[in,out] binding Binding sized to hold vertex i
+ */
+void BindVertex(const double* drivenPoint,
+				const double* closestPoint,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				unsigned int i,
+				WrapBinding& binding);
+
+/**
+ * Binds every driven point to its closest driver triangle, in parallel.
+ * The binding keeps its mode and is resized to count.
+ * @param[in] bvh Tree built over the driver triangles
+ * @param[in] drivenPoints The driven points, in the driver space, 3 doubles per vertex
+ * @param[in] count Number of driven points
+ * @param[in] triangleVertices The 3 vertex ids of each driver triangle
+ * @param[in] driverPoints The driver points, 3 doubles per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex
+ * @param[in,out] binding Binding of the driven geometry, cleared when cancelled
+ * @param[in] grainSize Driven points per parallel task
+ * @param[in,out] progress Advanced by kBindStepsPerPoint steps per driven point, stops the bind when cancelled.
+ * May be null.
+ */
+void BindPoints(const TriangleBvh& bvh,
+				const double* drivenPoints,
+				unsigned int count,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				WrapBinding& binding,
+				unsigned int grainSize = kDefaultGrainSize,
+				TaskProgress* progress = nullptr);
+
+/**
+ * BindPoints with the frame origin and normal of each driven vertex blended
+ * from up to settings.maxInfluences driver vertices within settings.radius of
+ * its closest point. The samples are found nearest first by crawling the
+ * driver edges out from the closest triangle, so parts of the driver that are
+ * close in space but not connected are never picked up, and are weighted by a
+ * smooth falloff. Driven vertices without a driver vertex in reach keep the
+ * triangle corners as samples. A radius of 0 gives the same result as
+ * BindPoints.
+ * @param[in] bvh Tree built over the driver triangles
+ * @param[in] adjacency Triangles around each driver vertex
+ * @param[in] settings Number of samples and falloff radius
+ * @param[in] drivenPoints The driven points, in the driver space, 3 doubles per vertex
+ * @param[in] count Number of driven points
+ * @param[in] triangleVertices The 3 vertex ids of each driver triangle
+ * @param[in] driverPoints The driver points, 3 doubles per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex
+ * @param[in,out] binding Binding of the driven geometry, cleared when cancelled
+ * @param[in] grainSize Driven points per parallel task
+ * @param[in,out] progress Advanced by kBindStepsPerPoint steps per driven point, stops the bind when cancelled.
+ * May be null.
+ */
+void BindPoints(const TriangleBvh& bvh,
+				const VertexTriangles& adjacency,
+				const SampleSettings& settings,
+				const double* drivenPoints,
+				unsigned int count,
+				const int* triangleVertices,
+				const double* driverPoints,
+				const float* driverNormals,
+				WrapBinding& binding,
+				unsigned int grainSize = kDefaultGrainSize,
+				TaskProgress* progress = nullptr);
+
+/**
+ * Stores a binding in a deform order with locality: along a Morton curve over
+ * the driven points, so driven vertices deformed together are close in space
+ * and read the same driver vertices. UpdateReferencedVertices then hands out
+ * compact ids in that order too, so the driver reads walk memory forwards
+ * however the driver and driven meshes are numbered. Sets vertexOrder to
+ * map the elements back to driven vertices, the derived arrays are cleared.
+ * @param[in] drivenPoints The driven points, 3 doubles per driven vertex in driven vertex order
+ * @param[in,out] binding Binding to reorder, with or without a vertex order
+ */
+void OrderBindingForLocality(const double* drivenPoints, WrapBinding& binding);
+
+/**
+ * @return true if order holds every element id below count exactly once
+ */
+bool IsPermutation(const unsigned int* order, unsigned int count);
+
+/**
+ * Copies driven points into the element order of a binding
+ * @param[in] binding Binding of the driven geometry
+ * @param[in] drivenPoints 3 doubles per driven vertex in driven vertex order
+ * @param[in] begin First element to copy
+ * @param[in] end One past the last element to copy
+ * @param[out] points 3 scalars per element
+ */
+template <typename Real>
+void GatherDrivenPoints(const WrapBinding& binding, const double* drivenPoints,
+						unsigned int begin, unsigned int end, Real* points);
+
+/**
+ * Copies points in element order back to driven vertex order
+ * @param[in] binding Binding of the driven geometry
+ * @param[in] points 3 scalars per element
+ * @param[in] begin First element to copy
+ * @param[in] end One past the last element to copy
+ * @param[out] drivenPoints 3 doubles per driven vertex in driven vertex order
+ */
+template <typename Real>
+void ScatterDrivenPoints(const WrapBinding& binding, const Real* points,
+						 unsigned int begin, unsigned int end, double* drivenPoints);
+
+/**
+ * Deforms driven points to follow the driver, using the widest kernel
+ * allowed by GetSimdLevel. In kBindOffset mode the input points are not read.
+ * Float deforms of kBindMatrix bindings need UpdateFloatBindMatrices first.
+ * @param[in] binding Binding of the driven geometry
+ * @param[in] driverPoints The driver points, 3 scalars per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex
+ * @param[in] localToWorld Driven geometry local to world matrix, 16 doubles
+ * @param[in] begin First driven vertex to deform
+ * @param[in] end One past the last driven vertex to deform
+ * @param[in,out] points Driven points in local space, 3 scalars per element
+ */
+template <typename Real>
+void DeformPoints(const WrapBinding& binding,
+				  const Real* driverPoints,
+				  const float* driverNormals,
+				  const double* localToWorld,
+				  unsigned int begin, unsigned int end,
+				  Real* points);
+
+/**
+ * Copies the driver points and normals used by the binding into compact
+ * buffers, so each is fetched once however many driven vertices use it and
+ * unused driver vertices are never read.
+ * @param[in] binding Binding with up to date referenced vertices
+ * @param[in] driverPoints The driver points, 3 doubles per vertex
+ * @param[in] driverNormals The driver per-vertex normals, 3 floats per vertex, null to only gather points
+ * @param[in] begin First compact vertex to gather
+ * @param[in] end One past the last compact vertex to gather
+ * @param[out] compactPoints 3 scalars per compact vertex, converted to the precision of the deform
+ * @param[out] compactNormals 3 floats per compact vertex, untouched without driverNormals
+ */
+template <typename Real>
+void GatherReferencedVertices(const WrapBinding& binding,
+							  const double* driverPoints,
+							  const float* driverNormals,
+							  unsigned int begin, unsigned int end,
+							  Real* compactPoints,
+							  float* compactNormals);
+
+/**
+ * DeformPoints reading the driver from the buffers filled by GatherReferencedVertices.
+ * The result is the same as DeformPoints on the full driver.
+ */
+template <typename Real>
+void DeformPointsCompact(const WrapBinding& binding,
+						 const Real* compactPoints,
+						 const float* compactNormals,
+						 const double* localToWorld,
+						 unsigned int begin, unsigned int end,
+						 Real* points);
+
+/**
+ * DeformPointsCompact on a list of driven vertices. Runs of consecutive ids
+ * use the vector kernels.
+ * @param[in] indices Driven vertex ids, ascending
+ * @param[in] count Number of ids
+ */
+template <typename Real>
+void DeformPointsCompactIndexed(const WrapBinding& binding,
+								const Real* compactPoints,
+								const float* compactNormals,
+								const double* localToWorld,
+								const unsigned int* indices, unsigned int count,
+								Real* points);
+
+/**
+ * Collects the driven vertices with a non-zero weight, the only ones worth deforming
+ * @param[in] weights Weight per element
+ * @param[in] count Number of driven vertices
+ * @param[out] active Driven vertices with a non-zero weight, ascending
+ * @return true if every weight is exactly 1, so no blending is needed
+ */
+bool FindActiveVertices(const float* weights, unsigned int count, std::vector<unsigned int>& active);
+
+/**
+ * Moves deformed points back towards their input by weight * envelope,
+ * p = input + (p - input) * weight * envelope
+ * @param[in] inputPoints Points before deforming, 3 scalars per element
+ * @param[in] weights Weight per element
+ * @param[in] envelope Scale of every weight
+ * @param[in] indices Driven vertices to blend
+ * @param[in] count Number of indices
+ * @param[in,out] points Deformed points, 3 scalars per element
+ */
+template <typename Real>
+void ApplyWeights(const Real* inputPoints,
+				  const float* weights,
+				  float envelope,
+				  const unsigned int* indices, unsigned int count,
+				  Real* points);
+
+/**
+ * Finds the driven vertices whose driver data changed between two gathers,
+ * for re-evaluating only part of the driven geometry
+ * @param[in] binding Binding with up to date referenced vertices
+ * @param[in] previousPoints Compact points of the previous evaluation
+ * @param[in] previousNormals Compact normals of the previous evaluation
+ * @param[in] compactPoints Compact points of this evaluation
+ * @param[in] compactNormals Compact normals of this evaluation
+ * @param[in] maxChangedVertices Give up once more compact vertices than this changed
+ * @param[out] affected Driven vertices using a changed compact vertex, ascending
+ * @return false if more than maxChangedVertices changed, affected is then incomplete
+ */
+template <typename Real>
+bool FindAffectedVertices(const WrapBinding& binding,
+						  const Real* previousPoints,
+						  const float* previousNormals,
+						  const Real* compactPoints,
+						  const float* compactNormals,
+						  unsigned int maxChangedVertices,
+						  std::vector<unsigned int>& affected);
+
+/**
+ * Scalar reference version of DeformPoints, one driven vertex at a time.
+ * The vector kernels are validated against it.
+ */
+template <typename Real>
+void DeformPointsScalar(const WrapBinding& binding,
+						const Real* driverPoints,
+						const float* driverNormals,
+						const double* localToWorld,
+						unsigned int begin, unsigned int end,
+						Real* points);
+
+#endif
@@ -0,0 +1,96 @@
+#include "simd.h"
+
+#if defined(WRAP_SIMD_X86)
+
+// Built with AVX2 and FMA enabled, only called when the CPU reports both
+#include <immintrin.h>
+
+#include "wrapKernelSoA.h"
+
+namespace {
+
+struct PackAvx2 {
+	static const unsigned int kWidth = 4;
+	typedef double Scalar;
+	typedef __m256d Real;
+	typedef __m256d Mask;
+	typedef __m128i Index;
+
+	static Real Set(double value) { return _mm256_set1_pd(value); }
+	static Real Add(Real a, Real b) { return _mm256_add_pd(a, b); }
+	static Real Sub(Real a, Real b) { return _mm256_sub_pd(a, b); }
+	static Real Mul(Real a, Real b) { return _mm256_mul_pd(a, b); }
+	static Real Div(Real a, Real b) { return _mm256_div_pd(a, b); }
+	static Real Sqrt(Real a) { return _mm256_sqrt_pd(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm256_fmadd_pd(a, b, c); }
+	static Mask Less(Real a, Real b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static Mask Greater(Real a, Real b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm256_blendv_pd(b, a, mask); }
+
+	static Index Stride(int stride) { return _mm_setr_epi32(0, stride, stride * 2, stride * 3); }
+	static Real Load(const double* base) { return _mm256_loadu_pd(base); }
+	static Index LoadIndex(const int* base, int stride) { return _mm_i32gather_epi32(base, Stride(stride), 4); }
+	static Index ScaleIndex(Index index, int factor) { return _mm_mullo_epi32(index, _mm_set1_epi32(factor)); }
+	static Real Gather(const double* base, Index index) { return _mm256_i32gather_pd(base, index, 8); }
+	static Real GatherFloat(const float* base, Index index) { return _mm256_cvtps_pd(_mm_i32gather_ps(base, index, 4)); }
+	static Real LoadStrided(const double* base, int stride) { return Gather(base, Stride(stride)); }
+	static Real LoadStridedFloat(const float* base, int stride) { return GatherFloat(base, Stride(stride)); }
+	static void StoreStrided(double* base, int stride, Real value) {
+		__m128d low = _mm256_castpd256_pd128(value);
+		__m128d high = _mm256_extractf128_pd(value, 1);
+		_mm_storel_pd(base, low);
+		_mm_storeh_pd(base + stride, low);
+		_mm_storel_pd(base + stride * 2, high);
+		_mm_storeh_pd(base + stride * 3, high);
+	}
+};
+
+struct PackAvx2Float {
+	static const unsigned int kWidth = 8;
+	typedef float Scalar;
+	typedef __m256 Real;
+	typedef __m256 Mask;
+	typedef __m256i Index;
+
+	static Real Set(float value) { return _mm256_set1_ps(value); }
+	static Real Add(Real a, Real b) { return _mm256_add_ps(a, b); }
+	static Real Sub(Real a, Real b) { return _mm256_sub_ps(a, b); }
+	static Real Mul(Real a, Real b) { return _mm256_mul_ps(a, b); }
+	static Real Div(Real a, Real b) { return _mm256_div_ps(a, b); }
+	static Real Sqrt(Real a) { return _mm256_sqrt_ps(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm256_fmadd_ps(a, b, c); }
+	static Mask Less(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Mask Greater(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm256_blendv_ps(b, a, mask); }
+
+	static Index Stride(int stride) {
+		return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	}
+	static Real Load(const float* base) { return _mm256_loadu_ps(base); }
+	static Index LoadIndex(const int* base, int stride) { return _mm256_i32gather_epi32(base, Stride(stride), 4); }
+	static Index ScaleIndex(Index index, int factor) { return _mm256_mullo_epi32(index, _mm256_set1_epi32(factor)); }
+	static Real Gather(const float* base, Index index) { return _mm256_i32gather_ps(base, index, 4); }
+	static Real GatherFloat(const float* base, Index index) { return Gather(base, index); }
+	static Real LoadStrided(const float* base, int stride) { return Gather(base, Stride(stride)); }
+	static Real LoadStridedFloat(const float* base, int stride) { return Gather(base, Stride(stride)); }
+	static void StoreStrided(float* base, int stride, Real value) {
+		// No scatter before AVX-512
+		float lanes[8];
+		_mm256_storeu_ps(lanes, value);
+		for (int lane = 0; lane < 8; ++lane) {
+			base[lane * stride] = lanes[lane];
+		}
+	}
+};
+
+}
+
+unsigned int DeformPointsAvx2(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackAvx2>(buffers, begin, end);
+}
+
+unsigned int DeformPointsAvx2(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackAvx2Float>(buffers, begin, end);
+}
+
+#endif
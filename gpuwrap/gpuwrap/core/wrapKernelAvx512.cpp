@@ -0,0 +1,85 @@
+#include "simd.h"
+
+#if defined(WRAP_SIMD_AVX512)
+
+// Built with AVX-512F enabled, only called when the CPU reports it
+#include <immintrin.h>
+
+#include "wrapKernelSoA.h"
+
+namespace {
+
+struct PackAvx512 {
+	static const unsigned int kWidth = 8;
+	typedef double Scalar;
+	typedef __m512d Real;
+	typedef __mmask8 Mask;
+	typedef __m256i Index;
+
+	static Real Set(double value) { return _mm512_set1_pd(value); }
+	static Real Add(Real a, Real b) { return _mm512_add_pd(a, b); }
+	static Real Sub(Real a, Real b) { return _mm512_sub_pd(a, b); }
+	static Real Mul(Real a, Real b) { return _mm512_mul_pd(a, b); }
+	static Real Div(Real a, Real b) { return _mm512_div_pd(a, b); }
+	static Real Sqrt(Real a) { return _mm512_sqrt_pd(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm512_fmadd_pd(a, b, c); }
+	static Mask Less(Real a, Real b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static Mask Greater(Real a, Real b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm512_mask_blend_pd(mask, b, a); }
+
+	static Index Stride(int stride) {
+		return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	}
+	static Real Load(const double* base) { return _mm512_loadu_pd(base); }
+	static Index LoadIndex(const int* base, int stride) { return _mm256_i32gather_epi32(base, Stride(stride), 4); }
+	static Index ScaleIndex(Index index, int factor) { return _mm256_mullo_epi32(index, _mm256_set1_epi32(factor)); }
+	static Real Gather(const double* base, Index index) { return _mm512_i32gather_pd(index, base, 8); }
+	static Real GatherFloat(const float* base, Index index) { return _mm512_cvtps_pd(_mm256_i32gather_ps(base, index, 4)); }
+	static Real LoadStrided(const double* base, int stride) { return Gather(base, Stride(stride)); }
+	static Real LoadStridedFloat(const float* base, int stride) { return GatherFloat(base, Stride(stride)); }
+	static void StoreStrided(double* base, int stride, Real value) { _mm512_i32scatter_pd(base, Stride(stride), value, 8); }
+};
+
+struct PackAvx512Float {
+	static const unsigned int kWidth = 16;
+	typedef float Scalar;
+	typedef __m512 Real;
+	typedef __mmask16 Mask;
+	typedef __m512i Index;
+
+	static Real Set(float value) { return _mm512_set1_ps(value); }
+	static Real Add(Real a, Real b) { return _mm512_add_ps(a, b); }
+	static Real Sub(Real a, Real b) { return _mm512_sub_ps(a, b); }
+	static Real Mul(Real a, Real b) { return _mm512_mul_ps(a, b); }
+	static Real Div(Real a, Real b) { return _mm512_div_ps(a, b); }
+	static Real Sqrt(Real a) { return _mm512_sqrt_ps(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm512_fmadd_ps(a, b, c); }
+	static Mask Less(Real a, Real b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	static Mask Greater(Real a, Real b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+	static Index Stride(int stride) {
+		return _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+								  _mm512_set1_epi32(stride));
+	}
+	static Real Load(const float* base) { return _mm512_loadu_ps(base); }
+	static Index LoadIndex(const int* base, int stride) { return _mm512_i32gather_epi32(Stride(stride), base, 4); }
+	static Index ScaleIndex(Index index, int factor) { return _mm512_mullo_epi32(index, _mm512_set1_epi32(factor)); }
+	static Real Gather(const float* base, Index index) { return _mm512_i32gather_ps(index, base, 4); }
+	static Real GatherFloat(const float* base, Index index) { return Gather(base, index); }
+	static Real LoadStrided(const float* base, int stride) { return Gather(base, Stride(stride)); }
+	static Real LoadStridedFloat(const float* base, int stride) { return Gather(base, Stride(stride)); }
+	static void StoreStrided(float* base, int stride, Real value) { _mm512_i32scatter_ps(base, Stride(stride), value, 4); }
+};
+
+}
+
+unsigned int DeformPointsAvx512(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackAvx512>(buffers, begin, end);
+}
+
+unsigned int DeformPointsAvx512(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackAvx512Float>(buffers, begin, end);
+}
+
+#endif
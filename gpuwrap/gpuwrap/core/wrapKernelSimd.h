@@ -0,0 +1,52 @@
+/*
+ * Instruction set specific deform kernels.
+ *
+ * Each kernel deforms whole blocks of its width starting at begin and
+ * returns the index of the first vertex it did not process. The remaining
+ * tail is left to the scalar kernel. Use DeformPoints, which picks the
+ * kernel at runtime, rather than calling these directly. Float kernels
+ * process twice as many vertices per iteration as double ones.
+ */
+
+#ifndef WRAP_CORE_KERNEL_SIMD_H
+#define WRAP_CORE_KERNEL_SIMD_H
+
+#include "simd.h"
+
+#include <cstddef>
+
+/**
+ * Raw view of the buffers a deform kernel reads and writes
+ * @tparam Real Scalar type of the driver, the frames and the driven points
+ */
+template <typename Real>
+struct DeformBuffers {
+	const int* triangleVerts; /**< 3 driver vertex ids per driven vertex */
+	const float* coords; /**< 3 barycentric weights per driven vertex */
+	const Real* bindMatrices; /**< Inverse bind matrices, null in kBindOffset mode */
+	size_t bindMatrixVertexStride; /**< Distance between the matrices of consecutive driven vertices */
+	size_t bindMatrixRowStride; /**< Distance between the rows of a matrix */
+	size_t bindMatrixColumnStride; /**< Distance between the columns of a matrix */
+	const float* offsets; /**< 3 floats per driven vertex, null in kBindMatrix mode */
+	const unsigned int* sampleOffsets; /**< Start of each driven vertex in the samples, null to blend the triangle corners */
+	const int* sampleVertices; /**< Driver vertex id per sample */
+	const float* sampleWeights; /**< Weight per sample */
+	const Real* driverPoints; /**< 3 scalars per driver vertex */
+	const float* driverNormals; /**< 3 floats per driver vertex */
+	const Real* localToWorld; /**< 16 scalars */
+	const Real* worldToLocal; /**< 16 scalars */
+	Real* points; /**< 3 scalars per driven vertex */
+};
+
+#if defined(WRAP_SIMD_X86)
+unsigned int DeformPointsSse(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end);
+unsigned int DeformPointsSse(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end);
+unsigned int DeformPointsAvx2(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end);
+unsigned int DeformPointsAvx2(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end);
+#if defined(WRAP_SIMD_AVX512)
+unsigned int DeformPointsAvx512(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end);
+unsigned int DeformPointsAvx512(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end);
+#endif
+#endif
+
+#endif
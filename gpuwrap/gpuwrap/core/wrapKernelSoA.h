@@ -0,0 +1,268 @@
+/*
+ * Structure-of-arrays deform kernel, written once against a vector "pack"
+ * type and instantiated by each instruction set specific source file.
+ *
+ * Only include this from those files. Everything here has internal linkage
+ * so code compiled for a wide instruction set can never be picked by the
+ * linker for a caller running on a narrower CPU.
+ *
+ * A pack P provides:
+ *   kWidth                         number of lanes
+ *   Scalar                         double or float, the type of the buffers
+ *   Real, Mask, Index              lane types
+ *   Set(Scalar)                    broadcast
+ *   Add, Sub, Mul, Div, Sqrt       lane-wise arithmetic
+ *   MulAdd(a, b, c)                a * b + c
+ *   Less(a, b), Greater(a, b)      lane-wise comparisons
+ *   Select(mask, a, b)             a where mask is set, else b
+ *   Load(base)                     base[lane], unaligned
+ *   LoadIndex(base, stride)        base[lane * stride]
+ *   ScaleIndex(index, factor)      index * factor
+ *   Gather(base, index)            base[index[lane]] for scalars
+ *   GatherFloat(base, index)       base[index[lane]] for floats, widened to Scalar
+ *   LoadStrided(base, stride)      base[lane * stride] for scalars
+ *   LoadStridedFloat(base, stride) base[lane * stride] for floats, widened to Scalar
+ *   StoreStrided(base, stride, v)  base[lane * stride] = v
+ */
+
+#ifndef WRAP_CORE_KERNEL_SOA_H
+#define WRAP_CORE_KERNEL_SOA_H
+
+#include "wrapKernelSimd.h"
+
+#include <algorithm>
+
+namespace {
+
+template <class P>
+struct Vector3 {
+	typename P::Real x, y, z;
+};
+
+template <class P>
+inline typename P::Real Dot(const Vector3<P>& a, const Vector3<P>& b) {
+	return P::MulAdd(a.x, b.x, P::MulAdd(a.y, b.y, P::Mul(a.z, b.z)));
+}
+
+template <class P>
+inline Vector3<P> Cross(const Vector3<P>& a, const Vector3<P>& b) {
+	Vector3<P> out;
+	out.x = P::Sub(P::Mul(a.y, b.z), P::Mul(a.z, b.y));
+	out.y = P::Sub(P::Mul(a.z, b.x), P::Mul(a.x, b.z));
+	out.z = P::Sub(P::Mul(a.x, b.y), P::Mul(a.y, b.x));
+	return out;
+}
+
+// Same behaviour as the scalar Normalize: zero length lanes are left alone
+template <class P>
+inline void Normalize(Vector3<P>& v) {
+	typename P::Real length = P::Sqrt(Dot(v, v));
+	typename P::Mask valid = P::Greater(length, P::Set(0.0));
+	v.x = P::Select(valid, P::Div(v.x, length), v.x);
+	v.y = P::Select(valid, P::Div(v.y, length), v.y);
+	v.z = P::Select(valid, P::Div(v.z, length), v.z);
+}
+
+template <class P>
+inline Vector3<P> GatherPoint(const typename P::Scalar* points, typename P::Index index) {
+	Vector3<P> out;
+	out.x = P::Gather(points, index);
+	out.y = P::Gather(points + 1, index);
+	out.z = P::Gather(points + 2, index);
+	return out;
+}
+
+template <class P>
+inline Vector3<P> GatherNormal(const float* normals, typename P::Index index) {
+	Vector3<P> out;
+	out.x = P::GatherFloat(normals, index);
+	out.y = P::GatherFloat(normals + 1, index);
+	out.z = P::GatherFloat(normals + 2, index);
+	return out;
+}
+
+template <class P>
+inline Vector3<P> Blend(const Vector3<P>& a, const Vector3<P>& b, const Vector3<P>& c,
+						typename P::Real wa, typename P::Real wb, typename P::Real wc) {
+	Vector3<P> out;
+	out.x = P::MulAdd(a.x, wa, P::MulAdd(b.x, wb, P::Mul(c.x, wc)));
+	out.y = P::MulAdd(a.y, wa, P::MulAdd(b.y, wb, P::Mul(c.y, wc)));
+	out.z = P::MulAdd(a.z, wa, P::MulAdd(b.z, wb, P::Mul(c.z, wc)));
+	return out;
+}
+
+template <class P>
+inline Vector3<P> SelectVector(typename P::Mask mask, const Vector3<P>& a, const Vector3<P>& b) {
+	Vector3<P> out;
+	out.x = P::Select(mask, a.x, b.x);
+	out.y = P::Select(mask, a.y, b.y);
+	out.z = P::Select(mask, a.z, b.z);
+	return out;
+}
+
+// Origin and normal blended from the samples of each lane. Lanes with fewer
+// samples than the longest row of the block add vertex 0 with no weight.
+template <class P>
+inline void BlendSamples(const DeformBuffers<typename P::Scalar>& buffers, unsigned int i, Vector3<P>& origin, Vector3<P>& normal) {
+	typedef typename P::Real Real;
+	const unsigned int width = P::kWidth;
+	const unsigned int* sampleOffsets = buffers.sampleOffsets + i;
+	unsigned int maxCount = 0;
+	for (unsigned int lane = 0; lane < width; ++lane) {
+		maxCount = std::max(maxCount, sampleOffsets[lane + 1] - sampleOffsets[lane]);
+	}
+	Real zero = P::Set(0.0);
+	origin.x = origin.y = origin.z = zero;
+	normal.x = normal.y = normal.z = zero;
+	int indices[width];
+	float weights[width];
+	for (unsigned int k = 0; k < maxCount; ++k) {
+		for (unsigned int lane = 0; lane < width; ++lane) {
+			unsigned int sample = sampleOffsets[lane] + k;
+			bool valid = sample < sampleOffsets[lane + 1];
+			indices[lane] = valid ? buffers.sampleVertices[sample] * 3 : 0;
+			weights[lane] = valid ? buffers.sampleWeights[sample] : 0.0f;
+		}
+		typename P::Index index = P::LoadIndex(indices, 1);
+		Real weight = P::LoadStridedFloat(weights, 1);
+		Vector3<P> point = GatherPoint<P>(buffers.driverPoints, index);
+		Vector3<P> vertexNormal = GatherNormal<P>(buffers.driverNormals, index);
+		origin.x = P::MulAdd(point.x, weight, origin.x);
+		origin.y = P::MulAdd(point.y, weight, origin.y);
+		origin.z = P::MulAdd(point.z, weight, origin.z);
+		normal.x = P::MulAdd(vertexNormal.x, weight, normal.x);
+		normal.y = P::MulAdd(vertexNormal.y, weight, normal.y);
+		normal.z = P::MulAdd(vertexNormal.z, weight, normal.z);
+	}
+}
+
+// p * m for an affine matrix whose 12 used entries are broadcast or gathered into m
+template <class P>
+inline Vector3<P> TransformAffine(const Vector3<P>& p, const typename P::Real* m) {
+	Vector3<P> out;
+	out.x = P::MulAdd(p.x, m[0], P::MulAdd(p.y, m[4], P::MulAdd(p.z, m[8], m[12])));
+	out.y = P::MulAdd(p.x, m[1], P::MulAdd(p.y, m[5], P::MulAdd(p.z, m[9], m[13])));
+	out.z = P::MulAdd(p.x, m[2], P::MulAdd(p.y, m[6], P::MulAdd(p.z, m[10], m[14])));
+	return out;
+}
+
+/**
+ * Deforms whole blocks of P::kWidth driven vertices
+ * @tparam kUseOffsets true for kBindOffset bindings, false for kBindMatrix
+ * @return The first vertex that was not deformed
+ */
+template <class P, bool kUseOffsets>
+unsigned int DeformBlocks(const DeformBuffers<typename P::Scalar>& buffers, unsigned int begin, unsigned int end) {
+	typedef typename P::Scalar Scalar;
+	typedef typename P::Real Real;
+	typedef typename P::Index Index;
+	const unsigned int width = P::kWidth;
+
+	Real localToWorld[16], worldToLocal[16];
+	for (int i = 0; i < 16; ++i) {
+		localToWorld[i] = P::Set(buffers.localToWorld[i]);
+		worldToLocal[i] = P::Set(buffers.worldToLocal[i]);
+	}
+
+	unsigned int i = begin;
+	for (; i + width <= end; i += width) {
+		// Driver vertex ids of each corner, scaled to xyz offsets
+		const int* triangleVerts = buffers.triangleVerts + i * 3;
+		Index corner0 = P::ScaleIndex(P::LoadIndex(triangleVerts, 3), 3);
+		Index corner1 = P::ScaleIndex(P::LoadIndex(triangleVerts + 1, 3), 3);
+		Index corner2 = P::ScaleIndex(P::LoadIndex(triangleVerts + 2, 3), 3);
+
+		const float* coords = buffers.coords + i * 3;
+		Real weight0 = P::LoadStridedFloat(coords, 3);
+		Real weight1 = P::LoadStridedFloat(coords + 1, 3);
+		Real weight2 = P::LoadStridedFloat(coords + 2, 3);
+
+		Vector3<P> point0 = GatherPoint<P>(buffers.driverPoints, corner0);
+		Vector3<P> point1 = GatherPoint<P>(buffers.driverPoints, corner1);
+		Vector3<P> point2 = GatherPoint<P>(buffers.driverPoints, corner2);
+
+		// Origin and normal are the barycentric blend of the corners, or of the samples
+		Vector3<P> origin, normal;
+		if (buffers.sampleOffsets != nullptr) {
+			BlendSamples<P>(buffers, i, origin, normal);
+		} else {
+			origin = Blend(point0, point1, point2, weight0, weight1, weight2);
+			normal = Blend(GatherNormal<P>(buffers.driverNormals, corner0),
+						   GatherNormal<P>(buffers.driverNormals, corner1),
+						   GatherNormal<P>(buffers.driverNormals, corner2),
+						   weight0, weight1, weight2);
+		}
+
+		// Up points at the lowest weighted corner, ties keep the earlier corner
+		typename P::Mask lower1 = P::Less(weight1, weight0);
+		Real lowestWeight = P::Select(lower1, weight1, weight0);
+		Vector3<P> lowest = SelectVector<P>(lower1, point1, point0);
+		lowest = SelectVector<P>(P::Less(weight2, lowestWeight), point2, lowest);
+		Vector3<P> up;
+		up.x = P::Sub(lowest.x, origin.x);
+		up.y = P::Sub(lowest.y, origin.y);
+		up.z = P::Sub(lowest.z, origin.z);
+		Normalize(normal);
+		Normalize(up);
+
+		// Basis matrix rows: x = normal ^ up, y = normal, z = normal ^ x, origin
+		Vector3<P> axisX = Cross(normal, up);
+		Vector3<P> axisZ = Cross(normal, axisX);
+
+		Scalar* points = buffers.points + i * 3;
+		Vector3<P> local;
+		if (kUseOffsets) {
+			// Bind position already in the bind frame
+			const float* offsets = buffers.offsets + i * 3;
+			local.x = P::LoadStridedFloat(offsets, 3);
+			local.y = P::LoadStridedFloat(offsets + 1, 3);
+			local.z = P::LoadStridedFloat(offsets + 2, 3);
+		} else {
+			// Inverse bind matrix, only the affine part. Entry major matrices are loaded without gathers.
+			const Scalar* bindMatrices = buffers.bindMatrices + i * buffers.bindMatrixVertexStride;
+			int vertexStride = (int)buffers.bindMatrixVertexStride;
+			Real bindMatrix[16];
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 3; ++column) {
+					const Scalar* entry = bindMatrices + row * buffers.bindMatrixRowStride + column * buffers.bindMatrixColumnStride;
+					bindMatrix[row * 4 + column] = vertexStride == 1 ? P::Load(entry) : P::LoadStrided(entry, vertexStride);
+				}
+			}
+
+			Vector3<P> point;
+			point.x = P::LoadStrided(points, 3);
+			point.y = P::LoadStrided(points + 1, 3);
+			point.z = P::LoadStrided(points + 2, 3);
+			// point * localToWorld * bindMatrix
+			local = TransformAffine(TransformAffine(point, localToWorld), bindMatrix);
+		}
+
+		// local * basis * worldToLocal
+		Vector3<P> world;
+		world.x = P::MulAdd(local.x, axisX.x, P::MulAdd(local.y, normal.x, P::MulAdd(local.z, axisZ.x, origin.x)));
+		world.y = P::MulAdd(local.x, axisX.y, P::MulAdd(local.y, normal.y, P::MulAdd(local.z, axisZ.y, origin.y)));
+		world.z = P::MulAdd(local.x, axisX.z, P::MulAdd(local.y, normal.z, P::MulAdd(local.z, axisZ.z, origin.z)));
+		Vector3<P> point = TransformAffine(world, worldToLocal);
+
+		P::StoreStrided(points, 3, point.x);
+		P::StoreStrided(points + 1, 3, point.y);
+		P::StoreStrided(points + 2, 3, point.z);
+	}
+	return i;
+}
+
+/**
+ * Deforms whole blocks of P::kWidth driven vertices in the binding's mode
+ * @return The first vertex that was not deformed
+ */
+template <class P>
+unsigned int DeformPointsSoA(const DeformBuffers<typename P::Scalar>& buffers, unsigned int begin, unsigned int end) {
+	if (buffers.offsets) {
+		return DeformBlocks<P, true>(buffers, begin, end);
+	}
+	return DeformBlocks<P, false>(buffers, begin, end);
+}
+
+}
+
+#endif
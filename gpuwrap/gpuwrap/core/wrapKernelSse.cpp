@@ -0,0 +1,114 @@
+#include "simd.h"
+
+#if defined(WRAP_SIMD_X86)
+
+#include <emmintrin.h>
+
+#include "wrapKernelSoA.h"
+
+namespace {
+
+// SSE2 is part of x86-64, so this file needs no extra compiler flags
+struct PackSse {
+	static const unsigned int kWidth = 2;
+	typedef double Scalar;
+	typedef __m128d Real;
+	typedef __m128d Mask;
+	struct Index { int lanes[2]; };
+
+	static Real Set(double value) { return _mm_set1_pd(value); }
+	static Real Add(Real a, Real b) { return _mm_add_pd(a, b); }
+	static Real Sub(Real a, Real b) { return _mm_sub_pd(a, b); }
+	static Real Mul(Real a, Real b) { return _mm_mul_pd(a, b); }
+	static Real Div(Real a, Real b) { return _mm_div_pd(a, b); }
+	static Real Sqrt(Real a) { return _mm_sqrt_pd(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	static Mask Less(Real a, Real b) { return _mm_cmplt_pd(a, b); }
+	static Mask Greater(Real a, Real b) { return _mm_cmpgt_pd(a, b); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+
+	static Real Load(const double* base) { return _mm_loadu_pd(base); }
+	static Index LoadIndex(const int* base, int stride) {
+		Index index = { { base[0], base[stride] } };
+		return index;
+	}
+	static Index ScaleIndex(Index index, int factor) {
+		index.lanes[0] *= factor;
+		index.lanes[1] *= factor;
+		return index;
+	}
+	static Real Gather(const double* base, const Index& index) {
+		return _mm_setr_pd(base[index.lanes[0]], base[index.lanes[1]]);
+	}
+	static Real GatherFloat(const float* base, const Index& index) {
+		return _mm_setr_pd(base[index.lanes[0]], base[index.lanes[1]]);
+	}
+	static Real LoadStrided(const double* base, int stride) {
+		return _mm_setr_pd(base[0], base[stride]);
+	}
+	static Real LoadStridedFloat(const float* base, int stride) {
+		return _mm_setr_pd(base[0], base[stride]);
+	}
+	static void StoreStrided(double* base, int stride, Real value) {
+		_mm_storel_pd(base, value);
+		_mm_storeh_pd(base + stride, value);
+	}
+};
+
+struct PackSseFloat {
+	static const unsigned int kWidth = 4;
+	typedef float Scalar;
+	typedef __m128 Real;
+	typedef __m128 Mask;
+	struct Index { int lanes[4]; };
+
+	static Real Set(float value) { return _mm_set1_ps(value); }
+	static Real Add(Real a, Real b) { return _mm_add_ps(a, b); }
+	static Real Sub(Real a, Real b) { return _mm_sub_ps(a, b); }
+	static Real Mul(Real a, Real b) { return _mm_mul_ps(a, b); }
+	static Real Div(Real a, Real b) { return _mm_div_ps(a, b); }
+	static Real Sqrt(Real a) { return _mm_sqrt_ps(a); }
+	static Real MulAdd(Real a, Real b, Real c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static Mask Less(Real a, Real b) { return _mm_cmplt_ps(a, b); }
+	static Mask Greater(Real a, Real b) { return _mm_cmpgt_ps(a, b); }
+	static Real Select(Mask mask, Real a, Real b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	static Real Load(const float* base) { return _mm_loadu_ps(base); }
+	static Index LoadIndex(const int* base, int stride) {
+		Index index = { { base[0], base[stride], base[stride * 2], base[stride * 3] } };
+		return index;
+	}
+	static Index ScaleIndex(Index index, int factor) {
+		for (int lane = 0; lane < 4; ++lane) {
+			index.lanes[lane] *= factor;
+		}
+		return index;
+	}
+	static Real Gather(const float* base, const Index& index) {
+		return _mm_setr_ps(base[index.lanes[0]], base[index.lanes[1]], base[index.lanes[2]], base[index.lanes[3]]);
+	}
+	static Real GatherFloat(const float* base, const Index& index) { return Gather(base, index); }
+	static Real LoadStrided(const float* base, int stride) {
+		return _mm_setr_ps(base[0], base[stride], base[stride * 2], base[stride * 3]);
+	}
+	static Real LoadStridedFloat(const float* base, int stride) { return LoadStrided(base, stride); }
+	static void StoreStrided(float* base, int stride, Real value) {
+		float lanes[4];
+		_mm_storeu_ps(lanes, value);
+		for (int lane = 0; lane < 4; ++lane) {
+			base[lane * stride] = lanes[lane];
+		}
+	}
+};
+
+}
+
+unsigned int DeformPointsSse(const DeformBuffers<double>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackSse>(buffers, begin, end);
+}
+
+unsigned int DeformPointsSse(const DeformBuffers<float>& buffers, unsigned int begin, unsigned int end) {
+	return DeformPointsSoA<PackSseFloat>(buffers, begin, end);
+}
+
+#endif
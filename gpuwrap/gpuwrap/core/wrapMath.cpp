@@ -0,0 +1,283 @@
+#include "wrapMath.h"
+
+#include <cmath>
+
+namespace {
+
+template <typename Real>
+inline Real Dot(const Real* a, const Real* b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+template <typename Real>
+inline void Cross(const Real* a, const Real* b, Real* out) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+template <typename Real>
+inline void Subtract(const Real* a, const Real* b, Real* out) {
+	out[0] = a[0] - b[0];
+	out[1] = a[1] - b[1];
+	out[2] = a[2] - b[2];
+}
+
+// Same behaviour as MVector::normalize: zero length vectors are left alone
+template <typename Real>
+inline void Normalize(Real* v) {
+	Real length = std::sqrt(Dot(v, v));
+	if (length > Real(0)) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+// Copies point into closest and returns its squared distance to P
+inline double SetClosest(const double* P, const double* point, double* closest) {
+	double d[3];
+	Subtract(point, P, d);
+	closest[0] = point[0];
+	closest[1] = point[1];
+	closest[2] = point[2];
+	return Dot(d, d);
+}
+
+}
+
+void GetBarycentricCoordinates(const double* P, const double* A, const double* B, const double* C, BaryCoords& coords) {
+	double BA[3], CA[3], BP[3], CP[3], AP[3];
+	Subtract(B, A, BA);
+	Subtract(C, A, CA);
+	Subtract(B, P, BP);
+	Subtract(C, P, CP);
+	Subtract(A, P, AP);
+
+	// Compute the normal of the triangle
+	double N[3];
+	Cross(BA, CA, N);
+	double unitN[3] = { N[0], N[1], N[2] };
+	Normalize(unitN);
+	// Compute twice area of triangle ABC
+	double areaABC = Dot(unitN, N);
+	// If the triangle is degenerate (point on top of each other), just use one of the points
+	if (areaABC == 0.0) {
+		coords[0] = 1.0f;
+		coords[1] = 0.0f;
+		coords[2] = 0.0f;
+		return;
+	}
+	double cross[3];
+	// Compute A
+	Cross(BP, CP, cross);
+	double areaPBC = Dot(unitN, cross);
+	coords[0] = (float)(areaPBC / areaABC);
+	// Compute B
+	Cross(CP, AP, cross);
+	double areaPCA = Dot(unitN, cross);
+	coords[1] = (float)(areaPCA / areaABC);
+	// Compute C
+	coords[2] = 1.0f - coords[0] - coords[1];
+}
+
+double ClosestPointOnTriangle(const double* P, const double* A, const double* B, const double* C, double* closest) {
+	// Voronoi region tests from Ericson, Real-Time Collision Detection 5.1.5.
+	// Vertex regions return the vertex exactly so triangles sharing it tie exactly.
+	double AB[3], AC[3], AP[3];
+	Subtract(B, A, AB);
+	Subtract(C, A, AC);
+	Subtract(P, A, AP);
+	double d1 = Dot(AB, AP), d2 = Dot(AC, AP);
+	if (d1 <= 0.0 && d2 <= 0.0) {
+		return SetClosest(P, A, closest);
+	}
+	double BP[3];
+	Subtract(P, B, BP);
+	double d3 = Dot(AB, BP), d4 = Dot(AC, BP);
+	if (d3 >= 0.0 && d4 <= d3) {
+		return SetClosest(P, B, closest);
+	}
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+		double v = d1 / (d1 - d3);
+		double onEdge[3] = { A[0] + v * AB[0], A[1] + v * AB[1], A[2] + v * AB[2] };
+		return SetClosest(P, onEdge, closest);
+	}
+	double CP[3];
+	Subtract(P, C, CP);
+	double d5 = Dot(AB, CP), d6 = Dot(AC, CP);
+	if (d6 >= 0.0 && d5 <= d6) {
+		return SetClosest(P, C, closest);
+	}
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+		double w = d2 / (d2 - d6);
+		double onEdge[3] = { A[0] + w * AC[0], A[1] + w * AC[1], A[2] + w * AC[2] };
+		return SetClosest(P, onEdge, closest);
+	}
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+		double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		double onEdge[3] = { B[0] + w * (C[0] - B[0]), B[1] + w * (C[1] - B[1]), B[2] + w * (C[2] - B[2]) };
+		return SetClosest(P, onEdge, closest);
+	}
+	// Inside the face
+	double denom = 1.0 / (va + vb + vc);
+	double v = vb * denom, w = vc * denom;
+	double onFace[3] = { A[0] + AB[0] * v + AC[0] * w, A[1] + AB[1] * v + AC[1] * w, A[2] + AB[2] * v + AC[2] * w };
+	return SetClosest(P, onFace, closest);
+}
+
+namespace {
+
+// Up vector to the lowest weighted corner of the closest triangle
+template <typename Real>
+void SetUpToLowestCorner(const BaryCoords& coords, const int* triangleVertices, const Real* points,
+						 const Real* origin, Real* up) {
+	// The up vector will be the vector to the lowest weighted point on a barycentric system
+	// Find the lowest barycentric weight
+	float lowestWeight = coords[0];
+	int lowestVertexId = triangleVertices[0];
+	for (int i = 1; i < 3; i++) {
+		if (coords[i] < lowestWeight) {
+			lowestWeight = coords[i];
+			lowestVertexId = triangleVertices[i];
+		}
+	}
+	Subtract(&points[lowestVertexId * 3], origin, up);
+	Normalize(up);
+}
+
+}
+
+template <typename Real>
+void CalculateBasisComponents(const BaryCoords& coords,
+							  const int* triangleVertices,
+							  const Real* points,
+							  const float* normals,
+							  Real* origin, Real* up, Real* normal) {
+	// Use barycentric coordinates to calculate origin and normal
+	origin[0] = origin[1] = origin[2] = Real(0);
+	normal[0] = normal[1] = normal[2] = Real(0);
+	for (int i = 0; i < 3; ++i) {
+		const Real* p = &points[triangleVertices[i] * 3];
+		const float* n = &normals[triangleVertices[i] * 3];
+		for (int axis = 0; axis < 3; ++axis) {
+			origin[axis] += p[axis] * coords[i];
+			normal[axis] += (Real)n[axis] * coords[i];
+		}
+	}
+
+	// calculate up vector
+	SetUpToLowestCorner(coords, triangleVertices, points, origin, up);
+	Normalize(normal);
+}
+
+template <typename Real>
+void CalculateSampleBasisComponents(const BaryCoords& coords,
+									const int* triangleVertices,
+									const int* sampleVertices,
+									const float* sampleWeights,
+									unsigned int sampleCount,
+									const Real* points,
+									const float* normals,
+									Real* origin, Real* up, Real* normal) {
+	origin[0] = origin[1] = origin[2] = Real(0);
+	normal[0] = normal[1] = normal[2] = Real(0);
+	for (unsigned int i = 0; i < sampleCount; ++i) {
+		const Real* p = &points[sampleVertices[i] * 3];
+		const float* n = &normals[sampleVertices[i] * 3];
+		for (int axis = 0; axis < 3; ++axis) {
+			origin[axis] += p[axis] * sampleWeights[i];
+			normal[axis] += (Real)n[axis] * sampleWeights[i];
+		}
+	}
+	SetUpToLowestCorner(coords, triangleVertices, points, origin, up);
+	Normalize(normal);
+}
+
+template <typename Real>
+void CreateMatrix(const Real* origin, const Real* normal, const Real* up, Real* matrix) {
+	const Real* t = origin;
+	const Real* y = normal;
+	Real x[3], z[3];
+	Cross(y, up, x);
+	Cross(y, x, z);
+	matrix[0] = x[0];  matrix[1] = x[1];  matrix[2] = x[2];  matrix[3] = Real(0);
+	matrix[4] = y[0];  matrix[5] = y[1];  matrix[6] = y[2];  matrix[7] = Real(0);
+	matrix[8] = z[0];  matrix[9] = z[1];  matrix[10] = z[2]; matrix[11] = Real(0);
+	matrix[12] = t[0]; matrix[13] = t[1]; matrix[14] = t[2]; matrix[15] = Real(1);
+}
+
+template <typename Real>
+bool InvertMatrix(const Real* m, Real* inverse) {
+	// Inverse of the upper 3x3 through its adjugate
+	Real c00 = m[5] * m[10] - m[6] * m[9];
+	Real c01 = m[6] * m[8] - m[4] * m[10];
+	Real c02 = m[4] * m[9] - m[5] * m[8];
+	Real det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+	if (det == Real(0)) {
+		for (int i = 0; i < 16; ++i) {
+			inverse[i] = (i % 5 == 0) ? Real(1) : Real(0);
+		}
+		return false;
+	}
+	Real invDet = Real(1) / det;
+	inverse[0] = c00 * invDet;
+	inverse[1] = (m[2] * m[9] - m[1] * m[10]) * invDet;
+	inverse[2] = (m[1] * m[6] - m[2] * m[5]) * invDet;
+	inverse[3] = Real(0);
+	inverse[4] = c01 * invDet;
+	inverse[5] = (m[0] * m[10] - m[2] * m[8]) * invDet;
+	inverse[6] = (m[2] * m[4] - m[0] * m[6]) * invDet;
+	inverse[7] = Real(0);
+	inverse[8] = c02 * invDet;
+	inverse[9] = (m[1] * m[8] - m[0] * m[9]) * invDet;
+	inverse[10] = (m[0] * m[5] - m[1] * m[4]) * invDet;
+	inverse[11] = Real(0);
+	// Translation is -t * inverse(R)
+	for (int axis = 0; axis < 3; ++axis) {
+		inverse[12 + axis] = -(m[12] * inverse[axis] + m[13] * inverse[4 + axis] + m[14] * inverse[8 + axis]);
+	}
+	inverse[15] = Real(1);
+	return true;
+}
+
+template <typename Real>
+void MultiplyMatrix(const Real* a, const Real* b, Real* out) {
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			out[row * 4 + column] = a[row * 4 + 0] * b[column] +
+									a[row * 4 + 1] * b[4 + column] +
+									a[row * 4 + 2] * b[8 + column] +
+									a[row * 4 + 3] * b[12 + column];
+		}
+	}
+}
+
+template <typename Real>
+void TransformPoint(const Real* p, const Real* m, Real* out) {
+	Real x = p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12];
+	Real y = p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13];
+	Real z = p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14];
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+}
+
+// The kernels deform in double, or in float for the faster, less precise mode
+template void CalculateBasisComponents(const BaryCoords&, const int*, const double*, const float*, double*, double*, double*);
+template void CalculateSampleBasisComponents(const BaryCoords&, const int*, const int*, const float*, unsigned int,
+											 const double*, const float*, double*, double*, double*);
+template void CreateMatrix(const double*, const double*, const double*, double*);
+template bool InvertMatrix(const double*, double*);
+template void MultiplyMatrix(const double*, const double*, double*);
+template void TransformPoint(const double*, const double*, double*);
+template void CalculateBasisComponents(const BaryCoords&, const int*, const float*, const float*, float*, float*, float*);
+template void CalculateSampleBasisComponents(const BaryCoords&, const int*, const int*, const float*, unsigned int,
+											 const float*, const float*, float*, float*, float*);
+template void CreateMatrix(const float*, const float*, const float*, float*);
+template bool InvertMatrix(const float*, float*);
+template void MultiplyMatrix(const float*, const float*, float*);
+template void TransformPoint(const float*, const float*, float*);
@@ -0,0 +1,121 @@
+/*
+ * Maya-independent wrap math.
+ *
+ * Points and vectors are plain xyz triples. Matrices are 16 scalars laid out
+ * like MMatrix: row-major, row vectors (p' = p * M) with the translation in
+ * the last row.
+ *
+ * The frame math is templated on the scalar type and instantiated for double
+ * and float. Closest points and barycentric coordinates are only computed
+ * when binding, in double.
+ */
+
+#ifndef WRAP_CORE_MATH_H
+#define WRAP_CORE_MATH_H
+
+/**
+ * Helper struct to hold the 3 barycentric coordinates
+ *
+ */
+
+struct BaryCoords {
+	float coords[3];
+	float operator[](int index) const { return coords[index]; }
+	float& operator[](int index) { return coords[index]; }
+};
+
+/*
+ * Get the barycentric coordinates of point P in the triangle specified by points A,B,C
+ * @param[in] P - The sample point
+ * @param[in] A - Triangle point
+ * @param[in] B - Triangle point
+ * @param[in] C - Triangle point
+ * @param[out] coords Barycentric coordinates storage
+ */
+void GetBarycentricCoordinates(const double* P, const double* A, const double* B, const double* C, BaryCoords& coords);
+
+/*
+ * Get the closest point to P on the triangle specified by points A,B,C
+ * @param[in] P - The sample point
+ * @param[in] A - Triangle point
+ * @param[in] B - Triangle point
+ * @param[in] C - Triangle point
+ * @param[out] closest The closest point, 3 doubles
+ * @return The squared distance from P to closest
+ */
+double ClosestPointOnTriangle(const double* P, const double* A, const double* B, const double* C, double* closest);
+
+/**
+ * Calculates the components necessary to create a wrap basis matrix
+ * @param[in] coords The barycentric coordinates of the closest point
+ * @param[in] triangleVertices The 3 vertex ids forming the triangle of the closest point.
+ * @param[in] points The driver points, 3 scalars per vertex
+ * @param[in] normals The driver per-vertex normals, 3 floats per vertex
+ * @param[out] origin The origin of the coordinate system
+ * @param[out] up The up vector of the coordinate system
+ * @param[out] normal The normal vector of the coordinate system
+*/
+template <typename Real>
+void CalculateBasisComponents(const BaryCoords& coords,
+							  const int* triangleVertices,
+							  const Real* points,
+							  const float* normals,
+							  Real* origin, Real* up, Real* normal);
+
+/**
+ * CalculateBasisComponents with the origin and normal blended from weighted
+ * driver vertices instead of the triangle corners. The up vector still points
+ * at the lowest weighted corner of the closest triangle.
+ * @param[in] coords The barycentric coordinates of the closest point
+ * @param[in] triangleVertices The 3 vertex ids forming the triangle of the closest point
+ * @param[in] sampleVertices Vertex ids of the samples
+ * @param[in] sampleWeights Weight of each sample, summing to 1
+ * @param[in] sampleCount Number of samples
+ * @param[in] points The driver points, 3 scalars per vertex
+ * @param[in] normals The driver per-vertex normals, 3 floats per vertex
+ * @param[out] origin The origin of the coordinate system
+ * @param[out] up The up vector of the coordinate system
+ * @param[out] normal The normal vector of the coordinate system
+ */
+template <typename Real>
+void CalculateSampleBasisComponents(const BaryCoords& coords,
+									const int* triangleVertices,
+									const int* sampleVertices,
+									const float* sampleWeights,
+									unsigned int sampleCount,
+									const Real* points,
+									const float* normals,
+									Real* origin, Real* up, Real* normal);
+
+/*
+ * Creates a basis matrix using the given point and two axes.
+ * @param[in] origin Position
+ * @param[in] normal Normal Vector
+ * @param[in] up Up vector
+ * @param[out] matrix Generated matrix, 16 scalars
+ */
+template <typename Real>
+void CreateMatrix(const Real* origin, const Real* normal, const Real* up, Real* matrix);
+
+/*
+ * Inverts an affine matrix (last column 0, 0, 0, 1).
+ * @param[in] matrix Matrix to invert
+ * @param[out] inverse Inverted matrix. Identity if the matrix is singular.
+ * @return false if the matrix is singular
+ */
+template <typename Real>
+bool InvertMatrix(const Real* matrix, Real* inverse);
+
+/*
+ * Multiplies two affine matrices, out = a * b. out may not alias a or b.
+ */
+template <typename Real>
+void MultiplyMatrix(const Real* a, const Real* b, Real* out);
+
+/*
+ * Transforms a point by an affine matrix, out = p * matrix. out may alias p.
+ */
+template <typename Real>
+void TransformPoint(const Real* p, const Real* matrix, Real* out);
+
+#endif
@@ -0,0 +1,119 @@
+#include "wrapStats.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+std::atomic<bool> statsEnabled(false);
+
+const char* kPhaseNames[kPhaseCount] = {
+	"decode",
+	"driverFetch",
+	"input",
+	"normals",
+	"kernel",
+	"writeBack",
+	"bvhBuild",
+	"bind",
+};
+
+}
+
+const char* GetWrapPhaseName(WrapPhase phase) {
+	return phase >= 0 && phase < kPhaseCount ? kPhaseNames[phase] : "unknown";
+}
+
+std::string FormatWrapStats(const WrapStatsRecord& record) {
+	std::ostringstream stream;
+	stream.precision(9);
+	stream << "{\"kind\": \"" << (record.kind == kStatsBind ? "bind" : "deform") << "\""
+		<< ", \"sequence\": " << record.sequence
+		<< ", \"geometry\": " << record.geometryIndex
+		<< ", \"totalSeconds\": " << record.totalSeconds
+		<< ", \"drivenVertices\": " << record.drivenVertices
+		<< ", \"skippedVertices\": " << record.skippedVertices
+		<< ", \"bindDataBytes\": " << record.bindDataBytes
+		<< ", \"incremental\": " << (record.incremental ? "true" : "false")
+		<< ", \"cached\": " << (record.cached ? "true" : "false")
+		<< ", \"phases\": {";
+	for (int phase = 0; phase < kPhaseCount; ++phase) {
+		stream << (phase == 0 ? "\"" : ", \"") << kPhaseNames[phase] << "\": " << record.phaseSeconds[phase];
+	}
+	stream << "}}";
+	return stream.str();
+}
+
+void SetWrapStatsEnabled(bool enabled) {
+	statsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsWrapStatsEnabled() {
+	return statsEnabled.load(std::memory_order_relaxed);
+}
+
+WrapStatsBuffer::WrapStatsBuffer(unsigned int capacity) : records_(std::max(1u, capacity)), pushed_(0) {}
+
+void WrapStatsBuffer::Push(const WrapStatsRecord& record) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	WrapStatsRecord& slot = records_[pushed_ % records_.size()];
+	slot = record;
+	slot.sequence = pushed_++;
+}
+
+std::vector<WrapStatsRecord> WrapStatsBuffer::Records(unsigned int maxCount) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	unsigned long long count = std::min<unsigned long long>(pushed_, records_.size());
+	if (maxCount > 0) {
+		count = std::min<unsigned long long>(count, maxCount);
+	}
+	std::vector<WrapStatsRecord> records;
+	records.reserve((size_t)count);
+	for (unsigned long long sequence = pushed_ - count; sequence < pushed_; ++sequence) {
+		records.push_back(records_[sequence % records_.size()]);
+	}
+	return records;
+}
+
+void WrapStatsBuffer::Clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	pushed_ = 0;
+}
+
+WrapStatsScope::WrapStatsScope(WrapStatsBuffer* buffer, WrapStatsKind kind, int geometryIndex)
+	: buffer_(buffer), phase_(-1) {
+	if (buffer_ != nullptr) {
+		record_.kind = kind;
+		record_.geometryIndex = geometryIndex;
+		start_ = Clock::now();
+	}
+}
+
+WrapStatsScope::~WrapStatsScope() {
+	if (buffer_ == nullptr) {
+		return;
+	}
+	EndPhase();
+	record_.totalSeconds = std::chrono::duration<double>(Clock::now() - start_).count();
+	buffer_->Push(record_);
+}
+
+void WrapStatsScope::BeginPhase(WrapPhase phase) {
+	if (buffer_ == nullptr) {
+		return;
+	}
+	Clock::time_point now = Clock::now();
+	if (phase_ >= 0) {
+		record_.phaseSeconds[phase_] += std::chrono::duration<double>(now - phaseStart_).count();
+	}
+	phase_ = phase;
+	phaseStart_ = now;
+}
+
+void WrapStatsScope::EndPhase() {
+	if (buffer_ == nullptr || phase_ < 0) {
+		return;
+	}
+	record_.phaseSeconds[phase_] += std::chrono::duration<double>(Clock::now() - phaseStart_).count();
+	phase_ = -1;
+}
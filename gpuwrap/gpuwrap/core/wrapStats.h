@@ -0,0 +1,145 @@
+/*
+ * Maya-independent timing and counters of wrap evaluations and binds, kept
+ * per node in a ring buffer for the awWrapStats command.
+ */
+
+#ifndef WRAP_CORE_STATS_H
+#define WRAP_CORE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Records kept per node before the oldest are overwritten */
+const unsigned int kDefaultStatsCapacity = 256;
+
+/**
+ * Timed parts of an evaluation or a bind. A record only spends time in the
+ * phases its kind goes through.
+ */
+enum WrapPhase {
+	kPhaseDecode = 0, /**< Decoding bindData into a WrapBinding */
+	kPhaseDriverFetch, /**< Driver points and triangles from Maya */
+	kPhaseInput, /**< Driven input positions and painted weights */
+	kPhaseNormals, /**< Gathering the referenced driver points and computing their normals */
+	kPhaseKernel, /**< Deforming and weighting the driven vertices */
+	kPhaseWriteBack, /**< setAllPositions, or storing packedBinding for a bind */
+	kPhaseBvhBuild, /**< Closest point search structure over the driver, binds only */
+	kPhaseBind, /**< Closest points and bind frames, binds only */
+	kPhaseCount
+};
+
+enum WrapStatsKind {
+	kStatsDeform = 0, /**< One Wrap::deform call */
+	kStatsBind = 1, /**< One binding made by the awWrap command, over every driven geometry */
+};
+
+/**
+ * Timing and counters of one evaluation or bind
+ */
+struct WrapStatsRecord {
+	WrapStatsKind kind = kStatsDeform;
+	unsigned long long sequence = 0; /**< Position in the node history, set by WrapStatsBuffer::Push */
+	int geometryIndex = 0; /**< Driven geometry of a deform, -1 for a bind */
+	double phaseSeconds[kPhaseCount] = {}; /**< Time spent in each phase */
+	double totalSeconds = 0.0; /**< Whole evaluation, including the untimed parts */
+	unsigned int drivenVertices = 0; /**< Driven vertices deformed or bound */
+	unsigned int skippedVertices = 0; /**< Driven vertices left alone, painted off or unaffected */
+	unsigned long long bindDataBytes = 0; /**< Packed size of the binding */
+	bool incremental = false; /**< Only the vertices affected by moved driver vertices were deformed */
+	bool cached = false; /**< The output of an earlier evaluation with the same inputs was reused */
+};
+
+/**
+ * @return A camelCase name of the phase, as used by FormatWrapStats
+ */
+const char* GetWrapPhaseName(WrapPhase phase);
+
+/**
+ * @return The record as a one line JSON object
+ */
+std::string FormatWrapStats(const WrapStatsRecord& record);
+
+/**
+ * Turns collecting records on or off for every node. Off by default, so
+ * evaluations only pay for one atomic load.
+ */
+void SetWrapStatsEnabled(bool enabled);
+
+/**
+ * @return true if evaluations and binds collect records
+ */
+bool IsWrapStatsEnabled();
+
+/**
+ * Fixed size history of records, overwriting the oldest. Safe to use from
+ * several threads.
+ */
+class WrapStatsBuffer {
+public:
+	explicit WrapStatsBuffer(unsigned int capacity = kDefaultStatsCapacity);
+
+	/**
+	 * Appends a record, numbering it after the last one pushed
+	 */
+	void Push(const WrapStatsRecord& record);
+
+	/**
+	 * @param[in] maxCount Most recent records to return, 0 for all of them
+	 * @return The kept records, oldest first
+	 */
+	std::vector<WrapStatsRecord> Records(unsigned int maxCount = 0) const;
+
+	void Clear();
+
+	unsigned int capacity() const { return (unsigned int)records_.size(); }
+
+private:
+	mutable std::mutex mutex_;
+	std::vector<WrapStatsRecord> records_; // Ring of capacity records
+	unsigned long long pushed_; // Records pushed since the last Clear
+};
+
+/**
+ * Times the phases of one evaluation or bind and pushes the record when it
+ * goes out of scope, so early returns are recorded too. Does nothing without
+ * a buffer.
+ */
+class WrapStatsScope {
+public:
+	/**
+	 * @param[in] buffer History to push to, null to record nothing
+	 * @param[in] kind What is being recorded
+	 * @param[in] geometryIndex Driven geometry of a deform, -1 for a bind
+	 */
+	WrapStatsScope(WrapStatsBuffer* buffer, WrapStatsKind kind, int geometryIndex);
+	~WrapStatsScope();
+
+	/**
+	 * @return The record to fill in the counters of, null when not recording
+	 */
+	WrapStatsRecord* record() { return buffer_ != nullptr ? &record_ : nullptr; }
+
+	/**
+	 * Ends the running phase and starts timing another
+	 */
+	void BeginPhase(WrapPhase phase);
+
+	/**
+	 * Ends the running phase, if any
+	 */
+	void EndPhase();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	WrapStatsBuffer* buffer_;
+	WrapStatsRecord record_;
+	Clock::time_point start_;
+	Clock::time_point phaseStart_;
+	int phase_; // Running phase, -1 for none
+};
+
+#endif
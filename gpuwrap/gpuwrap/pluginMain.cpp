@@ -1,5 +1,9 @@
+#include "wrapBakeCmd.h"
+#include "wrapBindData.h"
 #include "wrapCmd.h"
 #include "wrapDeformer.h"
+#include "wrapProfiler.h"
+#include "wrapStatsCmd.h"
 
 #include <maya/MFnPlugin.h>
 #include <maya/MGlobal.h>
@@ -9,6 +13,13 @@ MStatus initializePlugin(MObject obj) {
 	MStatus status;
 	MFnPlugin plugin(obj, "Alex Widener", "1.0", "Any");
 
+	// The node's packedBinding attribute needs the data type registered first
+	status = plugin.registerData(
+		WrapBindData::kName,
+		WrapBindData::id,
+		WrapBindData::creator);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
 	status = plugin.registerNode(
 		Wrap::kName,
 		Wrap::id,
@@ -21,8 +32,22 @@ MStatus initializePlugin(MObject obj) {
 		WrapCmd::kName,
 		WrapCmd::creator,
 		WrapCmd::newSyntax);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
 
+	status = plugin.registerCommand(
+		WrapStatsCmd::kName,
+		WrapStatsCmd::creator,
+		WrapStatsCmd::newSyntax);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	status = plugin.registerCommand(
+		WrapBakeCmd::kName,
+		WrapBakeCmd::creator,
+		WrapBakeCmd::newSyntax);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	// Evaluation and bind phases show up under this category in the profiler
+	WrapProfiler::RegisterCategory();
 	return status;
 }
 
@@ -30,10 +55,17 @@ MStatus uninitializePlugin(MObject obj) {
 	MStatus status;
 	MFnPlugin plugin(obj);
 
+	WrapProfiler::DeregisterCategory();
+	status = plugin.deregisterCommand(WrapBakeCmd::kName);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	status = plugin.deregisterCommand(WrapStatsCmd::kName);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
 	status = plugin.deregisterCommand(WrapCmd::kName);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 	status = plugin.deregisterNode(Wrap::id);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
+	status = plugin.deregisterData(WrapBindData::id);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
 	return status;
 }
 
@@ -0,0 +1,225 @@
+#include "wrapBakeCmd.h"
+#include "wrapDeformer.h"
+#include "common.h"
+#include "core/pointCache.h"
+#include "core/threadPool.h"
+
+#include <maya/MArgDatabase.h>
+#include <maya/MArrayDataHandle.h>
+#include <maya/MDataBlock.h>
+#include <maya/MDataHandle.h>
+#include <maya/MDGContext.h>
+#include <maya/MFloatVectorArray.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MPlug.h>
+#include <maya/MSelectionList.h>
+#include <maya/MTime.h>
+
+#include <algorithm>
+#include <cmath>
+
+const char* WrapBakeCmd::kName = "awWrapBake";
+const char* WrapBakeCmd::kFileFlagShort = "-f";
+const char* WrapBakeCmd::kFileFlagLong = "-file";
+const char* WrapBakeCmd::kStartFrameFlagShort = "-sf";
+const char* WrapBakeCmd::kStartFrameFlagLong = "-startFrame";
+const char* WrapBakeCmd::kEndFrameFlagShort = "-ef";
+const char* WrapBakeCmd::kEndFrameFlagLong = "-endFrame";
+const char* WrapBakeCmd::kStepFlagShort = "-s";
+const char* WrapBakeCmd::kStepFlagLong = "-step";
+const char* WrapBakeCmd::kGeometryIndexFlagShort = "-gi";
+const char* WrapBakeCmd::kGeometryIndexFlagLong = "-geometryIndex";
+const char* WrapBakeCmd::kChunkFramesFlagShort = "-cf";
+const char* WrapBakeCmd::kChunkFramesFlagLong = "-chunkFrames";
+
+WrapBakeCmd::WrapBakeCmd()
+	: wrap_(nullptr), geomIndex_(0), drivenCount_(0), driverVertexCount_(0), needInput_(true), mayaNormals_(false) {}
+
+MSyntax WrapBakeCmd::newSyntax() {
+	MSyntax syntax;
+	syntax.addFlag(kFileFlagShort, kFileFlagLong, MSyntax::kString);
+	syntax.addFlag(kStartFrameFlagShort, kStartFrameFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kEndFrameFlagShort, kEndFrameFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kStepFlagShort, kStepFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kGeometryIndexFlagShort, kGeometryIndexFlagLong, MSyntax::kLong);
+	// Frames deformed in parallel and written at once, twice the threads by default
+	syntax.addFlag(kChunkFramesFlagShort, kChunkFramesFlagLong, MSyntax::kLong);
+	syntax.setObjectType(MSyntax::kSelectionList, 0, 1);
+	syntax.useSelectionAsDefault(true);
+	return syntax;
+}
+
+void* WrapBakeCmd::creator() {
+	return new WrapBakeCmd;
+}
+
+bool WrapBakeCmd::isUndoable() const {
+	return false;
+}
+
+MStatus WrapBakeCmd::doIt(const MArgList& args) {
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (!argData.isFlagSet(kFileFlagShort) || !argData.isFlagSet(kStartFrameFlagShort) ||
+		!argData.isFlagSet(kEndFrameFlagShort)) {
+		MGlobal::displayError("awWrapBake needs -file, -startFrame and -endFrame");
+		return MS::kInvalidParameter;
+	}
+	MString file = argData.flagArgumentString(kFileFlagShort, 0);
+	double startFrame = argData.flagArgumentDouble(kStartFrameFlagShort, 0);
+	double endFrame = argData.flagArgumentDouble(kEndFrameFlagShort, 0);
+	double step = argData.isFlagSet(kStepFlagShort) ? argData.flagArgumentDouble(kStepFlagShort, 0) : 1.0;
+	int geomIndex = argData.isFlagSet(kGeometryIndexFlagShort) ? argData.flagArgumentInt(kGeometryIndexFlagShort, 0) : 0;
+	int chunkFrames = argData.isFlagSet(kChunkFramesFlagShort) ?
+		argData.flagArgumentInt(kChunkFramesFlagShort, 0) : (int)ThreadPool::Instance().threadLimit() * 2;
+	if (step <= 0.0 || endFrame < startFrame) {
+		MGlobal::displayError("The step must be positive and the end frame can not be before the start frame");
+		return MS::kInvalidParameter;
+	}
+	if (geomIndex < 0 || chunkFrames < 1) {
+		MGlobal::displayError("The geometry index can not be negative and a chunk needs at least 1 frame");
+		return MS::kInvalidParameter;
+	}
+	geomIndex_ = (unsigned int)geomIndex;
+
+	// Get the wrap node
+	MSelectionList selectionList;
+	argData.getObjects(selectionList);
+	if (selectionList.length() == 0) {
+		MGlobal::displayError("No awWrap node given");
+		return MS::kInvalidParameter;
+	}
+	status = selectionList.getDependNode(0, oWrapNode_);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MFnDependencyNode fnNode(oWrapNode_, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (fnNode.typeId() != Wrap::id) {
+		MGlobal::displayError(fnNode.name() + " is not an awWrap node");
+		return MS::kInvalidParameter;
+	}
+	wrap_ = (Wrap*)fnNode.userNode();
+
+	// The binding and weights do not change over the range
+	TaskData taskData;
+	status = wrap_->GetBakeData(geomIndex_, taskData);
+	if (status != MS::kSuccess || taskData.binding.size() == 0) {
+		MGlobal::displayError(fnNode.name() + " has no binding for the geometry index");
+		return MS::kFailure;
+	}
+	WrapBinding& binding = taskData.binding;
+	Precision precision = (Precision)MPlug(oWrapNode_, Wrap::aPrecision).asShort();
+	binding.UpdateFloatBindMatrices(precision);
+	const std::vector<int>& referencedVertices = binding.referencedVertices;
+	drivenCount_ = binding.size();
+	driverVertexCount_ = referencedVertices.empty() ? 0 :
+		(unsigned int)*std::max_element(referencedVertices.begin(), referencedVertices.end()) + 1;
+	needInput_ = binding.mode == kBindMatrix || !taskData.allWeightsOne;
+	mayaNormals_ = binding.normals == kMayaNormals;
+	driverTriangles_.clear();
+
+	PointCacheInfo info;
+	info.vertexCount = drivenCount_;
+	info.chunkFrames = (unsigned int)chunkFrames;
+	info.startFrame = startFrame;
+	info.frameStep = step;
+	unsigned int frameCount = (unsigned int)std::floor((endFrame - startFrame) / step + 1e-9) + 1;
+	PointCacheWriter writer;
+	if (!writer.Open(file.asChar(), info)) {
+		MGlobal::displayError("Could not write the point cache " + file);
+		return MS::kFailure;
+	}
+
+	std::vector<FrameData> frameData(info.chunkFrames);
+	std::vector<BakeFrame> bakeFrames(info.chunkFrames);
+	for (unsigned int first = 0; first < frameCount; first += info.chunkFrames) {
+		// Pulling the DG is serial, the writer thread stores the previous chunk meanwhile
+		unsigned int chunkFrames = std::min(info.chunkFrames, frameCount - first);
+		for (unsigned int f = 0; f < chunkFrames; ++f) {
+			status = CaptureFrame(startFrame + (first + f) * step, frameData[f], bakeFrames[f]);
+			if (status != MS::kSuccess) {
+				writer.Abort();
+				return status;
+			}
+		}
+		BakeTopology topology;
+		topology.triangleVertices = driverTriangles_.data();
+		topology.adjacency = &driverAdjacency_;
+		DeformFrames(binding, topology, taskData.weights.data(), bakeFrames.data(), chunkFrames, precision,
+					 writer.AcquireChunk());
+		writer.SubmitChunk(chunkFrames);
+	}
+	if (!writer.Close()) {
+		MGlobal::displayError("Could not write the point cache " + file);
+		return MS::kFailure;
+	}
+	setResult((int)frameCount);
+	return MS::kSuccess;
+}
+
+MStatus WrapBakeCmd::CaptureFrame(double frame, FrameData& data, BakeFrame& bakeFrame) {
+	MStatus status;
+	MDGContext context(MTime(frame, MTime::uiUnit()));
+	MDataBlock block = wrap_->forceCache(context);
+
+	// Driver points, the way the deformer fetches them
+	MDataHandle hDriverGeo = block.inputValue(Wrap::aDriverGeo, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MFnMesh fnDriver(hDriverGeo.asMesh(), &status);
+	if (status != MS::kSuccess) {
+		MGlobal::displayError("The driver of the wrap node is not a mesh");
+		return MS::kFailure;
+	}
+	int driverVertexCount = fnDriver.numVertices();
+	if ((unsigned int)driverVertexCount < driverVertexCount_) {
+		MGlobal::displayError("The driver lost vertices since binding, it needs to be rebound");
+		return MS::kFailure;
+	}
+	const float* driverPoints = fnDriver.getRawPoints(&status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	GetPointBuffer(driverPoints, (unsigned int)driverVertexCount, hDriverGeo.geometryTransformMatrix(), data.driverPoints);
+	if (mayaNormals_) {
+		MFloatVectorArray driverNormals;
+		status = fnDriver.getVertexNormals(false, driverNormals);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		GetNormalBuffer(driverNormals, data.driverNormals);
+	} else if (driverTriangles_.empty()) {
+		// The topology is taken from the first frame, a bake does not follow topology changes
+		MIntArray triangleCounts, triangleVertices;
+		status = fnDriver.getTriangles(triangleCounts, triangleVertices);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		driverTriangles_.resize(triangleVertices.length());
+		triangleVertices.get(driverTriangles_.data());
+		driverAdjacency_.Build(driverTriangles_.data(), triangleVertices.length() / 3, (unsigned int)driverVertexCount);
+	}
+
+	// Driven input, only the whole mesh can be baked to a cache of its vertices
+	bakeFrame.envelope = block.inputValue(Wrap::envelope).asFloat();
+	MArrayDataHandle hInput = block.inputArrayValue(Wrap::input, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	status = hInput.jumpToElement(geomIndex_);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MDataHandle hInputGeo = hInput.inputValue(&status).child(Wrap::inputGeom);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MFnMesh fnDriven(hInputGeo.asMesh(), &status);
+	if (status != MS::kSuccess || fnDriven.numVertices() != (int)drivenCount_) {
+		MGlobal::displayError("Only driven meshes deformed as a whole can be baked");
+		return MS::kFailure;
+	}
+	GetMatrixBuffer(hInputGeo.geometryTransformMatrix(), bakeFrame.localToWorld);
+	if (needInput_ || bakeFrame.envelope != 1.0f) {
+		const float* drivenPoints = fnDriven.getRawPoints(&status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		GetPointBuffer(drivenPoints, drivenCount_, MMatrix::identity, data.drivenPoints);
+	} else {
+		data.drivenPoints.clear();
+	}
+
+	bakeFrame.driverPoints = data.driverPoints.data();
+	bakeFrame.driverNormals = mayaNormals_ ? data.driverNormals.data() : nullptr;
+	bakeFrame.drivenPoints = data.drivenPoints.empty() ? nullptr : data.drivenPoints.data();
+	return MS::kSuccess;
+}
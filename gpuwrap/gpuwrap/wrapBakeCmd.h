@@ -0,0 +1,76 @@
+#ifndef WRAPBAKECMD_H
+#define WRAPBAKECMD_H
+
+#include "core/wrapBake.h"
+
+#include <vector>
+
+#include <maya/MArgList.h>
+#include <maya/MObject.h>
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+class Wrap;
+
+/*
+	The Wrap Bake Command deforms a frame range of a wrap node and streams the
+	driven points to a point cache file. The driver is pulled through the DG
+	once per frame without changing the current time, and the frames are
+	deformed in parallel, a chunk at a time, while the previous chunk is written.
+
+	awWrapBake -file "/cache/shirt.awpc" -startFrame 1001 -endFrame 1100 awWrap1;
+	awWrapBake -f "/cache/shirt.awpc" -sf 1001 -ef 1100 -step 0.5 -geometryIndex 1 -chunkFrames 32 awWrap1;
+*/
+
+class WrapBakeCmd : public MPxCommand {
+public:
+	WrapBakeCmd();
+	virtual MStatus		doIt(const MArgList&);
+	virtual bool		isUndoable() const;
+	static void*		creator();
+	static MSyntax		newSyntax();
+	const static char*	kName;
+
+	const static char*	kFileFlagShort;
+	const static char*	kFileFlagLong;
+	const static char*	kStartFrameFlagShort;
+	const static char*	kStartFrameFlagLong;
+	const static char*	kEndFrameFlagShort;
+	const static char*	kEndFrameFlagLong;
+	const static char*	kStepFlagShort;
+	const static char*	kStepFlagLong;
+	const static char*	kGeometryIndexFlagShort;
+	const static char*	kGeometryIndexFlagLong;
+	const static char*	kChunkFramesFlagShort;
+	const static char*	kChunkFramesFlagLong;
+
+private:
+	/**
+	 * Inputs of one frame pulled from the DG, BakeFrame points into them
+	 */
+	struct FrameData {
+		std::vector<double> driverPoints; /**< World space driver points, 3 doubles per vertex */
+		std::vector<float> driverNormals; /**< Maya driver normals, kMayaNormals bindings only */
+		std::vector<double> drivenPoints; /**< Input positions, empty when the binding replaces them */
+	};
+
+	/**
+	 * Evaluates the driver and the driven input of the wrap node at a frame
+	 * @param[in] frame Time in the current time unit
+	 * @param[out] data Points of the frame
+	 * @param[out] bakeFrame Filled in from data, along with the matrix and envelope
+	 */
+	MStatus CaptureFrame(double frame, FrameData& data, BakeFrame& bakeFrame);
+
+	MObject oWrapNode_; // Wrap node being baked
+	Wrap* wrap_; // User node of oWrapNode_
+	unsigned int geomIndex_; // Driven geometry being baked
+	unsigned int drivenCount_; // Driven vertices of the binding
+	unsigned int driverVertexCount_; // Driver vertices the binding needs
+	bool needInput_; // The binding reads the driven input positions
+	bool mayaNormals_; // The binding deforms with Maya's driver normals
+	std::vector<int> driverTriangles_; // Driver triangles at the first frame, for built-in normals
+	VertexTriangles driverAdjacency_; // Triangles around each driver vertex
+};
+
+#endif
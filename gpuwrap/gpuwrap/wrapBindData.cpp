@@ -0,0 +1,89 @@
+#include "wrapBindData.h"
+#include "core/wrapBindingIO.h"
+
+#include <sstream>
+#include <string>
+
+const char* WrapBindData::kName = "awWrapBindData";
+MTypeId WrapBindData::id(0x0014456C);
+
+// Base64 characters per token in .ma files, keeps lines a sensible length
+static const size_t kAsciiChunkSize = 4096;
+
+WrapBindData::WrapBindData() {}
+
+WrapBindData::~WrapBindData() {}
+
+void* WrapBindData::creator() {
+	return new WrapBindData;
+}
+
+MTypeId WrapBindData::typeId() const {
+	return id;
+}
+
+MString WrapBindData::name() const {
+	return kName;
+}
+
+void WrapBindData::copy(const MPxData& other) {
+	if (other.typeId() == id) {
+		binding = static_cast<const WrapBindData&>(other).binding;
+	}
+}
+
+MStatus WrapBindData::readBinary(std::istream& in, unsigned int length) {
+	if (!ReadBinding(in, length, binding)) {
+		return MS::kFailure;
+	}
+	return MS::kSuccess;
+}
+
+MStatus WrapBindData::writeBinary(std::ostream& out) {
+	if (!WriteBinding(binding, out)) {
+		return MS::kFailure;
+	}
+	return MS::kSuccess;
+}
+
+MStatus WrapBindData::writeASCII(std::ostream& out) {
+	// Byte count followed by the base64 packed binding split into tokens
+	std::ostringstream packed;
+	WriteBinding(binding, packed);
+	std::string bytes = packed.str();
+	std::string encoded = EncodeBase64(bytes.data(), bytes.size());
+	out << bytes.size();
+	for (size_t i = 0; i < encoded.size(); i += kAsciiChunkSize) {
+		out << "\n" << encoded.substr(i, kAsciiChunkSize);
+	}
+	out << " ";
+	return out.fail() ? MS::kFailure : MS::kSuccess;
+}
+
+MStatus WrapBindData::readASCII(const MArgList& args, unsigned int& lastElement) {
+	MStatus status;
+	unsigned int length = args.length(&status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (lastElement >= length) {
+		return MS::kFailure;
+	}
+	size_t byteCount = (size_t)args.asString(lastElement++, &status).asDouble();
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	std::string bytes;
+	while (bytes.size() < byteCount && lastElement < length) {
+		MString token = args.asString(lastElement++, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (!DecodeBase64(token.asChar(), bytes)) {
+			return MS::kFailure;
+		}
+	}
+	if (bytes.size() != byteCount) {
+		return MS::kFailure;
+	}
+	std::istringstream in(bytes);
+	if (!ReadBinding(in, bytes.size(), binding)) {
+		return MS::kFailure;
+	}
+	return MS::kSuccess;
+}
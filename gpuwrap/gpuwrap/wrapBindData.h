@@ -0,0 +1,38 @@
+#ifndef WRAPBINDDATA_H
+#define WRAPBINDDATA_H
+
+#include "common.h"
+
+#include <maya/MPxData.h>
+#include <maya/MTypeId.h>
+#include <maya/MString.h>
+#include <maya/MArgList.h>
+
+/*
+	Custom data holding the whole binding of one driven geometry as a single
+	packed, versioned buffer (see core/wrapBindingIO.h), so scenes store one
+	value per geometry instead of several plug elements per driven vertex.
+*/
+
+class WrapBindData : public MPxData {
+public:
+	WrapBindData();
+	virtual ~WrapBindData();
+
+	virtual MStatus readASCII(const MArgList& args, unsigned int& lastElement);
+	virtual MStatus readBinary(std::istream& in, unsigned int length);
+	virtual MStatus writeASCII(std::ostream& out);
+	virtual MStatus writeBinary(std::ostream& out);
+	virtual void copy(const MPxData& other);
+	virtual MTypeId typeId() const;
+	virtual MString name() const;
+
+	static void* creator();
+
+	const static char* kName;
+	static MTypeId id;
+
+	WrapBinding binding;
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include "wrapCmd.h"
+#include "wrapBindData.h"
 #include "wrapDeformer.h"
+#include "core/bindCache.h"
+#include "core/vertexNormals.h"
+#include "core/wrapBindingIO.h"
 
 #include <maya/MArgDatabase.h>
 #include <maya/MSyntax.h>
@@ -11,16 +15,44 @@
 #include <maya/MPointArray.h>
 #include <maya/MFnMesh.h>
 #include <maya/MFnMatrixData.h>
+#include <maya/MFnPluginData.h>
+#include <maya/MIntArray.h>
+#include <maya/MFloatVectorArray.h>
+#include <maya/MComputation.h>
+
+#include <chrono>
+#include <future>
 
 const char* WrapCmd::kName = "awWrap";
 const char* WrapCmd::kNameFlagShort = "-n";
 const char* WrapCmd::kNameFlagLong = "-name";
-
-WrapCmd::WrapCmd() : name_("awWrap#") {}
+const char* WrapCmd::kBindModeFlagShort = "-bm";
+const char* WrapCmd::kBindModeFlagLong = "-bindMode";
+const char* WrapCmd::kUpgradeBindingFlagShort = "-ub";
+const char* WrapCmd::kUpgradeBindingFlagLong = "-upgradeBinding";
+const char* WrapCmd::kMaxInfluencesFlagShort = "-mi";
+const char* WrapCmd::kMaxInfluencesFlagLong = "-maxInfluences";
+const char* WrapCmd::kFalloffRadiusFlagShort = "-fr";
+const char* WrapCmd::kFalloffRadiusFlagLong = "-falloffRadius";
+const char* WrapCmd::kBindCacheFlagShort = "-bc";
+const char* WrapCmd::kBindCacheFlagLong = "-bindCache";
+
+WrapCmd::WrapCmd() : name_("awWrap#"), bindMode_(kBindMatrix), upgradeBinding_(false) {}
 
 MSyntax WrapCmd::newSyntax() {
 	MSyntax syntax;
 	syntax.addFlag(kNameFlagShort, kNameFlagLong, MSyntax::kString);
+	// "matrix" (default) keeps upstream deformation of the driven mesh, "offset" stores 3 floats per vertex
+	syntax.addFlag(kBindModeFlagShort, kBindModeFlagLong, MSyntax::kString);
+	// Convert the per-vertex bind attributes of the selected wrap nodes to packedBinding
+	syntax.addFlag(kUpgradeBindingFlagShort, kUpgradeBindingFlagLong);
+	// Blend up to maxInfluences driver vertices within falloffRadius of the closest point,
+	// the default radius of 0 follows the closest triangle only
+	syntax.addFlag(kMaxInfluencesFlagShort, kMaxInfluencesFlagLong, MSyntax::kLong);
+	syntax.addFlag(kFalloffRadiusFlagShort, kFalloffRadiusFlagLong, MSyntax::kDouble);
+	// Directory of bind cache files. Bindings are looked up there by a hash of the bind inputs,
+	// new ones are written there, and the node only references the file.
+	syntax.addFlag(kBindCacheFlagShort, kBindCacheFlagLong, MSyntax::kString);
 	// Use the current selection as a selection list, and pass the selection as a default argument
 	syntax.setObjectType(MSyntax::kSelectionList, 0, 255);
 	syntax.useSelectionAsDefault(true);
@@ -41,6 +73,11 @@ MStatus WrapCmd::doIt(const MArgList& args) {
 	// Get the geometry from the command arguments
 	status = GatherCommandArguments(args);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (upgradeBinding_) {
+		status = UpgradeBindings();
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		return redoIt();
+	}
 	status = GetGeometryPaths();
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 	// Create deformer
@@ -61,6 +98,40 @@ MStatus WrapCmd::GatherCommandArguments(const MArgList& args) {
 		name_ = argData.flagArgumentString(kNameFlagShort, 0, &status);
 		CHECK_MSTATUS_AND_RETURN_IT(status);
 	}
+	if (argData.isFlagSet(kBindModeFlagShort)) {
+		MString bindMode = argData.flagArgumentString(kBindModeFlagShort, 0, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (bindMode == "matrix") {
+			bindMode_ = kBindMatrix;
+		} else if (bindMode == "offset") {
+			bindMode_ = kBindOffset;
+		} else {
+			MGlobal::displayError("Bind mode must be \"matrix\" or \"offset\"");
+			return MS::kInvalidParameter;
+		}
+	}
+	if (argData.isFlagSet(kMaxInfluencesFlagShort)) {
+		int maxInfluences = argData.flagArgumentInt(kMaxInfluencesFlagShort, 0, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (maxInfluences < 1) {
+			MGlobal::displayError("Max influences must be at least 1");
+			return MS::kInvalidParameter;
+		}
+		sampleSettings_.maxInfluences = (unsigned int)maxInfluences;
+	}
+	if (argData.isFlagSet(kFalloffRadiusFlagShort)) {
+		sampleSettings_.radius = argData.flagArgumentDouble(kFalloffRadiusFlagShort, 0, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (sampleSettings_.radius < 0.0) {
+			MGlobal::displayError("Falloff radius can not be negative");
+			return MS::kInvalidParameter;
+		}
+	}
+	if (argData.isFlagSet(kBindCacheFlagShort)) {
+		bindCacheDirectory_ = argData.flagArgumentString(kBindCacheFlagShort, 0, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	}
+	upgradeBinding_ = argData.isFlagSet(kUpgradeBindingFlagShort);
 	return MS::kSuccess;
 }
 
@@ -153,7 +224,9 @@ MStatus WrapCmd::GetLatestWrapNode() {
 
 MStatus WrapCmd::redoIt() {
 	MStatus status;
-
+	if (upgradeBinding_) {
+		return dgMod_.doIt();
+	}
 
 	// Calculate binding for wrap deformer
 	status = dgMod_.doIt();
@@ -168,13 +241,44 @@ MStatus WrapCmd::redoIt() {
 
 	// Get the created wrap deformer node
 	status = GetLatestWrapNode();
-
-	// Calculate the binding
-	MDGModifier dgMod;
-	status = CalculateBinding(pathDriver_, dgMod);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-	status = dgMod.doIt();
+
+	// Calculate the binding once, redo stores the same values again
+	bool binding = packedBindings_.length() == 0 && bindCacheFiles_.length() == 0;
+	MFnDependencyNode fnNode(oWrapNode_, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
+	Wrap* wrap = (Wrap*)fnNode.userNode();
+	WrapProfiler profiler(binding && wrap != nullptr && IsWrapStatsEnabled() ? &wrap->stats() : nullptr, kStatsBind, -1);
+	if (binding) {
+		status = CalculateBinding(pathDriver_, profiler);
+		if (status != MS::kSuccess) {
+			// A cancelled or failed bind leaves no half set up deformer behind
+			dgMod_.undoIt();
+			return status;
+		}
+	}
+
+	// Store all binding information on the deformer and connect the driver in one step,
+	// one packed value or bind cache file per driven geometry
+	MDGModifier dgMod;
+	MPlug plugBindData(oWrapNode_, Wrap::aBindData);
+	for (unsigned int geomIndex = 0; geomIndex < packedBindings_.length(); ++geomIndex) {
+		MPlug plugBind = plugBindData.elementByLogicalIndex(geomIndex, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		MPlug plugPackedBinding = plugBind.child(Wrap::aPackedBinding, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		status = dgMod.newPlugValue(plugPackedBinding, packedBindings_[geomIndex]);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	}
+	for (unsigned int geomIndex = 0; geomIndex < bindCacheFiles_.length(); ++geomIndex) {
+		MPlug plugBind = plugBindData.elementByLogicalIndex(geomIndex, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		MPlug plugBindCacheFile = plugBind.child(Wrap::aBindCacheFile, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		status = dgMod.newPlugValueString(plugBindCacheFile, bindCacheFiles_[geomIndex]);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	}
+
 	// Connect the driver mesh to the wrap deformer
 	MFnDagNode fnDriver(pathDriver_);
 	MPlug plugDriverMesh = fnDriver.findPlug("worldMesh", false, &status);
@@ -183,189 +287,291 @@ MStatus WrapCmd::redoIt() {
 	status = plugDriverMesh.selectAncestorLogicalIndex(0, plugDriverMesh.attribute());
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 	MPlug plugDriverGeo(oWrapNode_, Wrap::aDriverGeo);
-	MDGModifier dgMod2;
-	dgMod2.connect(plugDriverMesh, plugDriverGeo);
-
-	status = dgMod2.doIt();
+	status = dgMod.connect(plugDriverMesh, plugDriverGeo);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 
-	MFnDependencyNode fnNode(oWrapNode_, &status);
+	profiler.BeginPhase(kPhaseWriteBack);
+	status = dgMod.doIt();
 	CHECK_MSTATUS_AND_RETURN_IT(status);
+	profiler.EndPhase();
+
 	setResult(fnNode.name());
-	// Store all binding information on the deformer
 	return status;
 }
 
-MStatus WrapCmd::CalculateBinding(MDagPath& pathBindMesh, MDGModifier& dgMod) {
-	MStatus status;
-	BindData bindData;
+/**
+ * Creates an empty packedBinding value
+ * @param[out] oData The new data object
+ * @param[out] status
+ * @return The data to fill in, null on failure
+ */
+WrapBindData* CreateBindData(MObject& oData, MStatus* status) {
+	MFnPluginData fnData;
+	oData = fnData.create(WrapBindData::id, status);
+	if (*status != MS::kSuccess) {
+		return nullptr;
+	}
+	return (WrapBindData*)fnData.data(status);
+}
 
-	MObject oBindMesh = pathBindMesh.node();
-	MMatrix driverMatrix = pathBindMesh.inclusiveMatrix();
-	status = bindData.intersector.create(oBindMesh, driverMatrix);
+/**
+ * Reads a binding stored in the per-vertex bind attributes
+ * @param[in] plugBind bindData element of the geometry
+ * @param[out] binding Binding indexed by driven vertex logical index
+ * @return kNotFound if the element has no per-vertex binding
+ */
+MStatus GetLegacyBinding(MPlug& plugBind, WrapBinding& binding) {
+	MStatus status;
+	MPlug plugTriangleVerts = plugBind.child(Wrap::aTriangleVerts, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-
-	MFnMesh fnBindMesh(pathBindMesh, &status);
+	MPlug plugBarycentricWeights = plugBind.child(Wrap::aBarycentricWeights, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-	fnBindMesh.getPoints(bindData.driverPoints, MSpace::kWorld);
-	fnBindMesh.getVertexNormals(false, bindData.driverNormals, MSpace::kWorld);
-	// Resize the pftv vector to the polygon count
-	bindData.perFaceTriangleVertices.resize(fnBindMesh.numPolygons());
-
-	// Get triangles on the bind mesh, iterate through them to create a table lookup of triangle points
-	// Vertex count is per-polygon vertex count
-	// Vertex list is the actual indices
-	// Can use to iterate over all faces and pull out triangle information
-	MIntArray vertexCount, vertexList;
-	status = fnBindMesh.getVertices(vertexCount, vertexList);
+	MPlug plugBindMatrices = plugBind.child(Wrap::aBindMatrix, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-	MIntArray triangleCounts, triangleVertices;
-	status = fnBindMesh.getTriangles(triangleCounts, triangleVertices);
+	MPlug plugBindOffsets = plugBind.child(Wrap::aBindOffset, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 
-	for (unsigned int faceId = 0, triIter = 0; faceId < vertexCount.length(); ++faceId) {
-		bindData.perFaceTriangleVertices[faceId].resize(triangleCounts[faceId]);
-		// Iterate through each triangle of each face
-		for (int triId = 0; triId < triangleCounts[faceId]; ++triId) {
-			bindData.perFaceTriangleVertices[faceId][triId].setLength(3);
-			bindData.perFaceTriangleVertices[faceId][triId][0] = triangleVertices[triIter++];
-			bindData.perFaceTriangleVertices[faceId][triId][1] = triangleVertices[triIter++];
-			bindData.perFaceTriangleVertices[faceId][triId][2] = triangleVertices[triIter++];
-		}
+	MIntArray logicalIndices;
+	plugTriangleVerts.getExistingArrayAttributeIndices(logicalIndices, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (logicalIndices.length() == 0) {
+		return MS::kNotFound;
 	}
 
-	MPlug plugBindData(oWrapNode_, Wrap::aBindData);
+	binding.clear();
+	// Per-vertex bindings were all made with Maya's vertex normals
+	binding.normals = kMayaNormals;
+	binding.mode = plugBindOffsets.numElements() > 0 ? kBindOffset : kBindMatrix;
+	for (unsigned int i = 0; i < logicalIndices.length(); ++i) {
+		unsigned int logicalIndex = (unsigned int)logicalIndices[i];
+		if (logicalIndex >= binding.size()) {
+			binding.resize(logicalIndex + 1);
+		}
+		MPlug plugVerts = plugTriangleVerts.elementByLogicalIndex(logicalIndex);
+		MPlug plugWeights = plugBarycentricWeights.elementByLogicalIndex(logicalIndex);
+		for (unsigned int j = 0; j < 3; ++j) {
+			binding.triangleVerts[logicalIndex * 3 + j] = plugVerts.child(j).asInt();
+			binding.coords[logicalIndex][j] = plugWeights.child(j).asFloat();
+		}
+		if (binding.mode == kBindOffset) {
+			MPlug plugOffset = plugBindOffsets.elementByLogicalIndex(logicalIndex);
+			for (unsigned int j = 0; j < 3; ++j) {
+				binding.offsets[logicalIndex * 3 + j] = plugOffset.child(j).asFloat();
+			}
+		} else {
+			MFnMatrixData fnMatrixData(plugBindMatrices.elementByLogicalIndex(logicalIndex).asMObject());
+			GetMatrixBuffer(fnMatrixData.matrix(), &binding.bindMatrices[logicalIndex * 16]);
+		}
+	}
+	return MS::kSuccess;
+}
 
-	for (unsigned int geomIndex = 0; geomIndex < pathDriven_.length(); ++geomIndex) {
-		// Get plugs to binding attributes for this geometry
-		MPlug plugBind = plugBindData.elementByLogicalIndex(geomIndex, &status);
-		CHECK_MSTATUS_AND_RETURN_IT(status);
-		MPlug plugTriangleVerts = plugBind.child(Wrap::aTriangleVerts, &status);
-		CHECK_MSTATUS_AND_RETURN_IT(status);
-		MPlug plugBarycentricWeights = plugBind.child(Wrap::aBarycentricWeights, &status);
-		CHECK_MSTATUS_AND_RETURN_IT(status);
-		MPlug plugBindMatrices = plugBind.child(Wrap::aBindMatrix, &status);
+MStatus WrapCmd::UpgradeBindings() {
+	MStatus status;
+	unsigned int upgradedCount = 0;
+	for (unsigned int i = 0; i < selectionList_.length(); ++i) {
+		MObject oNode;
+		status = selectionList_.getDependNode(i, oNode);
 		CHECK_MSTATUS_AND_RETURN_IT(status);
-
-		MItGeometry itGeo(pathDriven_[geomIndex], &status);
-		MPointArray inputPoints;
-		// Grabbing points straight out of the iterator is usually more efficient than using the iterator
-		// then just calculate and put them back
-		status = itGeo.allPositions(inputPoints, MSpace::kWorld);
+		MFnDependencyNode fnNode(oNode, &status);
 		CHECK_MSTATUS_AND_RETURN_IT(status);
-
-		MPointOnMesh pointOnMesh;
-		// Resizing vectors
-		bindData.coords.resize(itGeo.count());
-		bindData.triangleVertices.resize(itGeo.count());
-		bindData.bindMatrices.setLength(itGeo.count());
-
-		// By the end of the loop, bind data will hold the per-vertex coords & verts for each triangle.
-		for (unsigned int i = 0; i < inputPoints.length(); i++) {
-			bindData.intersector.getClosestPoint(inputPoints[i], pointOnMesh);
-			// Convert into world space
-			// calling getPoint is going to be in the local space of the driver mesh
-
-			int faceId = pointOnMesh.faceIndex();
-			int triangleId = pointOnMesh.triangleIndex();
-
-			MPoint closestPoint = MPoint(pointOnMesh.getPoint()) * driverMatrix;
-
-			bindData.triangleVertices[i] = bindData.perFaceTriangleVertices[faceId][triangleId];
-			
-			// Since there's now a look-up table, can access the three vertices that make up the triangle
-			GetBarycentricCoordinates(closestPoint, 
-									  bindData.driverPoints[bindData.triangleVertices[i][0]],
-									  bindData.driverPoints[bindData.triangleVertices[i][1]],
-									  bindData.driverPoints[bindData.triangleVertices[i][2]],
-									  bindData.coords[i]);
-			
-			// Three things needed to generate transform matrix
-			MPoint origin;
-			MVector up;
-			MVector normal;
-
-			CalculateBasisComponents(bindData.coords[i], bindData.triangleVertices[i],
-									 bindData.driverPoints, bindData.driverNormals,
-									 origin, up, normal);
-
-			CreateMatrix(origin, normal, up, bindData.bindMatrices[i]);
-			bindData.bindMatrices[i] = bindData.bindMatrices[i].inverse();
-
+		if (fnNode.typeId() != Wrap::id) {
+			continue;
 		}
-
-		// Store the data in the wrap node data block.
-		// Iterate through the geometry one by one because we need to grab the logical index 
-		// out of geometry iterator because as we're iterating, indices aren't going to be continuous
-		for (int i = 0; !itGeo.isDone(); itGeo.next(), ++i) {
-			int logicalIndex = itGeo.index();
-
-			// Store the bind matrix
-			MFnMatrixData fnMatrixData;
-			MObject oMatrixData = fnMatrixData.create(bindData.bindMatrices[i], &status);
+		MPlug plugBindData(oNode, Wrap::aBindData);
+		MIntArray geomIndices;
+		plugBindData.getExistingArrayAttributeIndices(geomIndices, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		for (unsigned int j = 0; j < geomIndices.length(); ++j) {
+			MPlug plugBind = plugBindData.elementByLogicalIndex(geomIndices[j], &status);
 			CHECK_MSTATUS_AND_RETURN_IT(status);
-			MPlug plugBindMatrixElement = plugBindMatrices.elementByLogicalIndex(logicalIndex, &status);
+			MObject oData;
+			WrapBindData* data = CreateBindData(oData, &status);
 			CHECK_MSTATUS_AND_RETURN_IT(status);
-			status = dgMod.newPlugValue(plugBindMatrixElement, oMatrixData);
+			status = GetLegacyBinding(plugBind, data->binding);
+			if (status == MS::kNotFound) {
+				// Already packed or never bound
+				continue;
+			}
 			CHECK_MSTATUS_AND_RETURN_IT(status);
-
-			// Storing triangle vertices
-			MFnNumericData fnNumericData;
-			MObject oNumericData = fnNumericData.create(MFnNumericData::k3Int, &status);
+			// Dropping the element removes every per-vertex value, packedBinding then recreates it
+			status = dgMod_.removeMultiInstance(plugBind, true);
 			CHECK_MSTATUS_AND_RETURN_IT(status);
-			status = fnNumericData.setData3Int(
-				bindData.triangleVertices[i][0],
-				bindData.triangleVertices[i][1],
-				bindData.triangleVertices[i][2]);
-
-			MPlug plugTriangleVertsElement = plugTriangleVerts.elementByLogicalIndex(logicalIndex, &status);
+			MPlug plugPackedBinding = plugBind.child(Wrap::aPackedBinding, &status);
 			CHECK_MSTATUS_AND_RETURN_IT(status);
-			status = dgMod.newPlugValue(plugTriangleVertsElement, oNumericData);
+			status = dgMod_.newPlugValue(plugPackedBinding, oData);
 			CHECK_MSTATUS_AND_RETURN_IT(status);
+			++upgradedCount;
+		}
+	}
+	setResult((int)upgradedCount);
+	return MS::kSuccess;
+}
 
-			// store barycentric weights
-			oNumericData = fnNumericData.create(MFnNumericData::k3Float, &status);
-			CHECK_MSTATUS_AND_RETURN_IT(status);
-			status = fnNumericData.setData3Float(
-				bindData.coords[i][0],
-				bindData.coords[i][1],
-				bindData.coords[i][2]);
+MStatus WrapCmd::CalculateBinding(MDagPath& pathBindMesh, WrapProfiler& profiler) {
+	MStatus status;
+	BindData bindData;
+	profiler.BeginPhase(kPhaseDriverFetch);
 
-			MPlug plugBarycentricWeightsElement = plugBarycentricWeights.elementByLogicalIndex(logicalIndex, &status);
-			CHECK_MSTATUS_AND_RETURN_IT(status);
-			status = dgMod.newPlugValue(plugBarycentricWeightsElement, oNumericData);
-			CHECK_MSTATUS_AND_RETURN_IT(status);
+	MFnMesh fnBindMesh(pathBindMesh, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	MPointArray driverPoints;
+	fnBindMesh.getPoints(driverPoints, MSpace::kWorld);
+	GetPointBuffer(driverPoints, bindData.driverPoints);
 
+	// Get triangles on the bind mesh to create a table lookup of triangle points
+	// Triangle counts are per-polygon, triangle vertices are 3 vertex ids per triangle
+	MIntArray triangleCounts, triangleVertices;
+	status = fnBindMesh.getTriangles(triangleCounts, triangleVertices);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	bindData.triangleVertices.resize(triangleVertices.length());
+	triangleVertices.get(bindData.triangleVertices.data());
+
+	// Every Maya read happens here on the main thread, the worker only sees plain buffers
+	profiler.BeginPhase(kPhaseInput);
+	TaskProgress progress;
+	bindData.drivenPoints.resize(pathDriven_.length());
+	for (unsigned int geomIndex = 0; geomIndex < pathDriven_.length(); ++geomIndex) {
+		MItGeometry itGeo(pathDriven_[geomIndex], &status);
+		MPointArray inputPoints;
+		// Grabbing points straight out of the iterator is usually more efficient than using the iterator
+		// then just calculate and put them back
+		status = itGeo.allPositions(inputPoints, MSpace::kWorld);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		GetPointBuffer(inputPoints, bindData.drivenPoints[geomIndex]);
+		progress.AddTotal((unsigned long long)kBindStepsPerPoint * inputPoints.length());
+	}
+	profiler.EndPhase();
+
+	// Bind on a worker while this thread keeps the progress bar moving and watches for Esc
+	std::vector<WrapBinding> bindings;
+	std::vector<std::string> bindCacheFiles;
+	std::string error;
+	MComputation computation;
+	computation.beginComputation(true, true);
+	computation.setProgressRange(0, 100);
+	std::future<bool> job = std::async(std::launch::async, [&]() {
+		return BindGeometries(bindData, profiler, progress, bindings, bindCacheFiles, error);
+	});
+	while (job.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+		if (computation.isInterruptRequested()) {
+			progress.Cancel();
+		}
+		computation.setProgress((int)(progress.fraction() * 100.0));
+	}
+	bool bound = job.get();
+	computation.endComputation();
+	if (progress.cancelled()) {
+		MGlobal::displayWarning("The wrap binding was cancelled");
+		return MS::kFailure;
+	}
+	if (!bound) {
+		MGlobal::displayError(error.c_str());
+		return MS::kFailure;
+	}
+
+	// Plug-in data can only be created on the main thread
+	packedBindings_.clear();
+	bindCacheFiles_.clear();
+	for (unsigned int geomIndex = 0; geomIndex < pathDriven_.length(); ++geomIndex) {
+		if (!bindCacheFiles[geomIndex].empty()) {
+			bindCacheFiles_.append(bindCacheFiles[geomIndex].c_str());
+			continue;
 		}
-		
+		// Moved straight into the value stored on the node
+		MObject oData;
+		WrapBindData* data = CreateBindData(oData, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		data->binding = std::move(bindings[geomIndex]);
+		packedBindings_.append(oData);
 	}
 	return MS::kSuccess;
 }
 
-void WrapCmd::GetBarycentricCoordinates(const MPoint& P, const MPoint& A, const MPoint& B, const MPoint& C, BaryCoords& coords) {
-	// Compute the normal of the triangle
-	MVector N = (B - A) ^ (C - A);
-	MVector unitN = N.normal();
-	// Compute twice area of triangle ABC
-	double areaABC = unitN * N;
-	// If the triangle is degenerate (point on top of each other), just use one of the points
-	if (areaABC == 0.0) {
-		coords[0] = 1.0f;
-		coords[1] = 0.0f;
-		coords[2] = 0.0f;
-		return;
+bool WrapCmd::BindGeometries(BindData& bindData, WrapProfiler& profiler, TaskProgress& progress,
+							 std::vector<WrapBinding>& bindings, std::vector<std::string>& bindCacheFiles,
+							 std::string& error) const {
+	unsigned int driverVertexCount = (unsigned int)bindData.driverPoints.size() / 3;
+	unsigned int triangleCount = (unsigned int)bindData.triangleVertices.size() / 3;
+
+	// The closest point search and the bind normals are only built once a geometry misses the bind cache
+	VertexTriangles adjacency;
+	bool driverPrepared = false;
+
+	unsigned int geomCount = (unsigned int)bindData.drivenPoints.size();
+	bindings.assign(geomCount, WrapBinding());
+	bindCacheFiles.assign(geomCount, std::string());
+	for (unsigned int geomIndex = 0; geomIndex < geomCount && !progress.cancelled(); ++geomIndex) {
+		const std::vector<double>& drivenPoints = bindData.drivenPoints[geomIndex];
+		unsigned int drivenCount = (unsigned int)drivenPoints.size() / 3;
+
+		uint64_t key = 0;
+		std::string bindCacheFile;
+		if (bindCacheDirectory_.length() > 0) {
+			// Rebinding an unchanged asset only maps the file it was bound to before
+			profiler.BeginPhase(kPhaseBind);
+			key = HashBindInputs(bindData.driverPoints.data(), driverVertexCount, bindData.triangleVertices.data(),
+								 triangleCount, drivenPoints.data(), drivenCount, bindMode_, sampleSettings_);
+			bindCacheFile = std::string(bindCacheDirectory_.asChar()) + "/" + GetBindCacheFileName(key);
+			WrapBinding cached;
+			uint64_t cachedKey = 0;
+			if (ReadBindCache(bindCacheFile, cached, &cachedKey) && cachedKey == key && cached.size() == drivenCount) {
+				bindCacheFiles[geomIndex] = bindCacheFile;
+				if (WrapStatsRecord* record = profiler.record()) {
+					record->drivenVertices += drivenCount;
+					record->bindDataBytes += GetBindingByteSize(cached);
+				}
+				progress.Advance((unsigned long long)kBindStepsPerPoint * drivenCount);
+				continue;
+			}
+		}
+
+		if (!driverPrepared) {
+			// The closest point search works on the same triangle ids, so no face to triangle lookup is needed
+			profiler.BeginPhase(kPhaseBvhBuild);
+			bindData.bvh.Build(bindData.driverPoints.data(), bindData.triangleVertices.data(), triangleCount);
+
+			// Bind with the normals the deformer computes itself, so the bind pose is reproduced exactly
+			profiler.BeginPhase(kPhaseNormals);
+			adjacency.Build(bindData.triangleVertices.data(), triangleCount, driverVertexCount);
+			bindData.driverNormals.resize(driverVertexCount * 3);
+			ParallelFor(driverVertexCount, kDefaultGrainSize, [&](unsigned int begin, unsigned int end) {
+				ComputeVertexNormals(adjacency, bindData.triangleVertices.data(), bindData.driverPoints.data(), nullptr,
+									 begin, end, bindData.driverNormals.data());
+			});
+			driverPrepared = true;
+		}
+
+		// Closest points and bind frames of all the vertices, in parallel
+		profiler.BeginPhase(kPhaseBind);
+		WrapBinding& binding = bindings[geomIndex];
+		binding.mode = bindMode_;
+		binding.normals = kAreaWeightedNormals;
+		BindPoints(bindData.bvh, adjacency, sampleSettings_, drivenPoints.data(), drivenCount,
+				   bindData.triangleVertices.data(), bindData.driverPoints.data(), bindData.driverNormals.data(),
+				   binding, kDefaultGrainSize, &progress);
+		if (progress.cancelled()) {
+			break;
+		}
+		// Deform in a spatially coherent order, the driver reads then stay close in memory
+		OrderBindingForLocality(drivenPoints.data(), binding);
+		if (WrapStatsRecord* record = profiler.record()) {
+			record->drivenVertices += drivenCount;
+			record->bindDataBytes += GetBindingByteSize(binding);
+		}
+		if (!bindCacheFile.empty()) {
+			if (!WriteBindCache(bindCacheFile, key, binding)) {
+				error = "Could not write the bind cache " + bindCacheFile;
+				return false;
+			}
+			bindCacheFiles[geomIndex] = bindCacheFile;
+			binding = WrapBinding();
+		}
 	}
-	// Compute A
-	double areaPBC = unitN * ((B - P) ^ (C - P));
-	coords[0] = (float)(areaPBC / areaABC);
-	// Compute B
-	double areaPCA = unitN * ((C - P) ^ (A - P));
-	coords[1] = (float)(areaPCA / areaABC);
-	// Compute C
-	coords[2] = 1.0f - coords[0] - coords[1];
+	profiler.EndPhase();
+	return !progress.cancelled();
 }
 
-
 MStatus WrapCmd::undoIt() {
 	MStatus status;
 	status = dgMod_.undoIt();
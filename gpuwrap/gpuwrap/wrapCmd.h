@@ -2,7 +2,9 @@
 #define WRAPCMD_H
 
 #include "common.h"
+#include "wrapProfiler.h"
 
+#include <string>
 #include <vector>
 
 #include <maya/MArgList.h>
@@ -11,29 +13,22 @@
 #include <maya/MDagPathArray.h>
 #include <maya/MSelectionList.h>
 #include <maya/MDGModifier.h>
-#include <maya/MMeshIntersector.h>
-#include <maya/MPointArray.h>
-#include <maya/MFloatVectorArray.h>
-#include <maya/MMatrixArray.h>
+#include <maya/MObjectArray.h>
+#include <maya/MStringArray.h>
 
 struct BindData {
-	MPointArray driverPoints;
-	MFloatVectorArray driverNormals;
-	// The first vector will be accessed by the face id
-	// The second vector will be accessed by the triangle id on that face
-	// MIntArray will be 3 vertex indices on that triangle
-	std::vector<std::vector<MIntArray>> perFaceTriangleVertices; /**< The per-face per-triangle vertex id of the driver*/
-	MMeshIntersector intersector;
-	std::vector<BaryCoords> coords;
-	// MIntArray will always be length 3
-	// Vector is per-vertex storage on the deforming mesh.
-	// For each vertex on the deforming mesh, it's storing the 3 triangle mesh ids
-	std::vector<MIntArray> triangleVertices;
-	MMatrixArray bindMatrices;
+	std::vector<double> driverPoints; /**< World space driver points, 3 doubles per vertex */
+	std::vector<float> driverNormals; /**< World space area weighted driver normals, 3 floats per vertex */
+	// getTriangles output, 3 vertex ids per triangle
+	std::vector<int> triangleVertices;
+	TriangleBvh bvh; /**< Closest point search over the getTriangles triangles */
+	std::vector<std::vector<double>> drivenPoints; /**< World space points of each driven geometry */
 };
 
 /*
-	The Wrap Command is used to create new Wrap Deformers
+	The Wrap Command is used to create new Wrap Deformers. The binding runs on
+	worker threads while Maya shows its progress, and pressing Esc cancels it
+	and removes the new deformer.
 */
 
 class WrapCmd : public MPxCommand {
@@ -49,6 +44,16 @@ public:
 
 	const static char*	kNameFlagShort;
 	const static char*	kNameFlagLong;
+	const static char*	kBindModeFlagShort;
+	const static char*	kBindModeFlagLong;
+	const static char*	kUpgradeBindingFlagShort;
+	const static char*	kUpgradeBindingFlagLong;
+	const static char*	kMaxInfluencesFlagShort;
+	const static char*	kMaxInfluencesFlagLong;
+	const static char*	kFalloffRadiusFlagShort;
+	const static char*	kFalloffRadiusFlagLong;
+	const static char*	kBindCacheFlagShort;
+	const static char*	kBindCacheFlagLong;
 private:
 	/**
 		Gathers all the command arguments and sets necessary command slates
@@ -74,24 +79,46 @@ private:
 	*/
 	MStatus GetShapeNode(MDagPath& path, bool intermediate = false);
 
-	MStatus CalculateBinding(MDagPath& path, MDGModifier& dgMod);
-	
-	/* 
-	 * Get the barycentric coordinates of point P in the triangle specified by points A,B,C
-	 * @param[in] P - The sample point
-	 * @param[in] A - Triangle point
-	 * @param[in] B - Triangle point
-	 * @param[in] C - Triangle point
-	 * @param[out] coords Barycentric coordinates storage
+	/**
+	 * Binds every driven geometry to the driver into packedBindings_, or into bind
+	 * cache files listed in bindCacheFiles_ when a bind cache directory is given
+	 * @param[in] path Path to the driver shape
+	 * @param[in,out] profiler Times the bind phases and counts the bound vertices
+	 */
+	MStatus CalculateBinding(MDagPath& path, WrapProfiler& profiler);
+
+	/**
+	 * Binds the gathered geometries, off the main thread, so it must not call into Maya
+	 * @param[in,out] bindData Driver and driven points, the closest point search and normals are built on a cache miss
+	 * @param[in,out] profiler Times the bind phases and counts the bound vertices
+	 * @param[in,out] progress Advanced by kBindStepsPerPoint steps per driven point, checked for a cancel
+	 * @param[out] bindings Binding per driven geometry, empty for the geometries stored in a bind cache file
+	 * @param[out] bindCacheFiles Bind cache file per driven geometry, empty to store the binding on the node
+	 * @param[out] error Why the binding failed
+	 * @return false if the binding failed or was cancelled
+	 */
+	bool BindGeometries(BindData& bindData, WrapProfiler& profiler, TaskProgress& progress,
+						std::vector<WrapBinding>& bindings, std::vector<std::string>& bindCacheFiles,
+						std::string& error) const;
+
+	/**
+	 * Queues the conversion of the per-vertex bind attributes of the selected wrap
+	 * nodes into packedBinding values on dgMod_
 	 */
-	void GetBarycentricCoordinates(const MPoint& P, const MPoint& A, const MPoint& B, const MPoint& C, BaryCoords& coords);
+	MStatus UpgradeBindings();
 
 	MString name_; // Name of Wrap node to create
+	BindMode bindMode_; // How the binding is stored, matrix or offset
+	SampleSettings sampleSettings_; // Driver vertices blended per driven vertex, none with a 0 radius
+	MString bindCacheDirectory_; // Directory of the bind cache files, empty to store the binding on the node
+	bool upgradeBinding_; // Convert existing wrap nodes instead of creating one
 	MDagPath pathDriver_; // Path to the shape wrapping the other shape
 	MDagPathArray pathDriven_; // Path to the shapes being wrapped
 	MSelectionList selectionList_; // Selected command input 
 	MDGModifier dgMod_;
 	MObject oWrapNode_; // MObject to the wrap node in focus.
+	MObjectArray packedBindings_; // WrapBindData per driven geometry, kept for redo
+	MStringArray bindCacheFiles_; // Bind cache file per driven geometry, kept for redo
 };
 
 #endif
\ No newline at end of file
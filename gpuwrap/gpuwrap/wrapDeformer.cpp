@@ -1,5 +1,11 @@
 #include "wrapDeformer.h"
+#include "wrapBindData.h"
 #include "common.h"
+#include "wrapProfiler.h"
+#include "core/bindCache.h"
+#include "core/sharedCache.h"
+#include "core/threadPool.h"
+#include "core/wrapBindingIO.h"
 
 #include <maya/MGlobal.h>
 #include <maya/MItGeometry.h>
@@ -7,10 +13,17 @@
 #include <maya/MDataBlock.h>
 #include <maya/MMatrix.h>
 #include <maya/MFnCompoundAttribute.h>
+#include <maya/MFnEnumAttribute.h>
 #include <maya/MFnMatrixAttribute.h>
 #include <maya/MFnNumericAttribute.h>
 #include <maya/MFnTypedAttribute.h>
 #include <maya/MFnMesh.h>
+#include <maya/MFnPluginData.h>
+#include <maya/MPointArray.h>
+#include <maya/MFloatVectorArray.h>
+#include <maya/MIntArray.h>
+
+#include <algorithm>
 
 // Need to get an id from Autodesk, I made this one up.
 MTypeId Wrap::id(0x0014456B);
@@ -18,13 +31,51 @@ MTypeId Wrap::id(0x0014456B);
 // might conflict because the command has the same kName
 const char* Wrap::kName = "awWrap";
 
+// Fraction of the referenced driver vertices that may move before an incremental deform falls back to a full one
+static const double kIncrementalMaxChangedFraction = 0.25;
+
 MObject Wrap::aDriverGeo;
+MObject Wrap::aGrainSize;
+MObject Wrap::aIncremental;
+MObject Wrap::aPrecision;
+MObject Wrap::aOutputCacheFrames;
 MObject Wrap::aBindData;
 MObject Wrap::aSampleComponents;
 MObject Wrap::aSampleWeights;
 MObject Wrap::aTriangleVerts;
 MObject Wrap::aBarycentricWeights;
 MObject Wrap::aBindMatrix;
+MObject Wrap::aBindOffset;
+MObject Wrap::aPackedBinding;
+MObject Wrap::aBindCacheFile;
+
+namespace {
+
+/**
+ * Driver points of every wrap node in the scene, by the hash of the raw points, matrix and topology
+ */
+SharedCache<SharedDriverPoints>& GetSharedDriverPoints() {
+	static SharedCache<SharedDriverPoints> cache;
+	return cache;
+}
+
+/**
+ * Driver triangles of every wrap node in the scene, by the hash of the faces
+ */
+SharedCache<SharedDriverTopology>& GetSharedDriverTopologies() {
+	static SharedCache<SharedDriverTopology> cache;
+	return cache;
+}
+
+/**
+ * Keeps a deform output in the output cache, in element order
+ */
+template <typename Real>
+void StoreOutput(const std::vector<Real>& points, std::vector<float>& stored) {
+	stored.assign(points.begin(), points.end());
+}
+
+}
 
 MStatus Wrap::initialize() {
 	MFnCompoundAttribute cAttr;
@@ -37,6 +88,32 @@ MStatus Wrap::initialize() {
 	addAttribute(aDriverGeo);
 	attributeAffects(aDriverGeo, outputGeom);
 
+	// Meshes with fewer driven vertices than this are deformed on one thread
+	aGrainSize = nAttr.create("grainSize", "grainSize", MFnNumericData::kInt, kDefaultGrainSize);
+	nAttr.setMin(1);
+	nAttr.setSoftMax(16384);
+	addAttribute(aGrainSize);
+
+	// Only re-evaluate the driven vertices whose driver vertices moved since the last evaluation
+	aIncremental = nAttr.create("incremental", "incremental", MFnNumericData::kBoolean, false);
+	addAttribute(aIncremental);
+	attributeAffects(aIncremental, outputGeom);
+
+	// Float is enough for rendering and playback at half the memory traffic, double for precision critical cases
+	MFnEnumAttribute eAttr;
+	aPrecision = eAttr.create("precision", "precision", kPrecisionDouble);
+	eAttr.addField("double", kPrecisionDouble);
+	eAttr.addField("float", kPrecisionFloat);
+	addAttribute(aPrecision);
+	attributeAffects(aPrecision, outputGeom);
+
+	// Scrubbing back and forth and renders evaluate the same frames again. Up to this many outputs
+	// per geometry are kept by a hash of their inputs and copied back instead of deformed again.
+	aOutputCacheFrames = nAttr.create("outputCacheFrames", "outputCacheFrames", MFnNumericData::kInt, 0);
+	nAttr.setMin(0);
+	nAttr.setSoftMax(16);
+	addAttribute(aOutputCacheFrames);
+
 	/* Each output geometry needs:
 	-- bindData: per geometry.
 	   | -- sampleComponents
@@ -44,6 +121,8 @@ MStatus Wrap::initialize() {
 	   | -- triangleVerts
 	   | -- barycentric weights
 	   | -- bindMatrix
+	   | -- bindOffset
+	   | -- packedBinding
 	*/
 	// Per-vertex Attributes
 	aSampleComponents = tAttr.create("sampleComponents", "sampleComponents", MFnData::kIntArray);
@@ -63,6 +142,19 @@ MStatus Wrap::initialize() {
 	mAttr.setDefault(MMatrix::identity);
 	mAttr.setArray(true);
 
+	// Bind position expressed in the bind frame, only written by the offset bind mode
+	aBindOffset = nAttr.create("bindOffset", "bindOffset", MFnNumericData::k3Float);
+	nAttr.setArray(true);
+
+	// Whole binding in one value, written by the command instead of the per-vertex attributes.
+	// Scenes from before it existed still load through the per-vertex attributes.
+	aPackedBinding = tAttr.create("packedBinding", "packedBinding", WrapBindData::id);
+
+	// Path of a bind cache file written by awWrap -bindCache. The file is mapped on the first
+	// evaluation and deformed from in place, so only the path is saved with the scene.
+	aBindCacheFile = tAttr.create("bindCacheFile", "bindCacheFile", MFnData::kString);
+	tAttr.setUsedAsFilename(true);
+
 	// Per-geometry attribute
 	aBindData = cAttr.create("bindData", "bindData");
 	cAttr.setArray(true);
@@ -71,6 +163,9 @@ MStatus Wrap::initialize() {
 	cAttr.addChild(aTriangleVerts);
 	cAttr.addChild(aBarycentricWeights);
 	cAttr.addChild(aBindMatrix);
+	cAttr.addChild(aBindOffset);
+	cAttr.addChild(aPackedBinding);
+	cAttr.addChild(aBindCacheFile);
 	addAttribute(aBindData);
 	// trigger dirty calculations to recalculate deformer
 	attributeAffects(aSampleComponents, outputGeom);
@@ -78,6 +173,9 @@ MStatus Wrap::initialize() {
 	attributeAffects(aTriangleVerts, outputGeom);
 	attributeAffects(aBarycentricWeights, outputGeom);
 	attributeAffects(aBindMatrix, outputGeom);
+	attributeAffects(aBindOffset, outputGeom);
+	attributeAffects(aPackedBinding, outputGeom);
+	attributeAffects(aBindCacheFile, outputGeom);
 
 	MGlobal::executeCommand("makePaintable -attrType multiFloat -sm deformer awWrap weights");
 
@@ -91,9 +189,27 @@ MStatus GetBindInfo(MDataBlock& data, unsigned int geomIndex, TaskData& taskData
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 	MDataHandle hBindData = hBindDataArray.inputValue();
 
+	WrapBindData* packedData = (WrapBindData*)hBindData.child(Wrap::aPackedBinding).asPluginData();
+	if (packedData != nullptr && packedData->binding.size() > 0) {
+		taskData.binding = packedData->binding;
+		return MS::kSuccess;
+	}
+
+	MString bindCacheFile = hBindData.child(Wrap::aBindCacheFile).asString();
+	if (bindCacheFile.length() > 0) {
+		// Views of the mapped file, nothing is copied
+		if (!ReadBindCache(bindCacheFile.asChar(), taskData.binding)) {
+			MGlobal::displayError("awWrap: could not read the bind cache " + bindCacheFile);
+			return MS::kFailure;
+		}
+		return MS::kSuccess;
+	}
+
+	// Bindings from before packedBinding, one plug element per driven vertex
 	MArrayDataHandle hTriangleVerts = hBindData.child(Wrap::aTriangleVerts);
 	MArrayDataHandle hBarycentricWeights = hBindData.child(Wrap::aBarycentricWeights);
 	MArrayDataHandle hBindMatrix = hBindData.child(Wrap::aBindMatrix);
+	MArrayDataHandle hBindOffset = hBindData.child(Wrap::aBindOffset);
 
 	unsigned int numComponents = hTriangleVerts.elementCount();
 	if (numComponents == 0) {
@@ -104,22 +220,37 @@ MStatus GetBindInfo(MDataBlock& data, unsigned int geomIndex, TaskData& taskData
 	hTriangleVerts.jumpToArrayElement(0);
 	hBarycentricWeights.jumpToArrayElement(0);
 
+	WrapBinding& binding = taskData.binding;
+	binding.clear();
+	binding.normals = kMayaNormals;
+	// Offset bindings are written without bind matrices
+	binding.mode = hBindOffset.elementCount() > 0 ? kBindOffset : kBindMatrix;
+	if (binding.mode == kBindOffset) {
+		hBindOffset.jumpToArrayElement(0);
+	}
 	for (unsigned int i = 0; i < numComponents; i++) {
-		int logicalIndex = hTriangleVerts.elementIndex();
-		if (logicalIndex >= taskData.triangleVerts.size()) {
-			taskData.triangleVerts.resize(logicalIndex + 1);
-			taskData.baryCoords.resize(logicalIndex + 1);
-			taskData.bindMatrices.setLength(logicalIndex + 1);
+		unsigned int logicalIndex = hTriangleVerts.elementIndex();
+		if (logicalIndex >= binding.size()) {
+			binding.resize(logicalIndex + 1);
+		}
+		if (binding.mode == kBindOffset) {
+			// Get the offset in the bind frame
+			float3& offset = hBindOffset.inputValue(&status).asFloat3();
+			CHECK_MSTATUS_AND_RETURN_IT(status);
+			binding.offsets[logicalIndex * 3] = offset[0];
+			binding.offsets[logicalIndex * 3 + 1] = offset[1];
+			binding.offsets[logicalIndex * 3 + 2] = offset[2];
+			hBindOffset.next();
+		} else {
+			// Get bind matrix
+			GetMatrixBuffer(hBindMatrix.inputValue().asMatrix(), &binding.bindMatrices[logicalIndex * 16]);
+			hBindMatrix.next();
 		}
-		// Get bind matrix
-		taskData.bindMatrices[logicalIndex] = hBindMatrix.inputValue().asMatrix();
-
 
 		// Get the triangle vertex binding
 		int3& verts = hTriangleVerts.inputValue(&status).asInt3();
 		CHECK_MSTATUS_AND_RETURN_IT(status);
-		MIntArray& triangleVerts = taskData.triangleVerts[logicalIndex];
-		triangleVerts.setLength(3);
+		int* triangleVerts = &binding.triangleVerts[logicalIndex * 3];
 		triangleVerts[0] = verts[0];
 		triangleVerts[1] = verts[1];
 		triangleVerts[2] = verts[2];
@@ -127,21 +258,88 @@ MStatus GetBindInfo(MDataBlock& data, unsigned int geomIndex, TaskData& taskData
 		// Get barycentric weights 
 		float3& baryWeights = hBarycentricWeights.inputValue(&status).asFloat3();
 		CHECK_MSTATUS_AND_RETURN_IT(status);
-		BaryCoords& coords = taskData.baryCoords[logicalIndex];
+		BaryCoords& coords = binding.coords[logicalIndex];
 		coords[0] = baryWeights[0];
 		coords[1] = baryWeights[1];
 		coords[2] = baryWeights[2];
 
 		hTriangleVerts.next();
 		hBarycentricWeights.next();
-		hBindMatrix.next();
 
 	}
 
 	return MS::kSuccess;
 }
 
-Wrap::Wrap() {
+/**
+ * Finds the component id of each vertex deformed through an iterator
+ * @param[out] componentIds Id per iteration position, empty when they are the positions themselves
+ */
+void GetComponentIds(MItGeometry& itGeo, std::vector<int>& componentIds) {
+	componentIds.clear();
+	bool sequential = true;
+	for (itGeo.reset(); !itGeo.isDone(); itGeo.next()) {
+		int id = itGeo.index();
+		sequential = sequential && id == (int)componentIds.size();
+		componentIds.push_back(id);
+	}
+	itGeo.reset();
+	if (sequential) {
+		componentIds.clear();
+	}
+}
+
+/**
+ * Reads the painted weights of a geometry in the element order of its binding
+ * and the driven vertices they leave active
+ * @param[in] count Number of driven vertices, the size of the binding if it has a vertex order
+ */
+MStatus GetWeights(MDataBlock& data, unsigned int geomIndex, unsigned int count, TaskData& taskData) {
+	MStatus status;
+	// Unpainted vertices have the default weight of 1
+	taskData.weights.assign(count, 1.0f);
+	// The weights are indexed by component id, a deformer set of some of the vertices iterates fewer of them
+	const std::vector<int>& componentIds = taskData.componentIds;
+	std::vector<int> positions;
+	if (!componentIds.empty()) {
+		positions.assign(*std::max_element(componentIds.begin(), componentIds.end()) + 1, -1);
+		for (unsigned int i = 0; i < componentIds.size() && i < count; ++i) {
+			positions[componentIds[i]] = (int)i;
+		}
+	}
+	MArrayDataHandle hWeightList = data.inputArrayValue(MPxDeformerNode::weightList, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (hWeightList.jumpToElement(geomIndex) == MS::kSuccess) {
+		MArrayDataHandle hWeights = hWeightList.inputValue().child(MPxDeformerNode::weights);
+		unsigned int weightCount = hWeights.elementCount();
+		for (unsigned int i = 0; i < weightCount; ++i, hWeights.next()) {
+			unsigned int index = hWeights.elementIndex();
+			if (!componentIds.empty()) {
+				if (index >= positions.size() || positions[index] < 0) {
+					continue;
+				}
+				index = (unsigned int)positions[index];
+			}
+			if (index < count) {
+				taskData.weights[index] = hWeights.inputValue().asFloat();
+			}
+		}
+	}
+	if (taskData.binding.hasVertexOrder()) {
+		// The weights follow the element order of the binding
+		std::vector<float> weights(count);
+		for (unsigned int i = 0; i < count; ++i) {
+			weights[i] = taskData.weights[taskData.binding.vertexId(i)];
+		}
+		taskData.weights.swap(weights);
+	}
+	taskData.allWeightsOne = FindActiveVertices(taskData.weights.data(), count, taskData.activeVertices);
+	taskData.weightsDirty = false;
+	return MS::kSuccess;
+}
+
+Wrap::Wrap()
+	: driverDirty_(true), driverTopologyKey_(0), driverVertexCount_(-1), driverPolygonCount_(-1), driverFaceVertexCount_(-1) {
 
 }
 
@@ -153,9 +351,380 @@ void* Wrap::creator() {
 	return new Wrap();
 }
 
+MStatus Wrap::GetBakeData(unsigned int geomIndex, TaskData& taskData) {
+	MDataBlock data = forceCache();
+	MStatus status = GetBindInfo(data, geomIndex, taskData);
+	if (status != MS::kSuccess) {
+		taskData.binding.clear();
+		return status;
+	}
+	taskData.binding.UpdateReferencedVertices();
+	// Only the component ids of the last deform are known here, before one the whole geometry is assumed
+	taskData.componentIds = GetTaskData(geomIndex).componentIds;
+	return GetWeights(data, geomIndex, taskData.binding.size(), taskData);
+}
+
+TaskData& Wrap::GetTaskData(unsigned int geomIndex) {
+	std::lock_guard<std::mutex> lock(taskDataMutex_);
+	return taskData_[geomIndex];
+}
+
+void Wrap::SetBindDirty() {
+	std::lock_guard<std::mutex> lock(taskDataMutex_);
+	for (auto& item : taskData_) {
+		item.second.bindDirty = true;
+	}
+}
+
+void Wrap::SetWeightsDirty() {
+	std::lock_guard<std::mutex> lock(taskDataMutex_);
+	for (auto& item : taskData_) {
+		item.second.weightsDirty = true;
+	}
+}
+
+void Wrap::SetDriverDirty() {
+	std::lock_guard<std::mutex> lock(driverMutex_);
+	driverDirty_ = true;
+}
+
+MStatus Wrap::FetchDriverData(MFnMesh& fnDriver, const MMatrix& driverMatrix, bool normalContext, DriverEvaluation& driver) {
+	MStatus status;
+	const float* driverPoints = fnDriver.getRawPoints(&status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	int driverVertexCount = fnDriver.numVertices(&status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	// The faces only change with the topology, which moving the driver leaves alone.
+	// Vertex, face and face-vertex counts catch adding and removing geometry without reading the faces.
+	// Only the normal context keeps its topology, the others can see another mesh.
+	int polygonCount = fnDriver.numPolygons();
+	int faceVertexCount = fnDriver.numFaceVertices();
+	uint64_t topologyKey = driverTopologyKey_;
+	std::shared_ptr<SharedDriverTopology> topology = driver_.topology;
+	if (!normalContext ||
+		!topology ||
+		driverVertexCount != driverVertexCount_ ||
+		polygonCount != driverPolygonCount_ ||
+		faceVertexCount != driverFaceVertexCount_) {
+		MIntArray polygonCounts, polygonVertices;
+		status = fnDriver.getVertices(polygonCounts, polygonVertices);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		std::vector<int> faces(polygonCounts.length() + polygonVertices.length());
+		polygonCounts.get(faces.data());
+		polygonVertices.get(faces.data() + polygonCounts.length());
+		topologyKey = HashBuffer(faces.data(), faces.size() * sizeof(int),
+								 HashBuffer(&driverVertexCount, sizeof(driverVertexCount)));
+		topology = GetSharedDriverTopologies().Acquire(topologyKey);
+		if (normalContext) {
+			driverTopologyKey_ = topologyKey;
+			driverVertexCount_ = driverVertexCount;
+			driverPolygonCount_ = polygonCount;
+			driverFaceVertexCount_ = faceVertexCount;
+		}
+	}
+	driver.topology = topology;
+
+	// Wrap nodes on the same driver find the points the first of them fetched.
+	// The key also keys the output cache.
+	double matrix[16];
+	GetMatrixBuffer(driverMatrix, matrix);
+	driver.key = HashBuffer(matrix, sizeof(matrix), topologyKey);
+	driver.key = HashBuffer(driverPoints, (size_t)driverVertexCount * 3 * sizeof(float), driver.key);
+	driver.points = GetSharedDriverPoints().Acquire(driver.key);
+	SharedDriverPoints& shared = *driver.points;
+	std::call_once(shared.pointsOnce, [&]() {
+		// Straight from the mesh, getPoints would fill an MPointArray first
+		GetPointBuffer(driverPoints, (unsigned int)driverVertexCount, driverMatrix, shared.points);
+	});
+	return MS::kSuccess;
+}
+
+MStatus Wrap::UpdateDriverData(const MObject& oDriverGeo, const MMatrix& driverMatrix, DriverNormals normals,
+							   bool normalContext, DriverEvaluation& driver) {
+	std::lock_guard<std::mutex> lock(driverMutex_);
+	MStatus status;
+	MFnMesh fnDriver(oDriverGeo, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+
+	if (!normalContext) {
+		// Dirtying only follows the normal context, a bake or background evaluation at another
+		// time fetches its own driver and leaves the kept one alone
+		status = FetchDriverData(fnDriver, driverMatrix, false, driver);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	} else {
+		if (driverDirty_) {
+			status = FetchDriverData(fnDriver, driverMatrix, true, driver_);
+			CHECK_MSTATUS_AND_RETURN_IT(status);
+			driverDirty_ = false;
+		}
+		driver = driver_;
+	}
+	SharedDriverPoints& shared = *driver.points;
+
+	if (normals == kMayaNormals) {
+		// Bindings made before the built-in normals have to keep deforming with Maya's
+		std::call_once(shared.normalsOnce, [&]() {
+			MFloatVectorArray driverNormals;
+			if (fnDriver.getVertexNormals(false, driverNormals) == MS::kSuccess) {
+				GetNormalBuffer(driverNormals, shared.mayaNormals);
+			}
+		});
+		return shared.mayaNormals.size() == shared.points.size() ? MS::kSuccess : MS::kFailure;
+	}
+
+	SharedDriverTopology& topology = *driver.topology;
+	std::call_once(topology.trianglesOnce, [&]() {
+		MIntArray triangleCounts, triangleVertices;
+		if (fnDriver.getTriangles(triangleCounts, triangleVertices) == MS::kSuccess) {
+			topology.triangles.resize(triangleVertices.length());
+			triangleVertices.get(topology.triangles.data());
+			topology.adjacency.Build(topology.triangles.data(), triangleVertices.length() / 3,
+									 (unsigned int)(shared.points.size() / 3));
+		}
+	});
+	return topology.adjacency.vertexCount() == shared.points.size() / 3 ? MS::kSuccess : MS::kFailure;
+}
+
+const float* Wrap::GetRawOutputPoints(MDataBlock& data, unsigned int geomIndex, unsigned int count, MObject& mesh) {
+	MStatus status;
+	MArrayDataHandle hOutput = data.outputArrayValue(outputGeom, &status);
+	if (status != MS::kSuccess || hOutput.jumpToElement(geomIndex) != MS::kSuccess) {
+		return nullptr;
+	}
+	MObject oOutput = hOutput.outputValue(&status).asMesh();
+	if (status != MS::kSuccess || oOutput.isNull()) {
+		return nullptr;
+	}
+	MFnMesh fnOutput(oOutput, &status);
+	// A deformer set of some of the vertices is iterated in its own order
+	if (status != MS::kSuccess || fnOutput.numVertices() != (int)count) {
+		return nullptr;
+	}
+	const float* points = fnOutput.getRawPoints(&status);
+	if (status != MS::kSuccess) {
+		return nullptr;
+	}
+	mesh = oOutput;
+	return points;
+}
+
+MStatus Wrap::SetDrivenPoints(DrivenPoints& driven, MItGeometry& itGeo) {
+	if (driven.raw == nullptr) {
+		return itGeo.setAllPositions(driven.points);
+	}
+	// setPoints marks the mesh points changed, the raw points are not read after this
+	MFnMesh fnOutput(driven.mesh);
+	return fnOutput.setPoints(*driven.meshPoints);
+}
+
+bool Wrap::IsBindAttribute(const MObject& attribute) {
+	return attribute == aBindData ||
+		attribute == aTriangleVerts ||
+		attribute == aBarycentricWeights ||
+		attribute == aBindMatrix ||
+		attribute == aBindOffset ||
+		attribute == aPackedBinding ||
+		attribute == aBindCacheFile;
+}
+
+MStatus Wrap::setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& affectedPlugs) {
+	// Binding only changes when the node is rebound or loaded, so invalidating
+	// every geometry is cheaper than resolving which bindData element changed.
+	if (IsBindAttribute(plugBeingDirtied.attribute())) {
+		SetBindDirty();
+	}
+	if (plugBeingDirtied == aDriverGeo) {
+		SetDriverDirty();
+	}
+	if (plugBeingDirtied == weightList || plugBeingDirtied == weights) {
+		SetWeightsDirty();
+	}
+	return MPxDeformerNode::setDependentsDirty(plugBeingDirtied, affectedPlugs);
+}
+
+MStatus Wrap::preEvaluation(const MDGContext& context, const MEvaluationNode& evaluationNode) {
+	// setDependentsDirty is not called under the evaluation manager
+	if (evaluationNode.dirtyPlugExists(aBindData) ||
+		evaluationNode.dirtyPlugExists(aTriangleVerts) ||
+		evaluationNode.dirtyPlugExists(aBarycentricWeights) ||
+		evaluationNode.dirtyPlugExists(aBindMatrix) ||
+		evaluationNode.dirtyPlugExists(aBindOffset) ||
+		evaluationNode.dirtyPlugExists(aPackedBinding) ||
+		evaluationNode.dirtyPlugExists(aBindCacheFile)) {
+		SetBindDirty();
+	}
+	if (evaluationNode.dirtyPlugExists(aDriverGeo)) {
+		SetDriverDirty();
+	}
+	if (evaluationNode.dirtyPlugExists(weightList) || evaluationNode.dirtyPlugExists(weights)) {
+		SetWeightsDirty();
+	}
+	return MPxDeformerNode::preEvaluation(context, evaluationNode);
+}
+
+template <typename Real>
+void Wrap::DeformGeometry(TaskData& taskData, const DriverEvaluation& driver, DeformPointBuffers<Real>& buffers, DrivenPoints& driven, unsigned int count,
+						  float env, const double* localToWorld, unsigned int grainSize, bool incrementalEnabled,
+						  WrapProfiler& profiler) {
+	const WrapBinding& binding = taskData.binding;
+	bool fullStrength = env == 1.0f && taskData.allWeightsOne;
+	bool needInput = binding.mode == kBindMatrix || !fullStrength;
+
+	// The mesh points are written as the chunks are deformed, the incremental deform only writes what it changed
+	MFloatPoint* meshPoints = nullptr;
+	bool meshPointsCurrent = false;
+	if (driven.raw != nullptr) {
+		meshPointsCurrent = taskData.meshPointsCurrent && driven.meshPoints->length() == count;
+		if (driven.meshPoints->length() != count) {
+			driven.meshPoints->setLength(count);
+		}
+		meshPoints = &(*driven.meshPoints)[0];
+	}
+	const unsigned int* order = binding.hasVertexOrder() ? binding.vertexOrder.data() : nullptr;
+
+	// The last output can only be updated in place if everything but the driver is unchanged
+	bool incremental = incrementalEnabled && taskData.hasPrevious && (meshPoints == nullptr || meshPointsCurrent) &&
+		buffers.points.size() == count * 3 &&
+		env == taskData.previousEnvelope &&
+		std::equal(localToWorld, localToWorld + 16, taskData.previousLocalToWorld);
+	if (needInput) {
+		// Every driven vertex reads its input position, so upstream deformation changes all of them
+		bool inputChanged = buffers.inputPoints.size() != count * 3;
+		buffers.inputPoints.resize(count * 3);
+		for (unsigned int i = 0; i < count; ++i) {
+			Real x, y, z;
+			if (driven.raw != nullptr) {
+				const float* point = driven.raw + binding.vertexId(i) * 3;
+				x = (Real)point[0], y = (Real)point[1], z = (Real)point[2];
+			} else {
+				const MPoint& point = driven.points[binding.vertexId(i)];
+				x = (Real)point.x, y = (Real)point.y, z = (Real)point.z;
+			}
+			Real* input = &buffers.inputPoints[i * 3];
+			if (input[0] != x || input[1] != y || input[2] != z) {
+				input[0] = x;
+				input[1] = y;
+				input[2] = z;
+				inputChanged = true;
+			}
+		}
+		incremental = incremental && !inputChanged;
+	} else {
+		incremental = incremental && buffers.inputPoints.empty();
+		buffers.inputPoints.clear();
+	}
+
+	// Fetch every driver vertex in use once, however many driven vertices share it.
+	// Built-in normals are only computed for those vertices, never for the whole driver.
+	profiler.BeginPhase(kPhaseNormals);
+	bool computeNormals = binding.normals == kAreaWeightedNormals;
+	buffers.compactPoints.resize(binding.referencedVertexCount() * 3);
+	taskData.compactNormals.resize(binding.referencedVertexCount() * 3);
+	const std::vector<double>& driverPoints = driver.points->points;
+	ParallelFor(binding.referencedVertexCount(), grainSize, [&](unsigned int begin, unsigned int end) {
+		GatherReferencedVertices(binding, driverPoints.data(), computeNormals ? nullptr : driver.points->mayaNormals.data(),
+								 begin, end, buffers.compactPoints.data(), taskData.compactNormals.data());
+		if (computeNormals) {
+			ComputeVertexNormals(driver.topology->adjacency, driver.topology->triangles.data(), driverPoints.data(),
+								 binding.referencedVertices.data(), begin, end, taskData.compactNormals.data());
+		}
+	});
+
+	profiler.BeginPhase(kPhaseKernel);
+	if (incremental) {
+		// Past this many moved driver vertices, finding the affected driven vertices costs more than it saves
+		unsigned int maxChangedVertices = (unsigned int)(binding.referencedVertexCount() * kIncrementalMaxChangedFraction);
+		incremental = FindAffectedVertices(binding,
+										   buffers.previousCompactPoints.data(), taskData.previousCompactNormals.data(),
+										   buffers.compactPoints.data(), taskData.compactNormals.data(),
+										   maxChangedVertices, taskData.affected);
+	}
+
+	// Driven vertices to deform, the ones with no weight keep their input
+	std::vector<unsigned int>& deformed = incremental ? taskData.affected : taskData.activeVertices;
+	if (incremental && taskData.activeVertices.size() < count) {
+		const std::vector<float>& weights = taskData.weights;
+		deformed.erase(std::remove_if(deformed.begin(), deformed.end(), [&](unsigned int i) { return weights[i] == 0.0f; }),
+					   deformed.end());
+	}
+	if (WrapStatsRecord* record = profiler.record()) {
+		record->drivenVertices = (unsigned int)deformed.size();
+		record->skippedVertices = count - (unsigned int)deformed.size();
+		record->incremental = incremental;
+	}
+	if (incremental) {
+		// Only the affected vertices start again from their input, the rest keep the last output
+		if (binding.mode == kBindMatrix) {
+			for (unsigned int i : deformed) {
+				std::copy(&buffers.inputPoints[i * 3], &buffers.inputPoints[i * 3] + 3, &buffers.points[i * 3]);
+			}
+		}
+	} else if (needInput) {
+		buffers.points = buffers.inputPoints;
+	} else {
+		buffers.points.resize(count * 3);
+	}
+	// Each chunk is weighted and written to the mesh points while it is still in cache, so the
+	// kernel phase includes the mesh write-back and kPhaseWriteBack only times Maya points
+	if (!incremental && deformed.size() == count) {
+		// Every driven vertex only writes its own point, so the vertices can be split freely
+		ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+			DeformPointsCompact(binding, buffers.compactPoints.data(), taskData.compactNormals.data(),
+								localToWorld, begin, end, buffers.points.data());
+			if (!fullStrength) {
+				ApplyWeights(buffers.inputPoints.data(), taskData.weights.data(), env,
+							 &deformed[begin], end - begin, buffers.points.data());
+			}
+			if (meshPoints != nullptr) {
+				SetPointBuffer(buffers.points.data(), begin, end, order, meshPoints);
+			}
+		});
+	} else {
+		ParallelFor((unsigned int)deformed.size(), grainSize, [&](unsigned int begin, unsigned int end) {
+			DeformPointsCompactIndexed(binding, buffers.compactPoints.data(), taskData.compactNormals.data(),
+									   localToWorld, &deformed[begin], end - begin, buffers.points.data());
+			if (!fullStrength) {
+				ApplyWeights(buffers.inputPoints.data(), taskData.weights.data(), env,
+							 &deformed[begin], end - begin, buffers.points.data());
+			}
+			if (meshPoints != nullptr && incremental) {
+				SetPointBuffer(buffers.points.data(), &deformed[begin], end - begin, order, meshPoints);
+			}
+		});
+		if (meshPoints != nullptr && !incremental) {
+			// The vertices painted off keep their input
+			ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+				SetPointBuffer(buffers.points.data(), begin, end, order, meshPoints);
+			});
+		}
+	}
+
+	// Keep this evaluation to compare the next one against
+	taskData.hasPrevious = incrementalEnabled;
+	if (incrementalEnabled) {
+		std::swap(buffers.compactPoints, buffers.previousCompactPoints);
+		std::swap(taskData.compactNormals, taskData.previousCompactNormals);
+		std::copy(localToWorld, localToWorld + 16, taskData.previousLocalToWorld);
+		taskData.previousEnvelope = env;
+	}
+
+	profiler.BeginPhase(kPhaseWriteBack);
+	if (meshPoints == nullptr) {
+		SetPointBuffer(buffers.points, driven.points, order);
+	}
+}
+
 MStatus Wrap::deform(MDataBlock& data, MItGeometry& itGeo, const MMatrix& localToWorldMatrix, unsigned int geomIndex) {
 	MStatus status;
 
+	// Switched off, leave the input alone without touching the driver or the binding
+	float env = data.inputValue(envelope).asFloat();
+	if (env == 0.0f) {
+		return MS::kSuccess;
+	}
+	WrapProfiler profiler(IsWrapStatsEnabled() ? &stats_ : nullptr, kStatsDeform, (int)geomIndex);
+
 	// Get driver geometry
 	MDataHandle hDriverGeo = data.inputValue(aDriverGeo, &status);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
@@ -165,54 +734,174 @@ MStatus Wrap::deform(MDataBlock& data, MItGeometry& itGeo, const MMatrix& localT
 		// Without a driver mesh, can't do anything
 		return MS::kSuccess;
 	}
-	// Get the bind information
-	TaskData taskData;
-	status = GetBindInfo(data, geomIndex, taskData);
+	// Get the bind information, only decoded again when bindData changed
+	TaskData& taskData = GetTaskData(geomIndex);
+	Precision precision = (Precision)data.inputValue(aPrecision).asShort();
+	bool decoded = taskData.bindDirty;
+	if (taskData.bindDirty) {
+		profiler.BeginPhase(kPhaseDecode);
+		status = GetBindInfo(data, geomIndex, taskData);
+		if (status != MS::kSuccess) {
+			// No binding information yet
+			taskData.binding.clear();
+			return MS::kSuccess;
+		}
+		taskData.binding.UpdateReferencedVertices();
+		const std::vector<int>& referencedVertices = taskData.binding.referencedVertices;
+		taskData.driverVertexCount = referencedVertices.empty() ? 0 :
+			(unsigned int)*std::max_element(referencedVertices.begin(), referencedVertices.end()) + 1;
+		taskData.bindDirty = false;
+		taskData.hasPrevious = false;
+		taskData.outputCache.clear();
+		// Read again in the element order of the new binding
+		taskData.weightsDirty = true;
+	}
+	if (taskData.binding.size() == 0) {
+		return MS::kSuccess;
+	}
+	if (decoded || precision != taskData.precision) {
+		// Only the buffers of the current precision are kept, switching starts from the input again
+		taskData.binding.UpdateFloatBindMatrices(precision);
+		if (precision == kPrecisionFloat) {
+			taskData.doubleBuffers.clear();
+		} else {
+			taskData.floatBuffers.clear();
+		}
+		taskData.precision = precision;
+		taskData.hasPrevious = false;
+		taskData.outputCache.clear();
+	}
 
-	// Get the driver geo information
-	MFnMesh fnDriver(oDriverGeo, &status);
-	CHECK_MSTATUS_AND_RETURN_IT(status);
+	// Painted weights, only read again when the weight map changed
+	unsigned int count = itGeo.count();
+	if (WrapStatsRecord* record = profiler.record()) {
+		record->bindDataBytes = GetBindingByteSize(taskData.binding);
+		record->skippedVertices = count;
+	}
+	if (taskData.binding.hasVertexOrder() && count != taskData.binding.size()) {
+		// An ordered binding only fits the geometry it was made for, it needs to be rebound
+		taskData.hasPrevious = false;
+		return MS::kSuccess;
+	}
+	if (taskData.weightsDirty || taskData.weights.size() != count) {
+		profiler.BeginPhase(kPhaseInput);
+		GetComponentIds(itGeo, taskData.componentIds);
+		status = GetWeights(data, geomIndex, count, taskData);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		taskData.hasPrevious = false;
+		taskData.outputCache.clear();
+	}
+	if (taskData.activeVertices.empty()) {
+		// Painted off everywhere
+		return MS::kSuccess;
+	}
 
-	//Get the driver point positions and vertex normals
-	status = fnDriver.getPoints(taskData.driverPoints, MSpace::kWorld);
+	// Get the driver geo information, fetched by the first geometry index deformed after the driver changed,
+	// or shared by another wrap node that already fetched the same driver data
+	profiler.BeginPhase(kPhaseDriverFetch);
+	DriverEvaluation driver;
+	status = UpdateDriverData(oDriverGeo, hDriverGeo.geometryTransformMatrix(), taskData.binding.normals,
+							  data.context().isNormal(), driver);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
-	status = fnDriver.getVertexNormals(false, taskData.driverNormals);
-	CHECK_MSTATUS_AND_RETURN_IT(status);
-
-	// Can't get world space because I'm inside a deformer
-	// Can only get world space positions if you pass in a DAG path.
-	itGeo.allPositions(taskData.points);
-	
-	MMatrix matrix;
-	MMatrix drivenInverseMatrix = localToWorldMatrix.inverse();
+	if (driver.points->points.size() < taskData.driverVertexCount * 3) {
+		// The driver lost vertices since binding, it needs to be rebound
+		taskData.hasPrevious = false;
+		return MS::kSuccess;
+	}
 
-	// Create temporary information using data points
-	for (unsigned int i = 0; i < taskData.points.length(); ++i) {
-		MIntArray& triangleVertices = taskData.triangleVerts[i];
-		BaryCoords& baryCoords = taskData.baryCoords[i];
-		MMatrix& bindMatrix = taskData.bindMatrices[i];
+	// Weights below 1 blend towards the input, so the offset mode needs it too
+	const WrapBinding& binding = taskData.binding;
+	bool fullStrength = env == 1.0f && taskData.allWeightsOne;
+	bool needInput = binding.mode == kBindMatrix || !fullStrength;
 
-		// Three things needed to generate transform matrix
-		MPoint origin;
-		MVector up;
-		MVector normal;
+	if (count > binding.size()) {
+		// The binding does not cover the geometry, it needs to be rebound
+		taskData.hasPrevious = false;
+		return MS::kSuccess;
+	}
 
-		CalculateBasisComponents(baryCoords, triangleVertices,
-			taskData.driverPoints, taskData.driverNormals,
-			origin, up, normal);
+	// Can't get world space because I'm inside a deformer
+	// Can only get world space positions if you pass in a DAG path.
+	// A whole output mesh is read from its raw points, anything else goes through Maya points
+	profiler.BeginPhase(kPhaseInput);
+	DrivenPoints driven;
+	driven.raw = GetRawOutputPoints(data, geomIndex, count, driven.mesh);
+	if (driven.raw != nullptr) {
+		driven.meshPoints = &taskData.meshPoints;
+	} else {
+		if (needInput) {
+			itGeo.allPositions(driven.points);
+		} else {
+			// The offsets replace the input positions, only the count is needed
+			driven.points.setLength(count);
+		}
+	}
 
-		CreateMatrix(origin, normal, up, matrix);
-		
-		// deformed point
-		// multiplying bindMatrix * matrix gives you an offset from where it was bound, to where it currently is.
+	double localToWorld[16];
+	GetMatrixBuffer(localToWorldMatrix, localToWorld);
 
-		MPoint newPoint = (taskData.points[i] * localToWorldMatrix) * (bindMatrix * matrix) * drivenInverseMatrix;
-		taskData.points[i] = newPoint;
+	// An evaluation with the same driver, input, matrix and envelope as a kept one gets its output back.
+	// The outputs are kept as floats, which only hold what double precision writes to a mesh.
+	unsigned int cacheFrames = (unsigned int)std::max(0, data.inputValue(aOutputCacheFrames).asInt());
+	if (precision == kPrecisionDouble && driven.raw == nullptr) {
+		cacheFrames = 0;
+	}
+	taskData.outputCache.SetCapacity(cacheFrames);
+	uint64_t outputKey = 0;
+	if (cacheFrames > 0) {
+		outputKey = HashBuffer(localToWorld, sizeof(localToWorld), driver.key);
+		outputKey = HashBuffer(&precision, sizeof(precision), outputKey);
+		outputKey = HashBuffer(&env, sizeof(env), outputKey);
+		outputKey = HashBuffer(&count, sizeof(count), outputKey);
+		if (needInput && driven.raw != nullptr) {
+			outputKey = HashBuffer(driven.raw, (size_t)count * 3 * sizeof(float), outputKey);
+		} else if (needInput) {
+			std::vector<double> inputPoints;
+			GetPointBuffer(driven.points, inputPoints);
+			outputKey = HashBuffer(inputPoints.data(), inputPoints.size() * sizeof(double), outputKey);
+		}
+		if (const std::vector<float>* cached = taskData.outputCache.Find(outputKey)) {
+			profiler.BeginPhase(kPhaseWriteBack);
+			if (WrapStatsRecord* record = profiler.record()) {
+				record->skippedVertices = count;
+				record->cached = true;
+			}
+			// The kept buffers no longer hold the last output, the next deform starts again
+			taskData.hasPrevious = false;
+			const unsigned int* order = binding.hasVertexOrder() ? binding.vertexOrder.data() : nullptr;
+			if (driven.raw != nullptr) {
+				if (taskData.meshPoints.length() != count) {
+					taskData.meshPoints.setLength(count);
+				}
+				SetPointBuffer(cached->data(), 0u, count, order, &taskData.meshPoints[0]);
+			} else {
+				SetPointBuffer(*cached, driven.points, order);
+			}
+			taskData.meshPointsCurrent = driven.raw != nullptr;
+			return SetDrivenPoints(driven, itGeo);
+		}
 	}
 
-	status = itGeo.setAllPositions(taskData.points);
+	unsigned int grainSize = (unsigned int)data.inputValue(aGrainSize).asInt();
+	bool incrementalEnabled = data.inputValue(aIncremental).asBool();
+	if (precision == kPrecisionFloat) {
+		DeformGeometry(taskData, driver, taskData.floatBuffers, driven, count, env, localToWorld, grainSize, incrementalEnabled,
+					   profiler);
+	} else {
+		DeformGeometry(taskData, driver, taskData.doubleBuffers, driven, count, env, localToWorld, grainSize, incrementalEnabled,
+					   profiler);
+	}
+	taskData.meshPointsCurrent = driven.raw != nullptr;
+	// Kept in element order straight from the deform buffers
+	if (std::vector<float>* stored = taskData.outputCache.Insert(outputKey)) {
+		if (precision == kPrecisionFloat) {
+			StoreOutput(taskData.floatBuffers.points, *stored);
+		} else {
+			StoreOutput(taskData.doubleBuffers.points, *stored);
+		}
+	}
+	status = SetDrivenPoints(driven, itGeo);
 	CHECK_MSTATUS_AND_RETURN_IT(status);
 
-
 	return MS::kSuccess;
-}
\ No newline at end of file
+}
@@ -1,20 +1,107 @@
 #ifndef WRAPDEFORMER_H
 #define WRAPDEFORMER_H
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <maya/MPxDeformerNode.h>
-#include <maya/MPointArray.h>
-#include <maya/MMatrixArray.h>
-#include <maya/MFloatVectorArray.h>
+#include <maya/MDGContext.h>
+#include <maya/MEvaluationNode.h>
+#include <maya/MFnMesh.h>
+#include <maya/MPlugArray.h>
 #include "common.h"
+#include "core/outputCache.h"
+#include "core/vertexNormals.h"
+#include "core/wrapStats.h"
+
+class WrapProfiler;
+
+/**
+ * Points of one geometry in the precision it is deformed in
+ */
+template <typename Real>
+struct DeformPointBuffers {
+	std::vector<Real> points; /**< Output, 3 scalars per driven vertex */
+	std::vector<Real> inputPoints; /**< Input positions, 3 scalars per driven vertex. Empty when kBindOffset runs at full strength. */
+	std::vector<Real> compactPoints; /**< Driver points used by the binding, 3 scalars per compact vertex */
+	std::vector<Real> previousCompactPoints; /**< compactPoints of the last evaluation */
+
+	/**
+	 * Releases the memory of every buffer
+	 */
+	void clear() {
+		std::vector<Real>().swap(points);
+		std::vector<Real>().swap(inputPoints);
+		std::vector<Real>().swap(compactPoints);
+		std::vector<Real>().swap(previousCompactPoints);
+	}
+};
+
+/**
+ * Positions of one driven geometry. A whole output mesh is read from its raw points
+ * and written with MFnMesh::setPoints, anything else goes through Maya points.
+ */
+struct DrivenPoints {
+	const float* raw = nullptr; /**< Input positions from the output mesh raw points, 3 floats per vertex */
+	MObject mesh; /**< Output mesh, when raw is set */
+	MFloatPointArray* meshPoints = nullptr; /**< Output positions for the mesh, the ones kept in TaskData, when raw is set */
+	MPointArray points; /**< Input positions, then the output, when raw is null */
+};
+
+/**
+ * World space driver points of one evaluation, shared by every wrap node that
+ * sees the same raw driver points, matrix and topology
+ */
+struct SharedDriverPoints {
+	std::once_flag pointsOnce; /**< Guards filling in points */
+	std::vector<double> points; /**< World space driver points, 3 doubles per vertex */
+	std::once_flag normalsOnce; /**< Guards filling in mayaNormals */
+	std::vector<float> mayaNormals; /**< Maya driver vertex normals, 3 floats per vertex, only fetched for kMayaNormals bindings */
+};
+
+/**
+ * Triangles of a driver, shared by every wrap node on a driver with the same faces
+ */
+struct SharedDriverTopology {
+	std::once_flag trianglesOnce; /**< Guards filling in triangles and adjacency */
+	std::vector<int> triangles; /**< getTriangles vertex ids of the driver, 3 per triangle */
+	VertexTriangles adjacency; /**< Triangles around each driver vertex */
+};
+
+/**
+ * The driver data an evaluation deforms from. Holding it keeps the shared data alive.
+ */
+struct DriverEvaluation {
+	std::shared_ptr<SharedDriverPoints> points; /**< Driver points of the evaluation */
+	std::shared_ptr<SharedDriverTopology> topology; /**< Driver faces, filled in for kAreaWeightedNormals bindings */
+	uint64_t key = 0; /**< HashBuffer of the raw driver points, matrix and topology that points is shared by */
+};
 
 struct TaskData {
-	MPointArray driverPoints;
-	MPointArray points;
-	MMatrixArray bindMatrices;
-	MFloatVectorArray driverNormals;
-	std::vector<MIntArray> triangleVerts;
-	std::vector<BaryCoords> baryCoords;
+	Precision precision = kPrecisionDouble; /**< Precision of the last evaluation, only its buffers are filled */
+	DeformPointBuffers<double> doubleBuffers; /**< Points of kPrecisionDouble evaluations */
+	DeformPointBuffers<float> floatBuffers; /**< Points of kPrecisionFloat evaluations */
+	std::vector<float> compactNormals; /**< Driver normals used by the binding, 3 floats per compact vertex */
+	WrapBinding binding; /**< Decoded bindData, kept between evaluations */
+	bool bindDirty = true; /**< The binding needs to be decoded from bindData again */
+	unsigned int driverVertexCount = 0; /**< Driver vertices the binding needs */
+	std::vector<float> weights; /**< Painted weight per driven vertex */
+	std::vector<int> componentIds; /**< Component id of each iterated vertex, empty when they are 0 to count - 1 */
+	std::vector<unsigned int> activeVertices; /**< Driven vertices with a non-zero weight, the only ones deformed */
+	bool allWeightsOne = true; /**< Every weight is 1, so nothing is blended */
+	bool weightsDirty = true; /**< The weights need to be read again */
+
+	// Last evaluation, for incremental deforms
+	std::vector<float> previousCompactNormals; /**< compactNormals of the last evaluation */
+	double previousLocalToWorld[16]; /**< Driven local to world matrix of the last evaluation */
+	float previousEnvelope = 1.0f; /**< Envelope of the last evaluation */
+	std::vector<unsigned int> affected; /**< Driven vertices re-evaluated by an incremental deform */
+	bool hasPrevious = false; /**< The points and previous buffers hold a complete evaluation */
+
+	OutputCache outputCache; /**< Last outputs by a hash of the driver, input, matrix and envelope */
+	MFloatPointArray meshPoints; /**< Output mesh points handed to MFnMesh::setPoints, kept so only changes are written */
+	bool meshPointsCurrent = false; /**< meshPoints holds the output of the last evaluation */
 };
 
 class Wrap : public MPxDeformerNode {
@@ -26,21 +113,125 @@ public:
 		MItGeometry& iter,
 		const MMatrix& mat,
 		unsigned int mIndex);
+	virtual MStatus setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& affectedPlugs);
+	virtual MStatus preEvaluation(const MDGContext& context, const MEvaluationNode& evaluationNode);
 	
 	static void* creator();
 	static MStatus initialize();
 
+	/**
+	 * @return The history of evaluations and binds collected for awWrapStats
+	 */
+	WrapStatsBuffer& stats() { return stats_; }
+
+	/**
+	 * Reads the binding and painted weights of one geometry outside of an
+	 * evaluation, for awWrapBake. The cached evaluation data is left alone.
+	 * @param[in] geomIndex Driven geometry
+	 * @param[out] taskData Binding with its referenced vertices, and the weights in its element order
+	 */
+	MStatus GetBakeData(unsigned int geomIndex, TaskData& taskData);
+
 	const static char* kName;
 	static MTypeId id;
 
 	static MObject aDriverGeo; // Drives wrap deformer
+	static MObject aGrainSize; // Driven vertices per parallel task
+	static MObject aIncremental; // Only re-evaluate driven vertices whose driver vertices moved
+	static MObject aPrecision; // Scalar type of the deform, double or float
+	static MObject aOutputCacheFrames; // Outputs kept per geometry to reuse when the inputs repeat
 	static MObject aBindData; // per-input geo
-	static MObject aSampleComponents; // Vertex IDs of verts when crawling out from surface
-	static MObject aSampleWeights; // For each of sample components
+	static MObject aSampleComponents; // Unused, multi-sample bindings keep their samples in packedBinding
+	static MObject aSampleWeights; // Unused, multi-sample bindings keep their samples in packedBinding
 	static MObject aTriangleVerts; // Store the closest point
 	static MObject aBarycentricWeights; // For each of the triangle verts
 	static MObject aBindMatrix; // Per vertex
+	static MObject aBindOffset; // Per vertex, replaces bindMatrix in offset bind mode
+	static MObject aPackedBinding; // Whole binding as one WrapBindData, replaces the per vertex attributes
+	static MObject aBindCacheFile; // External bind cache file, mapped instead of packedBinding when set
+
+private:
+	/**
+	 * Get the cached per-geometry data, creating it on first use
+	 */
+	TaskData& GetTaskData(unsigned int geomIndex);
+	/**
+	 * Flag every cached binding to be decoded again on the next deform
+	 */
+	void SetBindDirty();
+	/**
+	 * Flag every cached weight map to be read again on the next deform
+	 */
+	void SetWeightsDirty();
+	/**
+	 * Fetches the driver points if the driver changed since the last fetch, so
+	 * every geometry index of an evaluation shares one fetch, along with what
+	 * the binding needs for its normals. Other wrap nodes that already fetched
+	 * the same driver data at the same time share theirs instead.
+	 * @param[in] oDriverGeo Driver mesh
+	 * @param[in] driverMatrix Transform of the driver geometry data into world space
+	 * @param[in] normals kMayaNormals fills in the Maya normals, kAreaWeightedNormals the triangles
+	 * @param[in] normalContext The evaluation is in the normal context, the only one the last fetch is kept for
+	 * @param[out] driver Driver data to deform from
+	 */
+	MStatus UpdateDriverData(const MObject& oDriverGeo, const MMatrix& driverMatrix, DriverNormals normals,
+							 bool normalContext, DriverEvaluation& driver);
+	/**
+	 * Reads the driver points and finds the topology they share with other wrap nodes
+	 * @param[in] normalContext Keep the topology counts for the next fetch
+	 * @param[out] driver Driver points, topology and key
+	 */
+	MStatus FetchDriverData(MFnMesh& fnDriver, const MMatrix& driverMatrix, bool normalContext, DriverEvaluation& driver);
+	/**
+	 * Finds the raw points of the output mesh of a geometry index. MPxDeformerNode
+	 * copies the input geometry into the output before deform, so they hold the input positions.
+	 * They are only read, the output is written with MFnMesh::setPoints.
+	 * @param[in] count Vertices iterated by deform
+	 * @param[out] mesh Output mesh the points belong to
+	 * @return null if the output is not a mesh or only some of its vertices are deformed
+	 */
+	const float* GetRawOutputPoints(MDataBlock& data, unsigned int geomIndex, unsigned int count, MObject& mesh);
+	/**
+	 * Hands the deformed positions to Maya, through the output mesh or the geometry iterator
+	 */
+	MStatus SetDrivenPoints(DrivenPoints& driven, MItGeometry& itGeo);
+	/**
+	 * Flag the driver data to be fetched again on the next deform
+	 */
+	void SetDriverDirty();
+	/**
+	 * Deforms the active vertices of one geometry in the precision of buffers
+	 * and copies the result into the driven points
+	 * @param[in,out] taskData Cached data of the geometry
+	 * @param[in] driver Driver data of the evaluation
+	 * @param[in,out] buffers Points of taskData in the precision of the evaluation
+	 * @param[in,out] driven Input positions, unread in kBindOffset mode at full strength. Set to the output.
+	 * @param[in] count Driven vertices
+	 * @param[in] env Envelope
+	 * @param[in] localToWorld Driven geometry local to world matrix, 16 doubles
+	 * @param[in] grainSize Vertices per parallel task
+	 * @param[in] incrementalEnabled The incremental attribute
+	 * @param[in,out] profiler Times the phases and counts the deformed vertices
+	 */
+	template <typename Real>
+	void DeformGeometry(TaskData& taskData, const DriverEvaluation& driver, DeformPointBuffers<Real>& buffers, DrivenPoints& driven, unsigned int count,
+						float env, const double* localToWorld, unsigned int grainSize, bool incrementalEnabled,
+						WrapProfiler& profiler);
+	/**
+	 * @return true if the attribute is bindData or one of its children
+	 */
+	static bool IsBindAttribute(const MObject& attribute);
 
+	std::map<unsigned int, TaskData> taskData_; // Per geometry index
+	std::mutex taskDataMutex_; // Guards insertion into taskData_
+	DriverEvaluation driver_; // Driver data of the last normal context fetch, shared with the other nodes on the same driver
+	bool driverDirty_; // The driver changed since driver_ was fetched
+	uint64_t driverTopologyKey_; // HashBuffer of the driver faces driver_.topology is shared by
+	int driverVertexCount_; // Topology driverTopologyKey_ was hashed from
+	int driverPolygonCount_; // Topology driverTopologyKey_ was hashed from
+	int driverFaceVertexCount_; // Topology driverTopologyKey_ was hashed from
+	std::mutex driverMutex_; // Guards the driver data
+	WrapStatsBuffer stats_; // Evaluation and bind records while awWrapStats collection is on
 };
 
 
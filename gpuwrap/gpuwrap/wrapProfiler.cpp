@@ -0,0 +1,41 @@
+#include "wrapProfiler.h"
+
+#include <maya/MProfiler.h>
+
+const char* WrapProfiler::kCategoryName = "awWrap";
+int WrapProfiler::category_ = -1;
+
+WrapProfiler::WrapProfiler(WrapStatsBuffer* buffer, WrapStatsKind kind, int geometryIndex)
+	: stats_(buffer, kind, geometryIndex), eventId_(-1) {}
+
+WrapProfiler::~WrapProfiler() {
+	EndPhase();
+}
+
+void WrapProfiler::BeginPhase(WrapPhase phase) {
+	EndPhase();
+	stats_.BeginPhase(phase);
+	// Only pay for an event while the profiler is recording the category
+	if (category_ >= 0 && MProfiler::isCategoryEnabled(category_)) {
+		eventId_ = MProfiler::eventBegin(category_, MProfiler::kColorE_L2, GetWrapPhaseName(phase));
+	}
+}
+
+void WrapProfiler::EndPhase() {
+	stats_.EndPhase();
+	if (eventId_ >= 0) {
+		MProfiler::eventEnd(eventId_);
+		eventId_ = -1;
+	}
+}
+
+void WrapProfiler::RegisterCategory() {
+	category_ = MProfiler::addCategory(kCategoryName, "Wrap deformer evaluation and bind phases");
+}
+
+void WrapProfiler::DeregisterCategory() {
+	if (category_ >= 0) {
+		MProfiler::removeCategory(kCategoryName);
+		category_ = -1;
+	}
+}
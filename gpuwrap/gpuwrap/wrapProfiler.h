@@ -0,0 +1,58 @@
+#ifndef WRAPPROFILER_H
+#define WRAPPROFILER_H
+
+#include "core/wrapStats.h"
+
+#include <maya/MStatus.h>
+
+/*
+	Times the phases of a wrap evaluation or bind. Each phase is an event of the
+	awWrap category of the Maya profiler and, while awWrapStats collection is
+	on, adds to a record pushed to the node history when the profiler goes out
+	of scope.
+*/
+
+class WrapProfiler {
+public:
+	/**
+	 * @param[in] buffer Node history to push to, null when collection is off
+	 * @param[in] kind What is being recorded
+	 * @param[in] geometryIndex Driven geometry of a deform, -1 for a bind
+	 */
+	WrapProfiler(WrapStatsBuffer* buffer, WrapStatsKind kind, int geometryIndex);
+	~WrapProfiler();
+
+	/**
+	 * @return The record to fill in the counters of, null when collection is off
+	 */
+	WrapStatsRecord* record() { return stats_.record(); }
+
+	/**
+	 * Ends the running phase and starts another
+	 */
+	void BeginPhase(WrapPhase phase);
+
+	/**
+	 * Ends the running phase, if any
+	 */
+	void EndPhase();
+
+	/**
+	 * Adds the awWrap profiler category, on plug-in load
+	 */
+	static void RegisterCategory();
+
+	/**
+	 * Removes the awWrap profiler category, on plug-in unload
+	 */
+	static void DeregisterCategory();
+
+	const static char* kCategoryName;
+
+private:
+	WrapStatsScope stats_;
+	int eventId_; // Running profiler event, -1 for none
+	static int category_; // -1 when not registered
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "wrapStatsCmd.h"
+#include "wrapDeformer.h"
+#include "core/wrapStats.h"
+
+#include <maya/MArgDatabase.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MGlobal.h>
+#include <maya/MSelectionList.h>
+#include <maya/MStringArray.h>
+
+const char* WrapStatsCmd::kName = "awWrapStats";
+const char* WrapStatsCmd::kEnableFlagShort = "-en";
+const char* WrapStatsCmd::kEnableFlagLong = "-enable";
+const char* WrapStatsCmd::kClearFlagShort = "-cl";
+const char* WrapStatsCmd::kClearFlagLong = "-clear";
+const char* WrapStatsCmd::kLastFlagShort = "-l";
+const char* WrapStatsCmd::kLastFlagLong = "-last";
+
+WrapStatsCmd::WrapStatsCmd() {}
+
+MSyntax WrapStatsCmd::newSyntax() {
+	MSyntax syntax;
+	// Collection is off by default, evaluations then skip the timers
+	syntax.addFlag(kEnableFlagShort, kEnableFlagLong, MSyntax::kBoolean);
+	syntax.addFlag(kClearFlagShort, kClearFlagLong);
+	// Only return the most recent records
+	syntax.addFlag(kLastFlagShort, kLastFlagLong, MSyntax::kLong);
+	syntax.enableQuery(true);
+	syntax.setObjectType(MSyntax::kSelectionList, 0);
+	syntax.useSelectionAsDefault(true);
+	return syntax;
+}
+
+void* WrapStatsCmd::creator() {
+	return new WrapStatsCmd;
+}
+
+bool WrapStatsCmd::isUndoable() const {
+	return false;
+}
+
+MStatus WrapStatsCmd::doIt(const MArgList& args) {
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	CHECK_MSTATUS_AND_RETURN_IT(status);
+	if (argData.isQuery()) {
+		if (!argData.isFlagSet(kEnableFlagShort)) {
+			MGlobal::displayError("Only -enable can be queried");
+			return MS::kInvalidParameter;
+		}
+		setResult(IsWrapStatsEnabled());
+		return MS::kSuccess;
+	}
+	if (argData.isFlagSet(kEnableFlagShort)) {
+		SetWrapStatsEnabled(argData.flagArgumentBool(kEnableFlagShort, 0, &status));
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+	}
+	unsigned int last = 0;
+	if (argData.isFlagSet(kLastFlagShort)) {
+		int value = argData.flagArgumentInt(kLastFlagShort, 0, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (value < 1) {
+			MGlobal::displayError("Last must be at least 1");
+			return MS::kInvalidParameter;
+		}
+		last = (unsigned int)value;
+	}
+	bool clear = argData.isFlagSet(kClearFlagShort);
+
+	MSelectionList selectionList;
+	argData.getObjects(selectionList);
+	MStringArray result;
+	for (unsigned int i = 0; i < selectionList.length(); ++i) {
+		MObject oNode;
+		status = selectionList.getDependNode(i, oNode);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		MFnDependencyNode fnNode(oNode, &status);
+		CHECK_MSTATUS_AND_RETURN_IT(status);
+		if (fnNode.typeId() != Wrap::id) {
+			continue;
+		}
+		Wrap* wrap = (Wrap*)fnNode.userNode();
+		if (clear) {
+			wrap->stats().Clear();
+			continue;
+		}
+		// Prefix every record with its node so several nodes can be queried at once
+		MString prefix = "{\"node\": \"" + fnNode.name() + "\", ";
+		for (const WrapStatsRecord& record : wrap->stats().Records(last)) {
+			std::string json = FormatWrapStats(record);
+			result.append(prefix + MString(json.c_str() + 1));
+		}
+	}
+	setResult(result);
+	return MS::kSuccess;
+}
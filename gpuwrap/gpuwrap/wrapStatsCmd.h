@@ -0,0 +1,35 @@
+#ifndef WRAPSTATSCMD_H
+#define WRAPSTATSCMD_H
+
+#include <maya/MArgList.h>
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+/*
+	The Wrap Stats Command turns timing collection of every wrap node on or off,
+	and returns or clears the evaluation and bind history of the given nodes.
+
+	awWrapStats -enable true;
+	awWrapStats -query -enable;
+	awWrapStats -last 10 awWrap1;  // One JSON object per record, oldest first
+	awWrapStats -clear awWrap1;
+*/
+
+class WrapStatsCmd : public MPxCommand {
+public:
+	WrapStatsCmd();
+	virtual MStatus		doIt(const MArgList&);
+	virtual bool		isUndoable() const;
+	static void*		creator();
+	static MSyntax		newSyntax();
+	const static char*	kName;
+
+	const static char*	kEnableFlagShort;
+	const static char*	kEnableFlagLong;
+	const static char*	kClearFlagShort;
+	const static char*	kClearFlagLong;
+	const static char*	kLastFlagShort;
+	const static char*	kLastFlagLong;
+};
+
+#endif
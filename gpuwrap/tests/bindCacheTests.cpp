@@ -0,0 +1,221 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/bindCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+const double kIdentity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+uint64_t HashOf(const TestMesh& driver, const std::vector<double>& points, BindMode mode,
+				const SampleSettings& settings = SampleSettings()) {
+	return HashBindInputs(driver.points.data(), driver.vertexCount(), driver.triangles.data(), driver.triangleCount(),
+						  points.data(), (unsigned int)points.size() / 3, mode, settings);
+}
+
+std::string ReadFile(const std::string& path) {
+	std::ifstream stream(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::string& bytes) {
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	stream.write(bytes.data(), bytes.size());
+}
+
+bool IsView(const WrapBinding& binding) {
+	return binding.triangleVerts.isView() && binding.coords.isView() &&
+		(binding.mode == kBindMatrix ? binding.bindMatrices.isView() : binding.offsets.isView()) &&
+		(!binding.hasSamples() || (binding.sampleOffsets.isView() && binding.sampleVertices.isView() &&
+								   binding.sampleWeights.isView())) &&
+		(!binding.hasVertexOrder() || binding.vertexOrder.isView());
+}
+
+}
+
+TEST(HashFollowsBindInputs) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> points = CreateDrivenPoints(200);
+	uint64_t key = HashOf(driver, points, kBindMatrix);
+	CHECK(key == HashOf(driver, points, kBindMatrix));
+	CHECK(key != HashOf(driver, points, kBindOffset));
+
+	std::vector<double> moved = points;
+	moved[100] += 1e-9;
+	CHECK(key != HashOf(driver, moved, kBindMatrix));
+
+	TestMesh flipped = driver;
+	std::swap(flipped.triangles[0], flipped.triangles[1]);
+	CHECK(key != HashOf(flipped, points, kBindMatrix));
+
+	// The influences only matter with a radius
+	SampleSettings settings;
+	settings.maxInfluences = 3;
+	CHECK(key == HashOf(driver, points, kBindMatrix, settings));
+	settings.radius = 1.0;
+	uint64_t sampledKey = HashOf(driver, points, kBindMatrix, settings);
+	CHECK(sampledKey != key);
+	settings.maxInfluences = 4;
+	CHECK(sampledKey != HashOf(driver, points, kBindMatrix, settings));
+
+	CHECK(GetBindCacheFileName(0x1234abcdull) == "000000001234abcd.awwc");
+}
+
+TEST(RoundTripViewsTheFile) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> points = CreateDrivenPoints(300);
+	SampleSettings settings;
+	settings.radius = 2.0;
+	for (BindMode mode : { kBindMatrix, kBindOffset }) {
+		for (bool sampled : { false, true }) {
+			WrapBinding binding = sampled ? SampleBind(driver, points, settings, mode) : ReferenceBind(driver, points, mode);
+			binding.normals = kAreaWeightedNormals;
+			std::string path = "bindCacheTests_roundTrip.awwc";
+			CHECK(WriteBindCache(path, 42, binding));
+			CHECK(ReadFile(path).size() % 64 == 0);
+
+			WrapBinding cached;
+			uint64_t key = 0;
+			CHECK(ReadBindCache(path, cached, &key));
+			CHECK(key == 42);
+			CHECK(SameBinding(binding, cached));
+			CHECK(IsView(cached));
+			const WrapBinding& view = cached;
+			CHECK((size_t)view.coords.data() % 64 == 0);
+
+			// Deforming reads the file in place
+			binding.UpdateReferencedVertices();
+			cached.UpdateReferencedVertices();
+			std::vector<double> expected = points, deformed = points;
+			DeformPointsScalar(binding, driver.points.data(), driver.normals.data(), kIdentity, 0, binding.size(), expected.data());
+			DeformPointsScalar(cached, driver.points.data(), driver.normals.data(), kIdentity, 0, cached.size(), deformed.data());
+			CHECK(expected == deformed);
+			CHECK(IsView(cached));
+			std::remove(path.c_str());
+		}
+	}
+}
+
+TEST(VertexOrderIsViewed) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> points = CreateDrivenPoints(300);
+	WrapBinding binding = ReferenceBind(driver, points, kBindOffset);
+	OrderBindingForLocality(points.data(), binding);
+	std::string path = "bindCacheTests_order.awwc";
+	CHECK(WriteBindCache(path, 5, binding));
+	WrapBinding cached;
+	CHECK(ReadBindCache(path, cached));
+	CHECK(SameBinding(binding, cached));
+	CHECK(IsView(cached));
+
+	// A driven vertex listed twice
+	std::string bytes = ReadFile(path);
+	size_t orderStart = bytes.size() - (binding.size() * 4 + 63) / 64 * 64;
+	bytes[orderStart] = bytes[orderStart + 4];
+	bytes[orderStart + 1] = bytes[orderStart + 5];
+	bytes[orderStart + 2] = bytes[orderStart + 6];
+	bytes[orderStart + 3] = bytes[orderStart + 7];
+	WriteFile(path, bytes);
+	WrapBinding corrupt;
+	CHECK(!ReadBindCache(path, corrupt));
+	std::remove(path.c_str());
+}
+
+TEST(WritingCopiesTheView) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(50);
+	WrapBinding binding = ReferenceBind(driver, points, kBindOffset);
+	std::string path = "bindCacheTests_write.awwc";
+	CHECK(WriteBindCache(path, 7, binding));
+
+	WrapBinding cached;
+	CHECK(ReadBindCache(path, cached));
+	// Copies share the mapping
+	WrapBinding copy = cached;
+	const WrapBinding& view = cached;
+	CHECK(static_cast<const WrapBinding&>(copy).offsets.data() == view.offsets.data());
+
+	copy.offsets[0] += 1.0f;
+	CHECK(!copy.offsets.isView());
+	CHECK(view.offsets.isView());
+	CHECK(view.offsets[0] == binding.offsets[0]);
+	CHECK(copy.offsets[0] == binding.offsets[0] + 1.0f);
+
+	WrapBinding reread;
+	CHECK(ReadBindCache(path, reread));
+	CHECK(SameBinding(binding, reread));
+	std::remove(path.c_str());
+}
+
+TEST(MappingOutlivesTheFile) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(50);
+	WrapBinding binding = ReferenceBind(driver, points);
+	std::string path = "bindCacheTests_remove.awwc";
+	CHECK(WriteBindCache(path, 7, binding));
+	WrapBinding cached;
+	CHECK(ReadBindCache(path, cached));
+	std::remove(path.c_str());
+	CHECK(SameBinding(binding, cached));
+	WrapBinding missing;
+	CHECK(!ReadBindCache(path, missing));
+}
+
+TEST(ReplacedFileIsMappedAgain) {
+	TestMesh driver = CreateGrid(4);
+	std::string path = "bindCacheTests_replace.awwc";
+	WrapBinding first = ReferenceBind(driver, CreateDrivenPoints(40));
+	CHECK(WriteBindCache(path, 1, first));
+	WrapBinding cachedFirst;
+	CHECK(ReadBindCache(path, cachedFirst));
+
+	WrapBinding second = ReferenceBind(driver, CreateDrivenPoints(60), kBindOffset);
+	CHECK(WriteBindCache(path, 2, second));
+	WrapBinding cachedSecond;
+	uint64_t key = 0;
+	CHECK(ReadBindCache(path, cachedSecond, &key));
+	CHECK(key == 2);
+	CHECK(SameBinding(second, cachedSecond));
+	// Bindings of the old file keep reading it
+	CHECK(SameBinding(first, cachedFirst));
+	std::remove(path.c_str());
+}
+
+TEST(RejectsCorruptFiles) {
+	TestMesh driver = CreateGrid(4);
+	SampleSettings settings;
+	settings.radius = 2.0;
+	WrapBinding binding = SampleBind(driver, CreateDrivenPoints(40), settings);
+	std::string path = "bindCacheTests_corrupt.awwc";
+	CHECK(WriteBindCache(path, 3, binding));
+	std::string bytes = ReadFile(path);
+	std::remove(path.c_str());
+
+	auto rejects = [&](const std::string& corrupt) {
+		std::string corruptPath = "bindCacheTests_corrupt" + std::to_string(corrupt.size()) + "_" +
+			std::to_string((unsigned char)corrupt[0]) + ".awwc";
+		WriteFile(corruptPath, corrupt);
+		WrapBinding decoded;
+		bool rejected = !ReadBindCache(corruptPath, decoded) && decoded.size() == 0;
+		std::remove(corruptPath.c_str());
+		return rejected;
+	};
+	CHECK(rejects(bytes.substr(0, bytes.size() - 64)));
+	CHECK(rejects(bytes.substr(0, 20)));
+	std::string wrongMagic = bytes;
+	wrongMagic[0] = 'X';
+	CHECK(rejects(wrongMagic));
+	std::string wrongVersion = bytes;
+	wrongVersion[4] = 99;
+	CHECK(rejects(wrongVersion));
+	// First triangle vertex of the first driven vertex made negative
+	std::string negativeVertex = bytes;
+	negativeVertex[64 + 3] = (char)0x80;
+	CHECK(rejects(negativeVertex));
+}
+
+RUN_TESTS()
@@ -0,0 +1,59 @@
+#include "testHarness.h"
+
+#include "core/outputCache.h"
+
+#include <cstring>
+#include <vector>
+
+TEST(HashMatchesXxh64) {
+	// Published XXH64 values, covering the short path
+	CHECK(HashBuffer("", 0) == 0xEF46DB3751D8E999ull);
+	CHECK(HashBuffer("abc", 3) == 0x44BC2CF5AD770999ull);
+	// And the four lane path
+	const char* alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	CHECK(HashBuffer(alphabet, std::strlen(alphabet)) == 0xFD5E2CE9520872DDull);
+	CHECK(HashBuffer(alphabet, std::strlen(alphabet), 12345) == 0x12F4FEEC891D9035ull);
+}
+
+TEST(HashSeesEveryByte) {
+	std::vector<float> points(3001);
+	for (size_t i = 0; i < points.size(); ++i) {
+		points[i] = (float)i * 0.25f;
+	}
+	uint64_t hash = HashBuffer(points.data(), points.size() * sizeof(float));
+	CHECK(hash == HashBuffer(points.data(), points.size() * sizeof(float)));
+	for (size_t i : { (size_t)0, (size_t)17, points.size() - 1 }) {
+		std::vector<float> moved = points;
+		moved[i] += 1e-3f;
+		CHECK(HashBuffer(moved.data(), moved.size() * sizeof(float)) != hash);
+	}
+	// The seed chains buffers, so the same bytes after different buffers differ
+	CHECK(HashBuffer(points.data(), 12, 1) != HashBuffer(points.data(), 12, 2));
+}
+
+TEST(CacheKeepsMostRecentlyUsed) {
+	OutputCache cache;
+	CHECK(cache.Insert(1) == nullptr);
+	cache.SetCapacity(2);
+	cache.Insert(1)->assign(3, 1.0f);
+	cache.Insert(2)->assign(3, 2.0f);
+	CHECK(cache.size() == 2);
+	// Using 1 again leaves 2 as the one to drop
+	const std::vector<float>* points = cache.Find(1);
+	CHECK(points != nullptr && (*points)[0] == 1.0f);
+	cache.Insert(3)->assign(3, 3.0f);
+	CHECK(cache.size() == 2);
+	CHECK(cache.Find(2) == nullptr);
+	CHECK(cache.Find(1) != nullptr);
+	points = cache.Find(3);
+	CHECK(points != nullptr && (*points)[0] == 3.0f);
+
+	cache.SetCapacity(1);
+	CHECK(cache.size() == 1);
+	CHECK(cache.Find(3) != nullptr);
+	cache.clear();
+	CHECK(cache.size() == 0);
+	CHECK(cache.Find(3) == nullptr);
+}
+
+RUN_TESTS()
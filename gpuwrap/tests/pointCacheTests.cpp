@@ -0,0 +1,140 @@
+#include "testHarness.h"
+
+#include "core/pointCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool FileExists(const std::string& path) {
+	return std::ifstream(path).good();
+}
+
+/**
+ * A point of a frame no other point or frame has
+ */
+float PointValue(unsigned int frame, unsigned int index) {
+	return (float)frame * 1000.0f + (float)index * 0.5f;
+}
+
+/**
+ * Writes frames through the writer, a chunk at a time
+ */
+bool WriteFrames(PointCacheWriter& writer, unsigned int frameCount) {
+	const PointCacheInfo& info = writer.info();
+	for (unsigned int first = 0; first < frameCount; first += info.chunkFrames) {
+		unsigned int chunkFrames = std::min(info.chunkFrames, frameCount - first);
+		float* points = writer.AcquireChunk();
+		for (unsigned int f = 0; f < chunkFrames; ++f) {
+			for (unsigned int i = 0; i < info.vertexCount * 3; ++i) {
+				points[f * info.vertexCount * 3 + i] = PointValue(first + f, i);
+			}
+		}
+		writer.SubmitChunk(chunkFrames);
+	}
+	return writer.Close();
+}
+
+}
+
+TEST(FramesRoundTripInChunks) {
+	std::string path = "pointCacheTests_roundTrip.awpc";
+	PointCacheInfo info;
+	info.vertexCount = 100;
+	info.chunkFrames = 3;
+	info.startFrame = 1001.0;
+	info.frameStep = 0.5;
+	PointCacheWriter writer;
+	CHECK(writer.Open(path, info));
+	// A short last chunk
+	CHECK(WriteFrames(writer, 7));
+	CHECK(!FileExists(path + ".tmp"));
+
+	PointCacheReader reader;
+	CHECK(reader.Open(path));
+	CHECK(reader.info().vertexCount == 100);
+	CHECK(reader.info().chunkFrames == 3);
+	CHECK(reader.info().frameCount == 7);
+	CHECK(reader.info().startFrame == 1001.0);
+	CHECK(reader.info().frameStep == 0.5);
+	bool same = true;
+	for (unsigned int f = 0; f < 7; ++f) {
+		const float* points = reader.frame(f);
+		for (unsigned int i = 0; i < 300; ++i) {
+			same = same && points[i] == PointValue(f, i);
+		}
+	}
+	CHECK(same);
+	std::remove(path.c_str());
+}
+
+TEST(UnclosedCachesAreRemoved) {
+	std::string path = "pointCacheTests_abandoned.awpc";
+	std::remove(path.c_str());
+	PointCacheInfo info;
+	info.vertexCount = 10;
+	info.chunkFrames = 2;
+	{
+		PointCacheWriter writer;
+		CHECK(writer.Open(path, info));
+		writer.AcquireChunk();
+		writer.SubmitChunk(2);
+	}
+	CHECK(!FileExists(path));
+	CHECK(!FileExists(path + ".tmp"));
+
+	PointCacheWriter writer;
+	CHECK(writer.Open(path, info));
+	writer.AcquireChunk();
+	writer.SubmitChunk(1);
+	writer.Abort();
+	CHECK(!FileExists(path));
+	CHECK(!FileExists(path + ".tmp"));
+	CHECK(!writer.Close());
+}
+
+TEST(DamagedCachesAreRejected) {
+	std::string path = "pointCacheTests_damaged.awpc";
+	PointCacheInfo info;
+	info.vertexCount = 20;
+	info.chunkFrames = 4;
+	PointCacheWriter writer;
+	CHECK(writer.Open(path, info));
+	CHECK(WriteFrames(writer, 5));
+
+	std::ifstream input(path, std::ios::binary);
+	std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	input.close();
+	CHECK(bytes.size() == 64 + 5 * 20 * 3 * sizeof(float));
+
+	auto readModified = [&](const std::string& modified) {
+		std::string damagedPath = "pointCacheTests_modified.awpc";
+		{
+			std::ofstream output(damagedPath, std::ios::binary | std::ios::trunc);
+			output.write(modified.data(), modified.size());
+		}
+		PointCacheReader reader;
+		bool read = reader.Open(damagedPath);
+		std::remove(damagedPath.c_str());
+		return read;
+	};
+	CHECK(readModified(bytes));
+	CHECK(!readModified(bytes.substr(0, bytes.size() - 4)));
+	std::string otherMagic = bytes;
+	otherMagic[3] = 'X';
+	CHECK(!readModified(otherMagic));
+	std::string otherVersion = bytes;
+	otherVersion[4] = 99;
+	CHECK(!readModified(otherVersion));
+	CHECK(!readModified(bytes.substr(0, 32)));
+
+	PointCacheReader reader;
+	CHECK(!reader.Open("pointCacheTests_missing.awpc"));
+	std::remove(path.c_str());
+}
+
+RUN_TESTS()
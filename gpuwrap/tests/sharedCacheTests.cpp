@@ -0,0 +1,75 @@
+#include "testHarness.h"
+
+#include "core/sharedCache.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct SharedValue {
+	std::once_flag once;
+	int value = 0;
+};
+
+}
+
+TEST(SameKeySharesOneValue) {
+	SharedCache<SharedValue> cache;
+	std::shared_ptr<SharedValue> a = cache.Acquire(1);
+	std::shared_ptr<SharedValue> b = cache.Acquire(1);
+	std::shared_ptr<SharedValue> c = cache.Acquire(2);
+	CHECK(a == b);
+	CHECK(a != c);
+	CHECK(cache.size() == 2);
+}
+
+TEST(ValuesGoAwayWithTheirUsers) {
+	SharedCache<SharedValue> cache;
+	std::shared_ptr<SharedValue> a = cache.Acquire(1);
+	a->value = 7;
+	std::shared_ptr<SharedValue> b = cache.Acquire(1);
+	a.reset();
+	CHECK(cache.size() == 1);
+	CHECK(cache.Acquire(1)->value == 7);
+	b.reset();
+	CHECK(cache.size() == 0);
+	// A freed value is not found again, the next user starts over
+	CHECK(cache.Acquire(1)->value == 0);
+
+	// Keys of freed values do not pile up
+	std::shared_ptr<SharedValue> kept = cache.Acquire(0);
+	for (uint64_t key = 100; key < 10100; ++key) {
+		cache.Acquire(key);
+	}
+	CHECK(cache.size() == 1);
+	CHECK(cache.Acquire(0) == kept);
+}
+
+TEST(ConcurrentUsersComputeOnce) {
+	SharedCache<SharedValue> cache;
+	std::atomic<int> computed(0);
+	std::vector<std::shared_ptr<SharedValue>> values(8);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < values.size(); ++i) {
+		threads.emplace_back([&, i]() {
+			values[i] = cache.Acquire(42);
+			std::call_once(values[i]->once, [&]() {
+				++computed;
+				values[i]->value = 3;
+			});
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	CHECK(computed == 1);
+	for (const std::shared_ptr<SharedValue>& value : values) {
+		CHECK(value == values[0]);
+		CHECK(value->value == 3);
+	}
+}
+
+RUN_TESTS()
@@ -0,0 +1,70 @@
+/*
+ * Minimal assertion helpers for the standalone core tests.
+ * Each test executable registers its tests with TEST and returns the number
+ * of failed checks from RUN_TESTS.
+ */
+
+#ifndef WRAP_TEST_HARNESS_H
+#define WRAP_TEST_HARNESS_H
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+struct TestCase {
+	const char* name;
+	void (*function)();
+};
+
+inline std::vector<TestCase>& RegisteredTests() {
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+inline int& FailureCount() {
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegistrar {
+	TestRegistrar(const char* name, void (*function)()) {
+		RegisteredTests().push_back({ name, function });
+	}
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++FailureCount(); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		double valueA = (double)(a); \
+		double valueB = (double)(b); \
+		if (!(std::fabs(valueA - valueB) <= (tolerance))) { \
+			std::printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", \
+				__FILE__, __LINE__, #a, #b, valueA, valueB); \
+			++FailureCount(); \
+		} \
+	} while (0)
+
+inline int RunTests() {
+	for (const TestCase& test : RegisteredTests()) {
+		int failuresBefore = FailureCount();
+		test.function();
+		std::printf("[%s] %s\n", FailureCount() == failuresBefore ? "  OK  " : " FAIL ", test.name);
+	}
+	return FailureCount() == 0 ? 0 : 1;
+}
+
+#define RUN_TESTS() int main() { return RunTests(); }
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ * Procedural meshes and reference helpers shared by the core tests.
+ */
+
+#ifndef WRAP_TEST_MESHES_H
+#define WRAP_TEST_MESHES_H
+
+#include "core/wrapKernel.h"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * A triangulated driver mesh as flat buffers
+ */
+struct TestMesh {
+	std::vector<double> points; /**< 3 doubles per vertex */
+	std::vector<float> normals; /**< 3 floats per vertex */
+	std::vector<int> triangles; /**< 3 vertex ids per triangle */
+
+	unsigned int vertexCount() const { return (unsigned int)points.size() / 3; }
+	unsigned int triangleCount() const { return (unsigned int)triangles.size() / 3; }
+};
+
+/**
+ * Area weighted vertex normals of a triangle mesh
+ */
+inline void ComputeNormals(TestMesh& mesh) {
+	std::vector<double> normals(mesh.points.size(), 0.0);
+	for (unsigned int t = 0; t < mesh.triangleCount(); ++t) {
+		const double* a = &mesh.points[mesh.triangles[t * 3] * 3];
+		const double* b = &mesh.points[mesh.triangles[t * 3 + 1] * 3];
+		const double* c = &mesh.points[mesh.triangles[t * 3 + 2] * 3];
+		double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		double n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+		for (int k = 0; k < 3; ++k) {
+			for (int axis = 0; axis < 3; ++axis) {
+				normals[mesh.triangles[t * 3 + k] * 3 + axis] += n[axis];
+			}
+		}
+	}
+	mesh.normals.resize(mesh.points.size());
+	for (unsigned int v = 0; v < mesh.vertexCount(); ++v) {
+		double* n = &normals[v * 3];
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int axis = 0; axis < 3; ++axis) {
+			mesh.normals[v * 3 + axis] = (float)(length > 0.0 ? n[axis] / length : 0.0);
+		}
+	}
+}
+
+/**
+ * A bumpy grid in the xz plane with resolution x resolution quads
+ */
+inline TestMesh CreateGrid(int resolution, double size = 10.0, double bump = 0.5) {
+	TestMesh mesh;
+	for (int row = 0; row <= resolution; ++row) {
+		for (int column = 0; column <= resolution; ++column) {
+			double x = size * column / resolution - size * 0.5;
+			double z = size * row / resolution - size * 0.5;
+			mesh.points.push_back(x);
+			mesh.points.push_back(bump * std::sin(x) * std::cos(z));
+			mesh.points.push_back(z);
+		}
+	}
+	for (int row = 0; row < resolution; ++row) {
+		for (int column = 0; column < resolution; ++column) {
+			int v0 = row * (resolution + 1) + column;
+			int v1 = v0 + 1;
+			int v2 = v0 + resolution + 1;
+			int v3 = v2 + 1;
+			int quad[6] = { v0, v2, v1, v1, v2, v3 };
+			mesh.triangles.insert(mesh.triangles.end(), quad, quad + 6);
+		}
+	}
+	ComputeNormals(mesh);
+	return mesh;
+}
+
+/**
+ * Driven points scattered above and below the grid
+ */
+inline std::vector<double> CreateDrivenPoints(unsigned int count, double size = 10.0) {
+	std::vector<double> points(count * 3);
+	unsigned int seed = 12345;
+	for (unsigned int i = 0; i < count * 3; ++i) {
+		seed = seed * 1664525u + 1013904223u;
+		double random = (seed >> 8) / double(1 << 24);
+		points[i] = (i % 3 == 1) ? random * 2.0 - 1.0 : (random - 0.5) * size * 0.9;
+	}
+	return points;
+}
+
+/**
+ * Rigidly transforms a mesh by a 16 double matrix
+ */
+inline void TransformMesh(TestMesh& mesh, const double* m) {
+	for (unsigned int v = 0; v < mesh.vertexCount(); ++v) {
+		double* p = &mesh.points[v * 3];
+		double x = p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12];
+		double y = p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13];
+		double z = p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14];
+		p[0] = x; p[1] = y; p[2] = z;
+	}
+	ComputeNormals(mesh);
+}
+
+/**
+ * Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+ */
+inline void ReferenceClosestPoint(const double* p, const double* a, const double* b, const double* c, double* out) {
+	double ab[3], ac[3], ap[3];
+	for (int i = 0; i < 3; ++i) { ab[i] = b[i] - a[i]; ac[i] = c[i] - a[i]; ap[i] = p[i] - a[i]; }
+	auto dot = [](const double* u, const double* v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+	double d1 = dot(ab, ap), d2 = dot(ac, ap);
+	if (d1 <= 0.0 && d2 <= 0.0) { for (int i = 0; i < 3; ++i) out[i] = a[i]; return; }
+	double bp[3];
+	for (int i = 0; i < 3; ++i) bp[i] = p[i] - b[i];
+	double d3 = dot(ab, bp), d4 = dot(ac, bp);
+	if (d3 >= 0.0 && d4 <= d3) { for (int i = 0; i < 3; ++i) out[i] = b[i]; return; }
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+		double v = d1 / (d1 - d3);
+		for (int i = 0; i < 3; ++i) out[i] = a[i] + v * ab[i];
+		return;
+	}
+	double cp[3];
+	for (int i = 0; i < 3; ++i) cp[i] = p[i] - c[i];
+	double d5 = dot(ab, cp), d6 = dot(ac, cp);
+	if (d6 >= 0.0 && d5 <= d6) { for (int i = 0; i < 3; ++i) out[i] = c[i]; return; }
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+		double w = d2 / (d2 - d6);
+		for (int i = 0; i < 3; ++i) out[i] = a[i] + w * ac[i];
+		return;
+	}
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+		double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for (int i = 0; i < 3; ++i) out[i] = b[i] + w * (c[i] - b[i]);
+		return;
+	}
+	double denom = 1.0 / (va + vb + vc);
+	double v = vb * denom, w = vc * denom;
+	for (int i = 0; i < 3; ++i) out[i] = a[i] + ab[i] * v + ac[i] * w;
+}
+
+/**
+ * Brute force closest triangle search
+ * @param[out] closest The closest point
+ * @return The closest triangle id
+ */
+inline int ReferenceClosestTriangle(const TestMesh& mesh, const double* p, double* closest) {
+	int best = -1;
+	double bestDistance = 0.0;
+	for (unsigned int t = 0; t < mesh.triangleCount(); ++t) {
+		double candidate[3];
+		ReferenceClosestPoint(p,
+			&mesh.points[mesh.triangles[t * 3] * 3],
+			&mesh.points[mesh.triangles[t * 3 + 1] * 3],
+			&mesh.points[mesh.triangles[t * 3 + 2] * 3],
+			candidate);
+		double d[3] = { candidate[0] - p[0], candidate[1] - p[1], candidate[2] - p[2] };
+		double distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (best < 0 || distance < bestDistance) {
+			best = (int)t;
+			bestDistance = distance;
+			closest[0] = candidate[0]; closest[1] = candidate[1]; closest[2] = candidate[2];
+		}
+	}
+	return best;
+}
+
+/**
+ * Binds points to the closest driver triangles with the brute force search
+ */
+inline WrapBinding ReferenceBind(const TestMesh& driver, const std::vector<double>& points, BindMode mode = kBindMatrix) {
+	WrapBinding binding;
+	binding.mode = mode;
+	unsigned int count = (unsigned int)points.size() / 3;
+	binding.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		double closest[3];
+		int triangle = ReferenceClosestTriangle(driver, &points[i * 3], closest);
+		BindVertex(&points[i * 3], closest, &driver.triangles[triangle * 3],
+				   driver.points.data(), driver.normals.data(), i, binding);
+	}
+	return binding;
+}
+
+/**
+ * Binds points with multi-sample BindPoints
+ */
+inline WrapBinding SampleBind(const TestMesh& driver, const std::vector<double>& points,
+							  const SampleSettings& settings, BindMode mode = kBindMatrix) {
+	TriangleBvh bvh;
+	bvh.Build(driver.points.data(), driver.triangles.data(), driver.triangleCount());
+	VertexTriangles adjacency;
+	adjacency.Build(driver.triangles.data(), driver.triangleCount(), driver.vertexCount());
+	WrapBinding binding;
+	binding.mode = mode;
+	BindPoints(bvh, adjacency, settings, points.data(), (unsigned int)points.size() / 3, driver.triangles.data(),
+			   driver.points.data(), driver.normals.data(), binding, 16);
+	return binding;
+}
+
+/**
+ * @return true if the stored parts of two bindings are equal
+ */
+inline bool SameBinding(const WrapBinding& a, const WrapBinding& b) {
+	if (a.mode != b.mode || a.normals != b.normals || a.size() != b.size() || a.triangleVerts != b.triangleVerts ||
+		a.bindMatrices != b.bindMatrices || a.offsets != b.offsets ||
+		a.sampleOffsets != b.sampleOffsets || a.sampleVertices != b.sampleVertices ||
+		a.sampleWeights != b.sampleWeights || a.vertexOrder != b.vertexOrder) {
+		return false;
+	}
+	for (unsigned int i = 0; i < a.size(); ++i) {
+		for (int k = 0; k < 3; ++k) {
+			if (a.coords[i][k] != b.coords[i][k]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/threadPool.h"
+#include "core/wrapKernel.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+
+TEST(EveryItemVisitedOnce) {
+	ThreadPool pool(4);
+	std::vector<std::atomic<int>> visits(10007);
+	for (auto& visit : visits) {
+		visit = 0;
+	}
+	pool.ParallelFor((unsigned int)visits.size(), 64, [&](unsigned int begin, unsigned int end) {
+		CHECK(end - begin <= 64);
+		for (unsigned int i = begin; i < end; ++i) {
+			++visits[i];
+		}
+	});
+	for (auto& visit : visits) {
+		CHECK(visit == 1);
+	}
+}
+
+TEST(NestedLoopsRunSerially) {
+	ThreadPool pool(3);
+	std::atomic<unsigned int> total(0);
+	pool.ParallelFor(16, 1, [&](unsigned int, unsigned int) {
+		pool.ParallelFor(100, 10, [&](unsigned int begin, unsigned int end) {
+			total += end - begin;
+		});
+	});
+	CHECK(total == 1600);
+}
+
+TEST(ConcurrentCallers) {
+	ThreadPool pool(4);
+	std::atomic<unsigned int> total(0);
+	std::vector<std::thread> callers;
+	for (int i = 0; i < 4; ++i) {
+		callers.emplace_back([&] {
+			for (int repeat = 0; repeat < 50; ++repeat) {
+				pool.ParallelFor(1000, 7, [&](unsigned int begin, unsigned int end) {
+					total += end - begin;
+				});
+			}
+		});
+	}
+	for (std::thread& caller : callers) {
+		caller.join();
+	}
+	CHECK(total == 4 * 50 * 1000);
+}
+
+TEST(ThreadLimitCapsThreadsPerLoop) {
+	ThreadPool pool(4);
+	CHECK(pool.threadLimit() == 4);
+	pool.SetThreadLimit(2);
+	CHECK(pool.threadLimit() == 2);
+	std::mutex idsMutex;
+	std::set<std::thread::id> ids;
+	std::atomic<unsigned int> total(0);
+	pool.ParallelFor(4000, 1, [&](unsigned int begin, unsigned int end) {
+		{
+			std::lock_guard<std::mutex> lock(idsMutex);
+			ids.insert(std::this_thread::get_id());
+		}
+		// Slow enough that idle workers would join if they were allowed
+		std::this_thread::sleep_for(std::chrono::microseconds(20));
+		total += end - begin;
+	});
+	CHECK(total == 4000);
+	CHECK(ids.size() <= 2);
+
+	pool.SetThreadLimit(1);
+	std::thread::id caller = std::this_thread::get_id();
+	bool sameThread = true;
+	pool.ParallelFor(1000, 1, [&](unsigned int, unsigned int) {
+		sameThread = sameThread && std::this_thread::get_id() == caller;
+	});
+	CHECK(sameThread);
+
+	pool.SetThreadLimit(16);
+	CHECK(pool.threadLimit() == 4);
+}
+
+TEST(SmallLoopsRunOnCallingThread) {
+	std::thread::id caller = std::this_thread::get_id();
+	bool sameThread = false;
+	ParallelFor(100, kDefaultGrainSize, [&](unsigned int begin, unsigned int end) {
+		sameThread = std::this_thread::get_id() == caller && begin == 0 && end == 100;
+	});
+	CHECK(sameThread);
+}
+
+TEST(ParallelDeformMatchesSerial) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(3000);
+	WrapBinding binding = ReferenceBind(driver, points);
+	double motion[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0.5, 1.0, -0.5, 1 };
+	TransformMesh(driver, motion);
+	const double identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+	std::vector<double> serial = points;
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), identity, 0, binding.size(), serial.data());
+
+	ThreadPool pool(4);
+	std::vector<double> parallel = points;
+	pool.ParallelFor(binding.size(), 100, [&](unsigned int begin, unsigned int end) {
+		DeformPoints(binding, driver.points.data(), driver.normals.data(), identity, begin, end, parallel.data());
+	});
+	// Chunks of 100 end partway through a SIMD batch, so the vertices before each chunk end
+	// take the scalar tail instead of the vector lanes and can round differently
+	for (size_t i = 0; i < serial.size(); ++i) {
+		CHECK_NEAR(parallel[i], serial[i], 1e-9);
+	}
+}
+
+RUN_TESTS()
@@ -0,0 +1,136 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/triangleBvh.h"
+#include "core/wrapKernel.h"
+
+namespace {
+
+double SquaredDistance(const double* a, const double* b) {
+	double d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+	return d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+}
+
+// Checks the tree against the brute force search for every point
+void CheckAgainstBruteForce(const TestMesh& mesh, const std::vector<double>& points) {
+	TriangleBvh bvh;
+	bvh.Build(mesh.points.data(), mesh.triangles.data(), mesh.triangleCount());
+	CHECK(bvh.triangleCount() == mesh.triangleCount());
+	for (size_t i = 0; i < points.size() / 3; ++i) {
+		const double* p = &points[i * 3];
+		double expected[3], closest[3];
+		int expectedTriangle = ReferenceClosestTriangle(mesh, p, expected);
+		int triangle = bvh.ClosestPoint(p, closest);
+		CHECK(triangle >= 0);
+		// Points on a shared edge are equally close to either triangle
+		CHECK_NEAR(SquaredDistance(p, closest), SquaredDistance(p, expected), 1e-12);
+		if (triangle != expectedTriangle) {
+			CHECK_NEAR(SquaredDistance(closest, expected), 0.0, 1e-12);
+		}
+	}
+}
+
+}
+
+TEST(EmptyTreeFindsNothing) {
+	TriangleBvh bvh;
+	double p[3] = { 0, 0, 0 }, closest[3];
+	CHECK(bvh.ClosestPoint(p, closest) == -1);
+	bvh.Build(nullptr, nullptr, 0);
+	CHECK(bvh.triangleCount() == 0);
+	CHECK(bvh.ClosestPoint(p, closest) == -1);
+}
+
+TEST(SingleTriangle) {
+	TestMesh mesh;
+	mesh.points = { 0, 0, 0,  1, 0, 0,  0, 0, 1 };
+	mesh.triangles = { 0, 1, 2 };
+	std::vector<double> points = { 0.25, 1, 0.25,  -1, 0, -1,  2, 0, 0,  1, 0, 1 };
+	CheckAgainstBruteForce(mesh, points);
+}
+
+TEST(MatchesBruteForceOnGrid) {
+	CheckAgainstBruteForce(CreateGrid(24), CreateDrivenPoints(3000));
+}
+
+TEST(MatchesBruteForceOutsideTheMesh) {
+	TestMesh mesh = CreateGrid(12);
+	double c = std::cos(0.7), s = std::sin(0.7);
+	double motion[16] = { c, s, 0, 0,  -s, c, 0, 0,  0, 0, 1, 0,  3, 1, -2, 1 };
+	TransformMesh(mesh, motion);
+	// Scattered well beyond the mesh bounds
+	CheckAgainstBruteForce(mesh, CreateDrivenPoints(1000, 40.0));
+}
+
+TEST(CoincidentTrianglesReturnLowestId) {
+	// Every triangle is a copy, so all centroids are equal and every query ties
+	TestMesh mesh;
+	mesh.points = { 0, 0, 0,  1, 0, 0,  0, 0, 1 };
+	for (int i = 0; i < 50; ++i) {
+		mesh.triangles.insert(mesh.triangles.end(), { 0, 1, 2 });
+	}
+	TriangleBvh bvh;
+	bvh.Build(mesh.points.data(), mesh.triangles.data(), mesh.triangleCount());
+	std::vector<double> points = CreateDrivenPoints(100, 2.0);
+	for (size_t i = 0; i < points.size() / 3; ++i) {
+		double closest[3];
+		CHECK(bvh.ClosestPoint(&points[i * 3], closest) == 0);
+	}
+}
+
+TEST(BatchedQueriesMatchSingleQueries) {
+	TestMesh mesh = CreateGrid(32);
+	TriangleBvh bvh;
+	bvh.Build(mesh.points.data(), mesh.triangles.data(), mesh.triangleCount());
+	std::vector<double> points = CreateDrivenPoints(5000);
+	unsigned int count = (unsigned int)points.size() / 3;
+	std::vector<int> triangles(count);
+	std::vector<double> closest(count * 3);
+	bvh.ClosestPoints(points.data(), count, triangles.data(), closest.data(), 64);
+	for (unsigned int i = 0; i < count; ++i) {
+		double expected[3];
+		CHECK(triangles[i] == bvh.ClosestPoint(&points[i * 3], expected));
+		CHECK(closest[i * 3] == expected[0]);
+		CHECK(closest[i * 3 + 1] == expected[1]);
+		CHECK(closest[i * 3 + 2] == expected[2]);
+	}
+}
+
+TEST(BindPointsMatchesReferenceBind) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(500);
+	unsigned int count = (unsigned int)points.size() / 3;
+	TriangleBvh bvh;
+	bvh.Build(driver.points.data(), driver.triangles.data(), driver.triangleCount());
+	for (int mode = kBindMatrix; mode <= kBindOffset; ++mode) {
+		WrapBinding expected = ReferenceBind(driver, points, (BindMode)mode);
+		WrapBinding binding;
+		binding.mode = (BindMode)mode;
+		BindPoints(bvh, points.data(), count, driver.triangles.data(),
+				   driver.points.data(), driver.normals.data(), binding, 32);
+		CHECK(binding.size() == count);
+
+		// Deforming with either binding must give the same points
+		std::vector<double> deformed = points, expectedDeformed = points;
+		double identity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+		TestMesh moved = driver;
+		double motion[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0.5, 2.0, -1.0, 1 };
+		TransformMesh(moved, motion);
+		DeformPointsScalar(binding, moved.points.data(), moved.normals.data(), identity, 0, count, deformed.data());
+		DeformPointsScalar(expected, moved.points.data(), moved.normals.data(), identity, 0, count, expectedDeformed.data());
+		for (size_t i = 0; i < deformed.size(); ++i) {
+			CHECK_NEAR(deformed[i], expectedDeformed[i], 1e-5);
+		}
+	}
+}
+
+TEST(BindPointsWithoutTrianglesClearsBinding) {
+	TriangleBvh bvh;
+	WrapBinding binding;
+	binding.resize(4);
+	std::vector<double> points = CreateDrivenPoints(4);
+	BindPoints(bvh, points.data(), 4, nullptr, nullptr, nullptr, binding);
+	CHECK(binding.size() == 0);
+}
+
+RUN_TESTS()
@@ -0,0 +1,76 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/threadPool.h"
+#include "core/vertexNormals.h"
+
+TEST(AdjacencyListsEveryCorner) {
+	TestMesh mesh = CreateGrid(5);
+	VertexTriangles adjacency;
+	adjacency.Build(mesh.triangles.data(), mesh.triangleCount(), mesh.vertexCount());
+	CHECK(adjacency.vertexCount() == mesh.vertexCount());
+	CHECK(adjacency.triangles.size() == mesh.triangles.size());
+	for (unsigned int v = 0; v < mesh.vertexCount(); ++v) {
+		for (unsigned int j = adjacency.offsets[v]; j < adjacency.offsets[v + 1]; ++j) {
+			const int* corners = &mesh.triangles[adjacency.triangles[j] * 3];
+			CHECK(corners[0] == (int)v || corners[1] == (int)v || corners[2] == (int)v);
+			if (j > adjacency.offsets[v]) {
+				CHECK(adjacency.triangles[j - 1] < adjacency.triangles[j]);
+			}
+		}
+	}
+}
+
+TEST(MatchesAreaWeightedReference) {
+	TestMesh mesh = CreateGrid(16);
+	double c = std::cos(0.4), s = std::sin(0.4);
+	double motion[16] = { c, s, 0, 0,  -s, c, 0, 0,  0, 0, 1, 0,  1, 2, 3, 1 };
+	TransformMesh(mesh, motion);
+
+	VertexTriangles adjacency;
+	adjacency.Build(mesh.triangles.data(), mesh.triangleCount(), mesh.vertexCount());
+	std::vector<float> normals(mesh.vertexCount() * 3);
+	ComputeVertexNormals(adjacency, mesh.triangles.data(), mesh.points.data(), nullptr,
+						 0, mesh.vertexCount(), normals.data());
+	for (size_t i = 0; i < normals.size(); ++i) {
+		CHECK_NEAR(normals[i], mesh.normals[i], 1e-6);
+	}
+}
+
+TEST(SubsetMatchesFullMeshExactly) {
+	TestMesh mesh = CreateGrid(20);
+	VertexTriangles adjacency;
+	adjacency.Build(mesh.triangles.data(), mesh.triangleCount(), mesh.vertexCount());
+	std::vector<float> all(mesh.vertexCount() * 3);
+	ComputeVertexNormals(adjacency, mesh.triangles.data(), mesh.points.data(), nullptr,
+						 0, mesh.vertexCount(), all.data());
+
+	std::vector<int> subset;
+	for (unsigned int v = 7; v < mesh.vertexCount(); v += 13) {
+		subset.push_back((int)v);
+	}
+	std::vector<float> normals(subset.size() * 3);
+	ParallelFor((unsigned int)subset.size(), 4, [&](unsigned int begin, unsigned int end) {
+		ComputeVertexNormals(adjacency, mesh.triangles.data(), mesh.points.data(), subset.data(),
+							 begin, end, normals.data());
+	});
+	for (size_t i = 0; i < subset.size(); ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			CHECK(normals[i * 3 + axis] == all[subset[i] * 3 + axis]);
+		}
+	}
+}
+
+TEST(UnusedVertexGetsZeroNormal) {
+	TestMesh mesh;
+	mesh.points = { 0, 0, 0,  1, 0, 0,  0, 0, 1,  5, 5, 5 };
+	mesh.triangles = { 0, 2, 1 };
+	VertexTriangles adjacency;
+	adjacency.Build(mesh.triangles.data(), mesh.triangleCount(), mesh.vertexCount());
+	std::vector<float> normals(12);
+	ComputeVertexNormals(adjacency, mesh.triangles.data(), mesh.points.data(), nullptr, 0, 4, normals.data());
+	CHECK_NEAR(normals[1], 1.0, 1e-7);
+	CHECK(normals[9] == 0.0f && normals[10] == 0.0f && normals[11] == 0.0f);
+}
+
+RUN_TESTS()
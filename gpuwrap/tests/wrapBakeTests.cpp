@@ -0,0 +1,148 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/wrapBake.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const double kIdentity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+/**
+ * The driver bent a little further every frame
+ */
+std::vector<TestMesh> CreateDriverFrames(const TestMesh& driver, unsigned int frameCount) {
+	std::vector<TestMesh> frames(frameCount, driver);
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		TestMesh& mesh = frames[f];
+		for (unsigned int v = 0; v < mesh.vertexCount(); ++v) {
+			double* p = &mesh.points[v * 3];
+			p[1] += 0.02 * f * p[0] * p[0];
+			p[2] += 0.1 * f;
+		}
+		ComputeNormals(mesh);
+	}
+	return frames;
+}
+
+/**
+ * One frame the way a single evaluation of the deformer does it
+ */
+std::vector<double> DeformReference(const WrapBinding& binding, const TestMesh& driver, const float* driverNormals,
+									const std::vector<double>& input, const std::vector<float>& weights,
+									float envelope) {
+	std::vector<double> elements(input.size());
+	GatherDrivenPoints(binding, input.data(), 0, binding.size(), elements.data());
+	std::vector<double> deformed = elements;
+	DeformPoints(binding, driver.points.data(), driverNormals, kIdentity, 0, binding.size(), deformed.data());
+	// Blending every vertex moves the ones painted off back to their input
+	std::vector<unsigned int> all(binding.size());
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		all[i] = i;
+	}
+	ApplyWeights(elements.data(), weights.data(), envelope, all.data(), binding.size(), deformed.data());
+	std::vector<double> points(input.size());
+	ScatterDrivenPoints(binding, deformed.data(), 0, binding.size(), points.data());
+	return points;
+}
+
+}
+
+TEST(DeformFramesMatchesSingleEvaluations) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(300);
+	VertexTriangles adjacency;
+	adjacency.Build(driver.triangles.data(), driver.triangleCount(), driver.vertexCount());
+	BakeTopology topology;
+	topology.triangleVertices = driver.triangles.data();
+	topology.adjacency = &adjacency;
+
+	const unsigned int frameCount = 6;
+	std::vector<TestMesh> drivers = CreateDriverFrames(driver, frameCount);
+	std::vector<std::vector<float>> areaNormals(frameCount);
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		areaNormals[f].resize(driver.points.size());
+		ComputeVertexNormals(adjacency, driver.triangles.data(), drivers[f].points.data(), nullptr,
+							 0, driver.vertexCount(), areaNormals[f].data());
+	}
+	std::vector<float> weights(points.size() / 3);
+	for (size_t i = 0; i < weights.size(); ++i) {
+		weights[i] = i % 7 == 0 ? 0.0f : (i % 3 == 0 ? 0.5f : 1.0f);
+	}
+
+	for (BindMode mode : { kBindMatrix, kBindOffset }) {
+		for (DriverNormals normals : { kMayaNormals, kAreaWeightedNormals }) {
+			for (bool ordered : { false, true }) {
+				WrapBinding binding = ReferenceBind(driver, points, mode);
+				binding.normals = normals;
+				if (ordered) {
+					OrderBindingForLocality(points.data(), binding);
+				}
+				binding.UpdateReferencedVertices();
+
+				std::vector<BakeFrame> frames(frameCount);
+				for (unsigned int f = 0; f < frameCount; ++f) {
+					frames[f].driverPoints = drivers[f].points.data();
+					frames[f].driverNormals = normals == kMayaNormals ? drivers[f].normals.data() : nullptr;
+					frames[f].drivenPoints = points.data();
+					std::copy(kIdentity, kIdentity + 16, frames[f].localToWorld);
+					// Switched off, half and full strength
+					frames[f].envelope = f == 1 ? 0.0f : (f == 2 ? 0.5f : 1.0f);
+				}
+				std::vector<float> baked(frameCount * points.size());
+				DeformFrames(binding, topology, weights.data(), frames.data(), frameCount, kPrecisionDouble, baked.data());
+
+				for (unsigned int f = 0; f < frameCount; ++f) {
+					const float* driverNormals = normals == kMayaNormals ? drivers[f].normals.data() : areaNormals[f].data();
+					std::vector<double> expected = DeformReference(binding, drivers[f], driverNormals, points, weights,
+																   frames[f].envelope);
+					const float* actual = &baked[f * points.size()];
+					double maxError = 0.0;
+					for (size_t k = 0; k < points.size(); ++k) {
+						maxError = std::max(maxError, std::abs(actual[k] - expected[k]));
+					}
+					// Rounded to the floats of the cache
+					CHECK_NEAR(maxError, 0.0, 1e-5);
+				}
+			}
+		}
+	}
+}
+
+TEST(DeformFramesWithoutInputOrWeights) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> points = CreateDrivenPoints(200);
+	WrapBinding binding = ReferenceBind(driver, points, kBindOffset);
+	binding.normals = kMayaNormals;
+	binding.UpdateReferencedVertices();
+	std::vector<TestMesh> drivers = CreateDriverFrames(driver, 3);
+	std::vector<BakeFrame> frames(3);
+	for (unsigned int f = 0; f < 3; ++f) {
+		frames[f].driverPoints = drivers[f].points.data();
+		frames[f].driverNormals = drivers[f].normals.data();
+		std::copy(kIdentity, kIdentity + 16, frames[f].localToWorld);
+	}
+	std::vector<float> doubleBaked(3 * points.size()), floatBaked(3 * points.size());
+	// kBindOffset at full strength replaces the input, so it may be left out
+	DeformFrames(binding, BakeTopology(), nullptr, frames.data(), 3, kPrecisionDouble, doubleBaked.data());
+	binding.UpdateFloatBindMatrices(kPrecisionFloat);
+	DeformFrames(binding, BakeTopology(), nullptr, frames.data(), 3, kPrecisionFloat, floatBaked.data());
+
+	std::vector<float> ones(binding.size(), 1.0f);
+	for (unsigned int f = 0; f < 3; ++f) {
+		std::vector<double> expected = DeformReference(binding, drivers[f], drivers[f].normals.data(), points, ones, 1.0f);
+		for (size_t k = 0; k < points.size(); ++k) {
+			CHECK_NEAR(doubleBaked[f * points.size() + k], expected[k], 1e-5);
+			CHECK_NEAR(floatBaked[f * points.size() + k], expected[k], 1e-3);
+		}
+	}
+	// Frame 0 is the bind pose
+	for (size_t k = 0; k < points.size(); ++k) {
+		CHECK_NEAR(doubleBaked[k], points[k], 1e-4);
+	}
+}
+
+RUN_TESTS()
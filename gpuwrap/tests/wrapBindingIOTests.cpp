@@ -0,0 +1,161 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/wrapBindingIO.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+std::string Pack(const WrapBinding& binding) {
+	std::ostringstream stream;
+	WriteBinding(binding, stream);
+	return stream.str();
+}
+
+bool Unpack(const std::string& bytes, WrapBinding& binding) {
+	std::istringstream stream(bytes);
+	return ReadBinding(stream, bytes.size(), binding);
+}
+
+}
+
+TEST(RoundTripsBothModes) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(25);
+	for (int mode = kBindMatrix; mode <= kBindOffset; ++mode) {
+		WrapBinding binding = ReferenceBind(driver, points, (BindMode)mode);
+		std::string bytes = Pack(binding);
+		CHECK(bytes.size() == GetBindingByteSize(binding));
+
+		WrapBinding decoded;
+		CHECK(Unpack(bytes, decoded));
+		CHECK(SameBinding(binding, decoded));
+	}
+}
+
+TEST(SamplesRoundTrip) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(25);
+	SampleSettings settings;
+	settings.radius = 3.0;
+	WrapBinding binding = SampleBind(driver, points, settings, kBindOffset);
+	CHECK(binding.hasSamples());
+	std::string bytes = Pack(binding);
+	CHECK(bytes.size() == GetBindingByteSize(binding));
+
+	WrapBinding decoded;
+	CHECK(Unpack(bytes, decoded));
+	CHECK(SameBinding(binding, decoded));
+
+	// Rows that do not cover the samples, the last offset is followed by the samples and the vertex order count
+	std::string corrupt = bytes;
+	size_t lastOffset = bytes.size() - 4 - binding.sampleVertices.size() * 8 - 4;
+	corrupt[lastOffset] = (char)(corrupt[lastOffset] + 1);
+	CHECK(!Unpack(corrupt, decoded));
+	CHECK(!Unpack(bytes.substr(0, bytes.size() - 4), decoded));
+}
+
+TEST(VertexOrderRoundTrips) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(25);
+	WrapBinding binding = ReferenceBind(driver, points);
+	OrderBindingForLocality(points.data(), binding);
+	std::string bytes = Pack(binding);
+	CHECK(bytes.size() == GetBindingByteSize(binding));
+
+	WrapBinding decoded;
+	CHECK(Unpack(bytes, decoded));
+	CHECK(SameBinding(binding, decoded));
+
+	// A driven vertex listed twice
+	std::string repeated = bytes;
+	std::copy(bytes.end() - 8, bytes.end() - 4, repeated.end() - 4);
+	CHECK(!Unpack(repeated, decoded));
+	CHECK(decoded.size() == 0);
+	CHECK(!Unpack(bytes.substr(0, bytes.size() - 4), decoded));
+
+	// Version 3 had no vertex order
+	WrapBinding unordered = ReferenceBind(driver, points);
+	std::string version3 = Pack(unordered);
+	version3[4] = 3;
+	version3.erase(version3.size() - 4);
+	CHECK(Unpack(version3, decoded));
+	CHECK(SameBinding(unordered, decoded));
+}
+
+TEST(OffsetModeIsSmallerThanMatrixMode) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(1000);
+	size_t matrixSize = GetBindingByteSize(ReferenceBind(driver, points, kBindMatrix));
+	size_t offsetSize = GetBindingByteSize(ReferenceBind(driver, points, kBindOffset));
+	CHECK(offsetSize * 4 < matrixSize);
+}
+
+TEST(EmptyBindingRoundTrips) {
+	WrapBinding binding;
+	WrapBinding decoded;
+	decoded.resize(3);
+	CHECK(Unpack(Pack(binding), decoded));
+	CHECK(decoded.size() == 0);
+}
+
+TEST(RejectsCorruptData) {
+	TestMesh driver = CreateGrid(2);
+	WrapBinding binding = ReferenceBind(driver, CreateDrivenPoints(10));
+	std::string bytes = Pack(binding);
+	WrapBinding decoded;
+
+	// Truncated
+	CHECK(!Unpack(bytes.substr(0, bytes.size() - 1), decoded));
+	CHECK(decoded.size() == 0);
+	// Bad magic
+	std::string badMagic = bytes;
+	badMagic[0] = 'X';
+	CHECK(!Unpack(badMagic, decoded));
+	// Newer version
+	std::string newer = bytes;
+	newer[4] = (char)(kBindingFormatVersion + 1);
+	CHECK(!Unpack(newer, decoded));
+	// Count larger than the data
+	std::string huge = bytes;
+	huge[16] = huge[17] = huge[18] = (char)0xff;
+	CHECK(!Unpack(huge, decoded));
+}
+
+TEST(ReadsVersion1AsMayaNormals) {
+	TestMesh driver = CreateGrid(3);
+	WrapBinding binding = ReferenceBind(driver, CreateDrivenPoints(10), kBindOffset);
+	// Version 1 had no driver normals field between the mode and the count
+	std::string bytes = Pack(binding);
+	bytes[4] = 1;
+	bytes.erase(12, 4);
+
+	WrapBinding decoded;
+	CHECK(Unpack(bytes, decoded));
+	CHECK(decoded.normals == kMayaNormals);
+	decoded.normals = binding.normals;
+	CHECK(SameBinding(binding, decoded));
+}
+
+TEST(Base64RoundTrips) {
+	std::string bytes;
+	for (int i = 0; i < 256; ++i) {
+		bytes += (char)i;
+	}
+	for (size_t length = 0; length < 8; ++length) {
+		std::string input = bytes.substr(100, length) + bytes;
+		std::string encoded = EncodeBase64(input.data(), input.size());
+		CHECK(encoded.size() % 4 == 0);
+		std::string decoded;
+		CHECK(DecodeBase64(encoded, decoded));
+		CHECK(decoded == input);
+	}
+	std::string decoded;
+	CHECK(DecodeBase64("TWFu", decoded) && decoded == "Man");
+	CHECK(!DecodeBase64("TW=u", decoded));
+	CHECK(!DecodeBase64("TWF", decoded));
+}
+
+RUN_TESTS()
@@ -0,0 +1,190 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/simd.h"
+#include "core/wrapKernel.h"
+
+#include <algorithm>
+
+namespace {
+
+struct SimdFixture {
+	TestMesh driver;
+	std::vector<double> points;
+	WrapBinding binding;
+	double localToWorld[16];
+};
+
+SimdFixture CreateFixture(unsigned int count, BindMode mode = kBindMatrix) {
+	SimdFixture fixture;
+	fixture.driver = CreateGrid(12);
+	fixture.points = CreateDrivenPoints(count);
+	fixture.binding = ReferenceBind(fixture.driver, fixture.points, mode);
+
+	// Bend the driver so every frame changes differently
+	for (unsigned int v = 0; v < fixture.driver.vertexCount(); ++v) {
+		double* p = &fixture.driver.points[v * 3];
+		p[1] += 0.3 * p[0] * p[0] / 25.0 + 0.1 * p[2];
+		p[0] += 0.05 * p[2];
+	}
+	ComputeNormals(fixture.driver);
+
+	double localToWorld[16] = { 0, 1.5, 0, 0,  -1.5, 0, 0, 0,  0, 0, 1.5, 0,  2, -1, 0.5, 1 };
+	std::copy(localToWorld, localToWorld + 16, fixture.localToWorld);
+	return fixture;
+}
+
+// Runs DeformPoints at the given level over [begin, end) and compares with the scalar kernel
+void CheckLevelMatchesScalar(SimdLevel level, const SimdFixture& fixture, unsigned int begin, unsigned int end) {
+	std::vector<double> expected = fixture.points;
+	DeformPointsScalar(fixture.binding, fixture.driver.points.data(), fixture.driver.normals.data(),
+					   fixture.localToWorld, begin, end, expected.data());
+
+	SimdLevel previous = GetSimdLevel();
+	SetSimdLevel(level);
+	std::vector<double> actual = fixture.points;
+	DeformPoints(fixture.binding, fixture.driver.points.data(), fixture.driver.normals.data(),
+				 fixture.localToWorld, begin, end, actual.data());
+	SetSimdLevel(previous);
+
+	for (size_t i = 0; i < expected.size(); ++i) {
+		CHECK_NEAR(actual[i], expected[i], 1e-9);
+	}
+}
+
+// CheckLevelMatchesScalar for float deforms, which also have to stay close to the double result
+void CheckFloatLevelMatchesScalar(SimdLevel level, const SimdFixture& fixture, unsigned int begin, unsigned int end) {
+	WrapBinding binding = fixture.binding;
+	binding.UpdateFloatBindMatrices(kPrecisionFloat);
+	std::vector<float> driverPoints(fixture.driver.points.begin(), fixture.driver.points.end());
+	std::vector<float> expected(fixture.points.begin(), fixture.points.end());
+	DeformPointsScalar(binding, driverPoints.data(), fixture.driver.normals.data(),
+					   fixture.localToWorld, begin, end, expected.data());
+	std::vector<double> reference = fixture.points;
+	DeformPointsScalar(binding, fixture.driver.points.data(), fixture.driver.normals.data(),
+					   fixture.localToWorld, begin, end, reference.data());
+
+	SimdLevel previous = GetSimdLevel();
+	SetSimdLevel(level);
+	std::vector<float> actual(fixture.points.begin(), fixture.points.end());
+	DeformPoints(binding, driverPoints.data(), fixture.driver.normals.data(),
+				 fixture.localToWorld, begin, end, actual.data());
+	SetSimdLevel(previous);
+
+	for (size_t i = 0; i < expected.size(); ++i) {
+		// Fused multiply-adds round differently than the scalar kernel
+		CHECK_NEAR(actual[i], expected[i], 1e-4);
+		CHECK_NEAR(actual[i], reference[i], 1e-3);
+	}
+}
+
+}
+
+TEST(EveryLevelMatchesScalar) {
+	SimdFixture fixture = CreateFixture(1000);
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		std::printf("  checking %s\n", GetSimdLevelName((SimdLevel)level));
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 0, fixture.binding.size());
+	}
+}
+
+TEST(PartialBlocksMatchScalar) {
+	SimdFixture fixture = CreateFixture(37);
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		for (unsigned int begin = 0; begin < 9; ++begin) {
+			for (unsigned int end = begin; end <= 37; end += 5) {
+				CheckLevelMatchesScalar((SimdLevel)level, fixture, begin, end);
+			}
+		}
+	}
+}
+
+TEST(OffsetModeMatchesScalar) {
+	SimdFixture fixture = CreateFixture(203, kBindOffset);
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 0, fixture.binding.size());
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 3, 100);
+	}
+}
+
+TEST(TiedWeightsPickTheSameCorner) {
+	SimdFixture fixture = CreateFixture(64);
+	// Ties between corners must resolve to the earlier corner like the scalar kernel
+	for (unsigned int i = 0; i < fixture.binding.size(); ++i) {
+		BaryCoords& coords = fixture.binding.coords[i];
+		switch (i % 4) {
+		case 0: coords[0] = coords[1] = 0.25f; coords[2] = 0.5f; break;
+		case 1: coords[1] = coords[2] = 0.25f; coords[0] = 0.5f; break;
+		case 2: coords[0] = coords[2] = 0.25f; coords[1] = 0.5f; break;
+		default: coords[0] = coords[1] = coords[2] = 1.0f / 3.0f; break;
+		}
+	}
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 0, fixture.binding.size());
+	}
+}
+
+TEST(SampledBindingMatchesScalar) {
+	SimdFixture fixture = CreateFixture(1);
+	fixture.points = CreateDrivenPoints(157);
+	SampleSettings settings;
+	settings.maxInfluences = 5;
+	settings.radius = 1.5;
+	// Bind to the flat grid so the fixture's bend moves every sample
+	fixture.binding = SampleBind(CreateGrid(12), fixture.points, settings);
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 0, fixture.binding.size());
+		CheckLevelMatchesScalar((SimdLevel)level, fixture, 5, 42);
+	}
+}
+
+TEST(FloatLevelsMatchScalar) {
+	SimdFixture fixture = CreateFixture(1000);
+	SimdFixture offsetFixture = CreateFixture(203, kBindOffset);
+	SimdFixture sampledFixture = CreateFixture(1);
+	sampledFixture.points = CreateDrivenPoints(157);
+	SampleSettings settings;
+	settings.maxInfluences = 5;
+	settings.radius = 1.5;
+	sampledFixture.binding = SampleBind(CreateGrid(12), sampledFixture.points, settings);
+	for (int level = kSimdScalar; level <= GetSupportedSimdLevel(); ++level) {
+		std::printf("  checking float %s\n", GetSimdLevelName((SimdLevel)level));
+		CheckFloatLevelMatchesScalar((SimdLevel)level, fixture, 0, fixture.binding.size());
+		CheckFloatLevelMatchesScalar((SimdLevel)level, offsetFixture, 3, 100);
+		CheckFloatLevelMatchesScalar((SimdLevel)level, sampledFixture, 5, 142);
+		// Partial blocks of up to 16 float lanes
+		for (unsigned int begin = 0; begin < 17; begin += 4) {
+			for (unsigned int end = begin; end <= 60; end += 7) {
+				CheckFloatLevelMatchesScalar((SimdLevel)level, fixture, begin, end);
+			}
+		}
+	}
+}
+
+TEST(FloatBindMatricesFollowPrecision) {
+	SimdFixture fixture = CreateFixture(20);
+	WrapBinding& binding = fixture.binding;
+	binding.UpdateFloatBindMatrices(kPrecisionFloat);
+	// Entry major, only the affine part
+	CHECK(binding.floatBindMatrices.size() == binding.size() * 12);
+	unsigned int row = 3, column = 1, i = 7;
+	CHECK(binding.floatBindMatrices[(row * 3 + column) * binding.size() + i] ==
+		  (float)binding.bindMatrices[i * 16 + row * 4 + column]);
+	binding.UpdateFloatBindMatrices(kPrecisionDouble);
+	CHECK(binding.floatBindMatrices.empty());
+
+	// Offset bindings have no matrices to convert
+	SimdFixture offsetFixture = CreateFixture(20, kBindOffset);
+	offsetFixture.binding.UpdateFloatBindMatrices(kPrecisionFloat);
+	CHECK(offsetFixture.binding.floatBindMatrices.empty());
+}
+
+TEST(SetSimdLevelClampsToSupported) {
+	SimdLevel previous = GetSimdLevel();
+	CHECK(SetSimdLevel(kSimdAvx512) == GetSupportedSimdLevel());
+	CHECK(SetSimdLevel(kSimdScalar) == kSimdScalar);
+	CHECK(GetSimdLevel() == kSimdScalar);
+	SetSimdLevel(previous);
+}
+
+RUN_TESTS()
@@ -0,0 +1,536 @@
+#include "testHarness.h"
+#include "testMeshes.h"
+
+#include "core/wrapKernel.h"
+
+#include <algorithm>
+
+namespace {
+
+const double kIdentity[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+
+}
+
+TEST(UnchangedDriverKeepsPoints) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(200);
+	WrapBinding binding = ReferenceBind(driver, points);
+
+	std::vector<double> deformed = points;
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), kIdentity, 0, binding.size(), deformed.data());
+	for (size_t i = 0; i < points.size(); ++i) {
+		CHECK_NEAR(deformed[i], points[i], 1e-5);
+	}
+}
+
+TEST(RigidDriverMotionMovesPointsRigidly) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(200);
+	WrapBinding binding = ReferenceBind(driver, points);
+
+	// Rotate 30 degrees around y and translate
+	double c = std::cos(0.5235987755982988), s = std::sin(0.5235987755982988);
+	double motion[16] = { c, 0, -s, 0,  0, 1, 0, 0,  s, 0, c, 0,  1.5, -2.0, 0.25, 1 };
+	TransformMesh(driver, motion);
+
+	std::vector<double> deformed = points;
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), kIdentity, 0, binding.size(), deformed.data());
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		double expected[3];
+		TransformPoint(&points[i * 3], motion, expected);
+		CHECK_NEAR(deformed[i * 3], expected[0], 1e-4);
+		CHECK_NEAR(deformed[i * 3 + 1], expected[1], 1e-4);
+		CHECK_NEAR(deformed[i * 3 + 2], expected[2], 1e-4);
+	}
+}
+
+TEST(LocalToWorldIsRoundTripped) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> worldPoints = CreateDrivenPoints(50);
+	WrapBinding binding = ReferenceBind(driver, worldPoints);
+
+	// Driven points live in a translated and scaled local space
+	double localToWorld[16] = { 2, 0, 0, 0,  0, 2, 0, 0,  0, 0, 2, 0,  1, 1, 1, 1 };
+	double worldToLocal[16];
+	InvertMatrix(localToWorld, worldToLocal);
+	std::vector<double> localPoints = worldPoints;
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		TransformPoint(&localPoints[i * 3], worldToLocal, &localPoints[i * 3]);
+	}
+
+	double translate[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 3, 0, 1 };
+	TransformMesh(driver, translate);
+	std::vector<double> deformed = localPoints;
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), localToWorld, 0, binding.size(), deformed.data());
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		// A 3 unit world translation is 1.5 units in local space
+		CHECK_NEAR(deformed[i * 3], localPoints[i * 3], 1e-5);
+		CHECK_NEAR(deformed[i * 3 + 1], localPoints[i * 3 + 1] + 1.5, 1e-5);
+		CHECK_NEAR(deformed[i * 3 + 2], localPoints[i * 3 + 2], 1e-5);
+	}
+}
+
+TEST(DeformRangeOnlyTouchesRange) {
+	TestMesh driver = CreateGrid(4);
+	std::vector<double> points = CreateDrivenPoints(20);
+	WrapBinding binding = ReferenceBind(driver, points);
+	double translate[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 1, 0, 1 };
+	TransformMesh(driver, translate);
+
+	std::vector<double> deformed = points;
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), kIdentity, 5, 10, deformed.data());
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		double expected = points[i * 3 + 1] + ((i >= 5 && i < 10) ? 1.0 : 0.0);
+		CHECK_NEAR(deformed[i * 3 + 1], expected, 1e-5);
+	}
+}
+
+TEST(OffsetModeMatchesMatrixModeAtBindPose) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(300);
+	WrapBinding matrixBinding = ReferenceBind(driver, points, kBindMatrix);
+	WrapBinding offsetBinding = ReferenceBind(driver, points, kBindOffset);
+	CHECK(offsetBinding.bindMatrices.empty());
+	CHECK(offsetBinding.offsets.size() == points.size());
+
+	double c = std::cos(0.3), s = std::sin(0.3);
+	double motion[16] = { 1, 0, 0, 0,  0, c, s, 0,  0, -s, c, 0,  0, 2, 0, 1 };
+	TransformMesh(driver, motion);
+	for (unsigned int v = 0; v < driver.vertexCount(); ++v) {
+		driver.points[v * 3 + 1] += 0.2 * std::sin(driver.points[v * 3]);
+	}
+	ComputeNormals(driver);
+
+	std::vector<double> expected = points;
+	DeformPointsScalar(matrixBinding, driver.points.data(), driver.normals.data(), kIdentity, 0, matrixBinding.size(), expected.data());
+	// Offset mode does not read the input positions
+	std::vector<double> actual(points.size(), 0.0);
+	DeformPointsScalar(offsetBinding, driver.points.data(), driver.normals.data(), kIdentity, 0, offsetBinding.size(), actual.data());
+	for (size_t i = 0; i < points.size(); ++i) {
+		// Offsets are single precision
+		CHECK_NEAR(actual[i], expected[i], 1e-5);
+	}
+}
+
+TEST(OffsetModeHonoursLocalToWorld) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> worldPoints = CreateDrivenPoints(50);
+	WrapBinding binding = ReferenceBind(driver, worldPoints, kBindOffset);
+
+	double localToWorld[16] = { 2, 0, 0, 0,  0, 2, 0, 0,  0, 0, 2, 0,  1, 1, 1, 1 };
+	double translate[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 3, 0, 1 };
+	TransformMesh(driver, translate);
+	std::vector<double> deformed(worldPoints.size());
+	DeformPoints(binding, driver.points.data(), driver.normals.data(), localToWorld, 0, binding.size(), deformed.data());
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		// Local = (world + 3y - 1) / 2
+		CHECK_NEAR(deformed[i * 3], (worldPoints[i * 3] - 1.0) * 0.5, 1e-5);
+		CHECK_NEAR(deformed[i * 3 + 1], (worldPoints[i * 3 + 1] + 2.0) * 0.5, 1e-5);
+		CHECK_NEAR(deformed[i * 3 + 2], (worldPoints[i * 3 + 2] - 1.0) * 0.5, 1e-5);
+	}
+}
+
+TEST(ReferencedVerticesAreCompact) {
+	TestMesh driver = CreateGrid(20);
+	std::vector<double> points = CreateDrivenPoints(300);
+	WrapBinding binding = ReferenceBind(driver, points);
+	binding.UpdateReferencedVertices();
+
+	CHECK(binding.referencedVertexCount() > 0);
+	CHECK(binding.referencedVertexCount() < driver.vertexCount());
+	std::vector<int> uses(binding.referencedVertexCount(), 0);
+	for (size_t i = 0; i < binding.triangleVerts.size(); ++i) {
+		int compactId = binding.compactTriangleVerts[i];
+		CHECK(binding.referencedVertices[compactId] == binding.triangleVerts[i]);
+		++uses[compactId];
+	}
+	// Every compact vertex is used and appears once
+	std::vector<int> sorted = binding.referencedVertices;
+	std::sort(sorted.begin(), sorted.end());
+	CHECK(std::unique(sorted.begin(), sorted.end()) == sorted.end());
+	for (int count : uses) {
+		CHECK(count > 0);
+	}
+}
+
+TEST(DeformCompactMatchesFullDriver) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(500);
+	double localToWorld[16] = { 2, 0, 0, 0,  0, 2, 0, 0,  0, 0, 2, 0,  1, 1, 1, 1 };
+	for (int mode = kBindMatrix; mode <= kBindOffset; ++mode) {
+		WrapBinding binding = ReferenceBind(driver, points, (BindMode)mode);
+		binding.UpdateReferencedVertices();
+
+		TestMesh moved = driver;
+		double motion[16] = { 1, 0, 0.2, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0.5, 2.0, -1.0, 1 };
+		TransformMesh(moved, motion);
+
+		std::vector<double> compactPoints(binding.referencedVertexCount() * 3);
+		std::vector<float> compactNormals(binding.referencedVertexCount() * 3);
+		GatherReferencedVertices(binding, moved.points.data(), moved.normals.data(),
+								 0, binding.referencedVertexCount(), compactPoints.data(), compactNormals.data());
+
+		std::vector<double> expected = points, actual = points;
+		DeformPoints(binding, moved.points.data(), moved.normals.data(), localToWorld, 0, binding.size(), expected.data());
+		DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), localToWorld, 0, binding.size(), actual.data());
+		for (size_t i = 0; i < expected.size(); ++i) {
+			CHECK(actual[i] == expected[i]);
+		}
+	}
+}
+
+TEST(ReverseIndexListsEveryUse) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(400);
+	WrapBinding binding = ReferenceBind(driver, points);
+	binding.UpdateReferencedVertices();
+
+	CHECK(binding.drivenOffsets.size() == binding.referencedVertexCount() + 1);
+	CHECK(binding.drivenOffsets.back() == binding.drivenVertices.size());
+	for (unsigned int v = 0; v < binding.referencedVertexCount(); ++v) {
+		for (unsigned int j = binding.drivenOffsets[v]; j < binding.drivenOffsets[v + 1]; ++j) {
+			unsigned int i = binding.drivenVertices[j];
+			const int* corners = &binding.compactTriangleVerts[i * 3];
+			CHECK(corners[0] == (int)v || corners[1] == (int)v || corners[2] == (int)v);
+			if (j > binding.drivenOffsets[v]) {
+				CHECK(binding.drivenVertices[j - 1] <= i);
+			}
+		}
+	}
+}
+
+TEST(IncrementalDeformMatchesFullDeform) {
+	TestMesh driver = CreateGrid(12);
+	std::vector<double> points = CreateDrivenPoints(2000);
+	double localToWorld[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0.5, 0, 1 };
+	for (int mode = kBindMatrix; mode <= kBindOffset; ++mode) {
+		WrapBinding binding = ReferenceBind(driver, points, (BindMode)mode);
+		binding.UpdateReferencedVertices();
+		unsigned int compactCount = binding.referencedVertexCount();
+
+		std::vector<double> previousPoints(compactCount * 3);
+		std::vector<float> previousNormals(compactCount * 3);
+		GatherReferencedVertices(binding, driver.points.data(), driver.normals.data(), 0, compactCount,
+								 previousPoints.data(), previousNormals.data());
+		std::vector<double> previousOutput = points;
+		DeformPointsCompact(binding, previousPoints.data(), previousNormals.data(), localToWorld, 0, binding.size(), previousOutput.data());
+
+		// Lift a corner of the driver only
+		TestMesh moved = driver;
+		for (unsigned int v = 0; v < moved.vertexCount(); ++v) {
+			double* p = &moved.points[v * 3];
+			if (p[0] > 3.0 && p[2] > 3.0) {
+				p[1] += 0.5;
+			}
+		}
+		ComputeNormals(moved);
+		std::vector<double> compactPoints(compactCount * 3);
+		std::vector<float> compactNormals(compactCount * 3);
+		GatherReferencedVertices(binding, moved.points.data(), moved.normals.data(), 0, compactCount,
+								 compactPoints.data(), compactNormals.data());
+
+		std::vector<unsigned int> affected;
+		CHECK(FindAffectedVertices(binding, previousPoints.data(), previousNormals.data(),
+								   compactPoints.data(), compactNormals.data(), compactCount, affected));
+		CHECK(!affected.empty());
+		CHECK(affected.size() < binding.size() / 2);
+
+		// Only the affected vertices start again from the input
+		std::vector<double> incremental = previousOutput;
+		for (unsigned int i : affected) {
+			for (int axis = 0; axis < 3; ++axis) {
+				incremental[i * 3 + axis] = points[i * 3 + axis];
+			}
+		}
+		DeformPointsCompactIndexed(binding, compactPoints.data(), compactNormals.data(), localToWorld,
+								   affected.data(), (unsigned int)affected.size(), incremental.data());
+
+		std::vector<double> full = points;
+		DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), localToWorld, 0, binding.size(), full.data());
+		for (size_t i = 0; i < full.size(); ++i) {
+			CHECK_NEAR(incremental[i], full[i], 1e-12);
+		}
+	}
+}
+
+TEST(FindAffectedVerticesGivesUp) {
+	TestMesh driver = CreateGrid(6);
+	std::vector<double> points = CreateDrivenPoints(100);
+	WrapBinding binding = ReferenceBind(driver, points);
+	binding.UpdateReferencedVertices();
+	unsigned int compactCount = binding.referencedVertexCount();
+	std::vector<double> compactPoints(compactCount * 3);
+	std::vector<float> compactNormals(compactCount * 3);
+	GatherReferencedVertices(binding, driver.points.data(), driver.normals.data(), 0, compactCount,
+							 compactPoints.data(), compactNormals.data());
+
+	std::vector<unsigned int> affected;
+	CHECK(FindAffectedVertices(binding, compactPoints.data(), compactNormals.data(),
+							   compactPoints.data(), compactNormals.data(), 0, affected));
+	CHECK(affected.empty());
+
+	std::vector<double> movedPoints = compactPoints;
+	for (double& value : movedPoints) {
+		value += 1.0;
+	}
+	CHECK(!FindAffectedVertices(binding, compactPoints.data(), compactNormals.data(),
+								movedPoints.data(), compactNormals.data(), compactCount / 2, affected));
+}
+
+TEST(SampledBindingRowsAreSortedAndNormalized) {
+	TestMesh driver = CreateGrid(12);
+	std::vector<double> points = CreateDrivenPoints(300);
+	SampleSettings settings;
+	settings.maxInfluences = 6;
+	settings.radius = 2.0;
+	WrapBinding binding = SampleBind(driver, points, settings);
+
+	CHECK(binding.hasSamples());
+	CHECK(binding.sampleOffsets.size() == binding.size() + 1);
+	CHECK(binding.sampleOffsets.back() == binding.sampleVertices.size());
+	unsigned int fullRows = 0;
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		unsigned int first = binding.sampleOffsets[i], last = binding.sampleOffsets[i + 1];
+		CHECK(last > first && last - first <= settings.maxInfluences);
+		fullRows += last - first == settings.maxInfluences ? 1 : 0;
+		double sum = 0.0;
+		for (unsigned int j = first; j < last; ++j) {
+			if (j > first) {
+				CHECK(binding.sampleVertices[j - 1] < binding.sampleVertices[j]);
+			}
+			CHECK(binding.sampleWeights[j] >= 0.0f);
+			sum += binding.sampleWeights[j];
+		}
+		CHECK_NEAR(sum, 1.0, 1e-6);
+	}
+	// The radius spans a few grid cells, so most driven vertices find every influence
+	CHECK(fullRows > binding.size() / 2);
+}
+
+TEST(ZeroRadiusMatchesSingleSampleBinding) {
+	TestMesh driver = CreateGrid(8);
+	std::vector<double> points = CreateDrivenPoints(200);
+	WrapBinding expected = SampleBind(driver, points, SampleSettings());
+	CHECK(!expected.hasSamples());
+
+	// A radius smaller than any corner distance falls back to the corners
+	SampleSettings settings;
+	settings.radius = 1e-9;
+	WrapBinding binding = SampleBind(driver, points, settings);
+	CHECK(binding.hasSamples());
+	TestMesh moved = driver;
+	double motion[16] = { 1, 0, 0.2, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0.5, 2.0, -1.0, 1 };
+	TransformMesh(moved, motion);
+	std::vector<double> actualPoints = points, expectedPoints = points;
+	DeformPointsScalar(binding, moved.points.data(), moved.normals.data(), kIdentity, 0, binding.size(), actualPoints.data());
+	DeformPointsScalar(expected, moved.points.data(), moved.normals.data(), kIdentity, 0, binding.size(), expectedPoints.data());
+	for (size_t i = 0; i < points.size(); ++i) {
+		CHECK_NEAR(actualPoints[i], expectedPoints[i], 1e-6);
+	}
+}
+
+TEST(SampledBindingKeepsBindPoseAndFollowsRigidMotion) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(300);
+	SampleSettings settings;
+	settings.radius = 2.5;
+	double c = std::cos(0.7), s = std::sin(0.7);
+	double motion[16] = { c, s, 0, 0,  -s, c, 0, 0,  0, 0, 1, 0,  1, 2, 3, 1 };
+	TestMesh moved = driver;
+	TransformMesh(moved, motion);
+	for (int mode = kBindMatrix; mode <= kBindOffset; ++mode) {
+		WrapBinding binding = SampleBind(driver, points, settings, (BindMode)mode);
+
+		std::vector<double> deformed = points;
+		DeformPoints(binding, driver.points.data(), driver.normals.data(), kIdentity, 0, binding.size(), deformed.data());
+		for (size_t i = 0; i < points.size(); ++i) {
+			CHECK_NEAR(deformed[i], points[i], 1e-5);
+		}
+
+		deformed = points;
+		DeformPoints(binding, moved.points.data(), moved.normals.data(), kIdentity, 0, binding.size(), deformed.data());
+		for (unsigned int i = 0; i < binding.size(); ++i) {
+			double expected[3];
+			TransformPoint(&points[i * 3], motion, expected);
+			for (int axis = 0; axis < 3; ++axis) {
+				CHECK_NEAR(deformed[i * 3 + axis], expected[axis], 1e-4);
+			}
+		}
+	}
+}
+
+TEST(SampledCompactMatchesFullDriver) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(500);
+	SampleSettings settings;
+	settings.radius = 2.0;
+	WrapBinding binding = SampleBind(driver, points, settings, kBindOffset);
+	binding.UpdateReferencedVertices();
+
+	// Every sample is referenced and its driven vertex is in the reverse index
+	for (unsigned int i = 0; i < binding.size(); ++i) {
+		for (unsigned int j = binding.sampleOffsets[i]; j < binding.sampleOffsets[i + 1]; ++j) {
+			int compactId = binding.compactSampleVertices[j];
+			CHECK(binding.referencedVertices[compactId] == binding.sampleVertices[j]);
+			const unsigned int* first = &binding.drivenVertices[binding.drivenOffsets[compactId]];
+			const unsigned int* last = &binding.drivenVertices[0] + binding.drivenOffsets[compactId + 1];
+			CHECK(std::binary_search(first, last, i));
+		}
+	}
+
+	TestMesh moved = driver;
+	for (unsigned int v = 0; v < moved.vertexCount(); ++v) {
+		moved.points[v * 3 + 1] += 0.1 * moved.points[v * 3] * moved.points[v * 3];
+	}
+	ComputeNormals(moved);
+	std::vector<double> compactPoints(binding.referencedVertexCount() * 3);
+	std::vector<float> compactNormals(binding.referencedVertexCount() * 3);
+	GatherReferencedVertices(binding, moved.points.data(), moved.normals.data(),
+							 0, binding.referencedVertexCount(), compactPoints.data(), compactNormals.data());
+	std::vector<double> expected = points, actual = points;
+	DeformPoints(binding, moved.points.data(), moved.normals.data(), kIdentity, 0, binding.size(), expected.data());
+	DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), kIdentity, 0, binding.size(), actual.data());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		CHECK(actual[i] == expected[i]);
+	}
+}
+
+TEST(LocalityOrderMatchesMeshOrder) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(500);
+	TestMesh moved = driver;
+	for (unsigned int v = 0; v < moved.vertexCount(); ++v) {
+		moved.points[v * 3 + 1] += 0.1 * moved.points[v * 3] * moved.points[v * 3];
+	}
+	ComputeNormals(moved);
+	SampleSettings settings;
+	settings.radius = 2.0;
+	for (BindMode mode : { kBindMatrix, kBindOffset }) {
+		for (bool sampled : { false, true }) {
+			WrapBinding binding = sampled ? SampleBind(driver, points, settings, mode) : ReferenceBind(driver, points, mode);
+			WrapBinding ordered = binding;
+			OrderBindingForLocality(points.data(), ordered);
+			CHECK(ordered.size() == binding.size());
+			CHECK(ordered.hasVertexOrder());
+			CHECK(IsPermutation(ordered.vertexOrder.data(), ordered.size()));
+			// Ordering again starts from the driven vertices, not the elements
+			WrapBinding reordered = ordered;
+			OrderBindingForLocality(points.data(), reordered);
+			CHECK(SameBinding(ordered, reordered));
+			unsigned int i = 7, element = 0;
+			while (ordered.vertexId(element) != i) {
+				++element;
+			}
+			CHECK(ordered.triangleVerts[element * 3] == binding.triangleVerts[i * 3]);
+			CHECK(ordered.coords[element][1] == binding.coords[i][1]);
+
+			binding.UpdateReferencedVertices();
+			ordered.UpdateReferencedVertices();
+			CHECK(ordered.referencedVertexCount() == binding.referencedVertexCount());
+			std::vector<double> compactPoints(binding.referencedVertexCount() * 3);
+			std::vector<float> compactNormals(binding.referencedVertexCount() * 3);
+			GatherReferencedVertices(binding, moved.points.data(), moved.normals.data(),
+									 0, binding.referencedVertexCount(), compactPoints.data(), compactNormals.data());
+			std::vector<double> expected = points;
+			DeformPointsCompact(binding, compactPoints.data(), compactNormals.data(), kIdentity, 0, binding.size(),
+								expected.data());
+
+			// Deformed in element order and scattered back to the driven vertices
+			GatherReferencedVertices(ordered, moved.points.data(), moved.normals.data(),
+									 0, ordered.referencedVertexCount(), compactPoints.data(), compactNormals.data());
+			std::vector<double> elementPoints(points.size()), actual(points.size());
+			GatherDrivenPoints(ordered, points.data(), 0, ordered.size(), elementPoints.data());
+			DeformPointsCompact(ordered, compactPoints.data(), compactNormals.data(), kIdentity, 0, ordered.size(),
+								elementPoints.data());
+			ScatterDrivenPoints(ordered, elementPoints.data(), 0, ordered.size(), actual.data());
+			for (size_t k = 0; k < expected.size(); ++k) {
+				CHECK_NEAR(actual[k], expected[k], 1e-9);
+			}
+		}
+	}
+}
+
+TEST(PermutationsAreChecked) {
+	unsigned int valid[4] = { 2, 0, 3, 1 };
+	unsigned int repeated[4] = { 2, 0, 2, 1 };
+	unsigned int outOfRange[4] = { 2, 0, 4, 1 };
+	CHECK(IsPermutation(valid, 4));
+	CHECK(!IsPermutation(repeated, 4));
+	CHECK(!IsPermutation(outOfRange, 4));
+	CHECK(IsPermutation(nullptr, 0));
+}
+
+TEST(ActiveVerticesSkipZeroWeights) {
+	float weights[6] = { 1.0f, 0.0f, 0.5f, 0.0f, 1.0f, -0.25f };
+	std::vector<unsigned int> active;
+	CHECK(!FindActiveVertices(weights, 6, active));
+	CHECK((active == std::vector<unsigned int>{ 0, 2, 4, 5 }));
+
+	float ones[3] = { 1.0f, 1.0f, 1.0f };
+	CHECK(FindActiveVertices(ones, 3, active));
+	CHECK(active.size() == 3);
+}
+
+TEST(ApplyWeightsBlendsTowardsInput) {
+	double input[6] = { 0, 0, 0,  1, 1, 1 };
+	double points[6] = { 2, 4, 6,  3, 3, 3 };
+	float weights[2] = { 0.5f, 1.0f };
+	unsigned int indices[2] = { 0, 1 };
+	ApplyWeights(input, weights, 0.5f, indices, 2, points);
+	CHECK_NEAR(points[0], 0.5, 1e-12);
+	CHECK_NEAR(points[1], 1.0, 1e-12);
+	CHECK_NEAR(points[2], 1.5, 1e-12);
+	CHECK_NEAR(points[3], 2.0, 1e-12);
+	CHECK_NEAR(points[5], 2.0, 1e-12);
+}
+
+TEST(BindProgressCountsEveryPoint) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(300);
+	TriangleBvh bvh;
+	bvh.Build(driver.points.data(), driver.triangles.data(), driver.triangleCount());
+	VertexTriangles adjacency;
+	adjacency.Build(driver.triangles.data(), driver.triangleCount(), driver.vertexCount());
+	SampleSettings settings;
+	settings.radius = 2.0;
+	unsigned int count = (unsigned int)points.size() / 3;
+
+	for (int sampled = 0; sampled < 2; ++sampled) {
+		TaskProgress progress;
+		progress.AddTotal(kBindStepsPerPoint * count);
+		WrapBinding binding;
+		BindPoints(bvh, adjacency, sampled ? settings : SampleSettings(), points.data(), count, driver.triangles.data(),
+				   driver.points.data(), driver.normals.data(), binding, 16, &progress);
+		CHECK(binding.size() == count);
+		CHECK(!progress.cancelled());
+		CHECK_NEAR(progress.fraction(), 1.0, 1e-12);
+		// Reporting progress does not change the result
+		CHECK(SameBinding(binding, SampleBind(driver, points, sampled ? settings : SampleSettings())));
+	}
+}
+
+TEST(CancelledBindLeavesNoBinding) {
+	TestMesh driver = CreateGrid(10);
+	std::vector<double> points = CreateDrivenPoints(300);
+	TriangleBvh bvh;
+	bvh.Build(driver.points.data(), driver.triangles.data(), driver.triangleCount());
+	VertexTriangles adjacency;
+	adjacency.Build(driver.triangles.data(), driver.triangleCount(), driver.vertexCount());
+	SampleSettings settings;
+	settings.radius = 2.0;
+	unsigned int count = (unsigned int)points.size() / 3;
+
+	for (int sampled = 0; sampled < 2; ++sampled) {
+		TaskProgress progress;
+		progress.AddTotal(kBindStepsPerPoint * count);
+		progress.Cancel();
+		WrapBinding binding;
+		BindPoints(bvh, adjacency, sampled ? settings : SampleSettings(), points.data(), count, driver.triangles.data(),
+				   driver.points.data(), driver.normals.data(), binding, 16, &progress);
+		CHECK(binding.size() == 0);
+		// No chunk runs once the job is cancelled
+		CHECK(progress.fraction() == 0.0);
+	}
+}
+
+RUN_TESTS()
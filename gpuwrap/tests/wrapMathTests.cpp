@@ -0,0 +1,102 @@
+#include "testHarness.h"
+
+#include "core/wrapMath.h"
+
+TEST(BarycentricCoordinatesOfCorners) {
+	double A[3] = { 0.0, 0.0, 0.0 };
+	double B[3] = { 2.0, 0.0, 0.0 };
+	double C[3] = { 0.0, 0.0, 2.0 };
+	BaryCoords coords;
+	GetBarycentricCoordinates(B, A, B, C, coords);
+	CHECK_NEAR(coords[0], 0.0, 1e-6);
+	CHECK_NEAR(coords[1], 1.0, 1e-6);
+	CHECK_NEAR(coords[2], 0.0, 1e-6);
+
+	double P[3] = { 0.5, 0.0, 0.5 };
+	GetBarycentricCoordinates(P, A, B, C, coords);
+	CHECK_NEAR(coords[0], 0.5, 1e-6);
+	CHECK_NEAR(coords[1], 0.25, 1e-6);
+	CHECK_NEAR(coords[2], 0.25, 1e-6);
+}
+
+TEST(BarycentricCoordinatesOfDegenerateTriangle) {
+	double A[3] = { 1.0, 1.0, 1.0 };
+	double P[3] = { 0.0, 0.0, 0.0 };
+	BaryCoords coords;
+	GetBarycentricCoordinates(P, A, A, A, coords);
+	CHECK(coords[0] == 1.0f);
+	CHECK(coords[1] == 0.0f);
+	CHECK(coords[2] == 0.0f);
+}
+
+TEST(ClosestPointOnTriangleRegions) {
+	double A[3] = { 0.0, 0.0, 0.0 };
+	double B[3] = { 2.0, 0.0, 0.0 };
+	double C[3] = { 0.0, 0.0, 2.0 };
+	// Above the face, beyond each vertex and beyond each edge
+	double queries[7][3] = { { 0.5, 1.0, 0.5 }, { -1.0, 0.0, -1.0 }, { 3.0, 0.0, -1.0 }, { -1.0, 0.0, 3.0 },
+							 { 1.0, 0.0, -1.0 }, { -1.0, 0.0, 1.0 }, { 2.0, 0.0, 2.0 } };
+	double expected[7][3] = { { 0.5, 0.0, 0.5 }, { 0.0, 0.0, 0.0 }, { 2.0, 0.0, 0.0 }, { 0.0, 0.0, 2.0 },
+							  { 1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0 }, { 1.0, 0.0, 1.0 } };
+	for (int i = 0; i < 7; ++i) {
+		double closest[3];
+		double distance = ClosestPointOnTriangle(queries[i], A, B, C, closest);
+		double squared = 0.0;
+		for (int axis = 0; axis < 3; ++axis) {
+			CHECK_NEAR(closest[axis], expected[i][axis], 1e-12);
+			squared += (queries[i][axis] - expected[i][axis]) * (queries[i][axis] - expected[i][axis]);
+		}
+		CHECK_NEAR(distance, squared, 1e-12);
+	}
+}
+
+TEST(BasisComponentsPointToLowestWeight) {
+	double points[9] = { 0.0, 0.0, 0.0,  1.0, 0.0, 0.0,  0.0, 0.0, 1.0 };
+	float normals[9] = { 0.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f };
+	int triangle[3] = { 0, 1, 2 };
+	BaryCoords coords = { { 0.6f, 0.3f, 0.1f } };
+	double origin[3], up[3], normal[3];
+	CalculateBasisComponents(coords, triangle, points, normals, origin, up, normal);
+	CHECK_NEAR(origin[0], 0.3, 1e-6);
+	CHECK_NEAR(origin[2], 0.1, 1e-6);
+	CHECK_NEAR(normal[1], 1.0, 1e-6);
+	// Lowest weight is vertex 2
+	double expected[3] = { -0.3, 0.0, 0.9 };
+	double length = std::sqrt(expected[0] * expected[0] + expected[2] * expected[2]);
+	CHECK_NEAR(up[0], expected[0] / length, 1e-6);
+	CHECK_NEAR(up[1], 0.0, 1e-6);
+	CHECK_NEAR(up[2], expected[2] / length, 1e-6);
+}
+
+TEST(InvertMatrixRoundTrips) {
+	double origin[3] = { 1.0, 2.0, 3.0 };
+	double normal[3] = { 0.0, 0.8, 0.6 };
+	double up[3] = { 0.6, 0.0, 0.8 };
+	double matrix[16], inverse[16], product[16];
+	CreateMatrix(origin, normal, up, matrix);
+	CHECK(InvertMatrix(matrix, inverse));
+	MultiplyMatrix(matrix, inverse, product);
+	for (int i = 0; i < 16; ++i) {
+		CHECK_NEAR(product[i], (i % 5 == 0) ? 1.0 : 0.0, 1e-12);
+	}
+
+	double p[3] = { 4.0, -5.0, 6.0 };
+	double q[3];
+	TransformPoint(p, matrix, q);
+	TransformPoint(q, inverse, q);
+	CHECK_NEAR(q[0], p[0], 1e-12);
+	CHECK_NEAR(q[1], p[1], 1e-12);
+	CHECK_NEAR(q[2], p[2], 1e-12);
+}
+
+TEST(InvertSingularMatrixReturnsIdentity) {
+	double matrix[16] = { 0.0 };
+	matrix[15] = 1.0;
+	double inverse[16];
+	CHECK(!InvertMatrix(matrix, inverse));
+	for (int i = 0; i < 16; ++i) {
+		CHECK(inverse[i] == ((i % 5 == 0) ? 1.0 : 0.0));
+	}
+}
+
+RUN_TESTS()
@@ -0,0 +1,101 @@
+#include "testHarness.h"
+
+#include "core/wrapStats.h"
+
+#include <string>
+#include <thread>
+
+TEST(BufferKeepsNewestRecordsOldestFirst) {
+	WrapStatsBuffer buffer(4);
+	CHECK(buffer.capacity() == 4);
+	CHECK(buffer.Records().empty());
+	for (unsigned int i = 0; i < 6; ++i) {
+		WrapStatsRecord record;
+		record.drivenVertices = i;
+		buffer.Push(record);
+	}
+	std::vector<WrapStatsRecord> records = buffer.Records();
+	CHECK(records.size() == 4);
+	for (unsigned int i = 0; i < records.size(); ++i) {
+		CHECK(records[i].drivenVertices == i + 2);
+		CHECK(records[i].sequence == i + 2);
+	}
+
+	std::vector<WrapStatsRecord> last = buffer.Records(3);
+	CHECK(last.size() == 3);
+	CHECK(last.front().drivenVertices == 3);
+	CHECK(last.back().drivenVertices == 5);
+	CHECK(buffer.Records(10).size() == 4);
+
+	buffer.Clear();
+	CHECK(buffer.Records().empty());
+	buffer.Push(WrapStatsRecord());
+	CHECK(buffer.Records().size() == 1);
+	CHECK(buffer.Records().front().sequence == 0);
+}
+
+TEST(ScopePushesPhasesOnExit) {
+	WrapStatsBuffer buffer;
+	{
+		WrapStatsScope scope(&buffer, kStatsDeform, 3);
+		CHECK(scope.record() != nullptr);
+		scope.BeginPhase(kPhaseDecode);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		scope.BeginPhase(kPhaseKernel);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		scope.EndPhase();
+		// Phases add up when they run again
+		scope.BeginPhase(kPhaseDecode);
+		scope.record()->drivenVertices = 10;
+		scope.record()->skippedVertices = 2;
+	}
+	std::vector<WrapStatsRecord> records = buffer.Records();
+	CHECK(records.size() == 1);
+	const WrapStatsRecord& record = records[0];
+	CHECK(record.kind == kStatsDeform);
+	CHECK(record.geometryIndex == 3);
+	CHECK(record.drivenVertices == 10);
+	CHECK(record.skippedVertices == 2);
+	CHECK(record.phaseSeconds[kPhaseDecode] >= 0.001);
+	CHECK(record.phaseSeconds[kPhaseKernel] >= 0.001);
+	CHECK(record.phaseSeconds[kPhaseWriteBack] == 0.0);
+	CHECK(record.totalSeconds >= record.phaseSeconds[kPhaseDecode] + record.phaseSeconds[kPhaseKernel]);
+}
+
+TEST(ScopeWithoutBufferRecordsNothing) {
+	WrapStatsScope scope(nullptr, kStatsBind, -1);
+	CHECK(scope.record() == nullptr);
+	scope.BeginPhase(kPhaseBind);
+	scope.EndPhase();
+}
+
+TEST(EnabledSwitch) {
+	CHECK(!IsWrapStatsEnabled());
+	SetWrapStatsEnabled(true);
+	CHECK(IsWrapStatsEnabled());
+	SetWrapStatsEnabled(false);
+	CHECK(!IsWrapStatsEnabled());
+}
+
+TEST(FormatsOneJsonObject) {
+	WrapStatsRecord record;
+	record.kind = kStatsBind;
+	record.geometryIndex = -1;
+	record.drivenVertices = 42;
+	record.bindDataBytes = 1234;
+	record.phaseSeconds[kPhaseBvhBuild] = 0.5;
+	std::string json = FormatWrapStats(record);
+	CHECK(json.front() == '{' && json.back() == '}');
+	CHECK(json.find("\"kind\": \"bind\"") != std::string::npos);
+	CHECK(json.find("\"geometry\": -1") != std::string::npos);
+	CHECK(json.find("\"drivenVertices\": 42") != std::string::npos);
+	CHECK(json.find("\"bindDataBytes\": 1234") != std::string::npos);
+	CHECK(json.find("\"bvhBuild\": 0.5") != std::string::npos);
+	CHECK(json.find("\"cached\": false") != std::string::npos);
+	CHECK(json.find('\n') == std::string::npos);
+	for (int phase = 0; phase < kPhaseCount; ++phase) {
+		CHECK(json.find(std::string("\"") + GetWrapPhaseName((WrapPhase)phase) + "\"") != std::string::npos);
+	}
+}
+
+RUN_TESTS()